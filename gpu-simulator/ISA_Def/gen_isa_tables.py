@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+
+# Generates isa_tables.h from isa_opcodes.def, see the header of the .def file
+# for its format. The generated header holds the architecture registry, the
+# opcode enum, a constexpr opcode table with the functional unit of every
+# opcode per ISA and its AccelWattch power component, and a minimal perfect
+# hash over the mnemonics.
+#
+# usage: gen_isa_tables.py <isa_opcodes.def> <isa_tables.h>
+
+import sys
+
+ARCHS = ["kepler", "pascal", "volta", "turing", "ampere"]
+
+UNITS = {
+    "ALU": "ALU_OP",
+    "SP": "SP_OP",
+    "DP": "DP_OP",
+    "INT": "INTP_OP",
+    "SFU": "SFU_OP",
+    "LOAD": "LOAD_OP",
+    "STORE": "STORE_OP",
+    "BRANCH": "BRANCH_OP",
+    "CALL": "CALL_OPS",
+    "RET": "RET_OPS",
+    "EXIT": "EXIT_OPS",
+    "BAR": "BARRIER_OP",
+    "MEMBAR": "MEMORY_BARRIER_OP",
+    "SPEC1": "SPECIALIZED_UNIT_1_OP",
+    "SPEC2": "SPECIALIZED_UNIT_2_OP",
+    "SPEC3": "SPECIALIZED_UNIT_3_OP",
+    "SPEC4": "SPECIALIZED_UNIT_4_OP",
+}
+
+# <latency,initiation> classes of an arch profile, in column order
+LATENCY_CLASSES = ["int", "sp", "dp", "sfu", "tensor", "spec_op_1",
+                   "spec_op_2", "spec_op_3", "spec_op_4"]
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+MASK32 = 0xFFFFFFFF
+
+
+def isa_hash(name, seed):
+    # must match isa_hash() in the generated header
+    h = (FNV_OFFSET ^ ((seed * 0x9E3779B9) & MASK32)) & MASK32
+    for c in name.encode():
+        h = ((h ^ c) * FNV_PRIME) & MASK32
+    h ^= h >> 15
+    h = (h * 0x2C1B3C6D) & MASK32
+    h ^= h >> 12
+    return h
+
+
+def fail(def_file, line_num, msg):
+    sys.exit("%s:%d: %s" % (def_file, line_num, msg))
+
+
+def parse_def(def_file):
+    archs = []  # (isa, sm_min, sm_max, [latency,initiation per class])
+    rows = []  # (mnemonic, power, [(unit, opcode mnemonic) or None per isa])
+    comments = {}  # row index -> section comments printed before it
+    pending = []  # comment block right above the current line
+    with open(def_file) as f:
+        lines = f.read().splitlines()
+    for line_num, line in enumerate(lines, 1):
+        line = line.strip()
+        if not line:
+            pending = []
+            continue
+        if line.startswith("#"):
+            pending.append(line[1:].strip())
+            continue
+        cols = line.split()
+        if cols[0] == "arch":
+            pending = []
+            if len(cols) != 3 + len(LATENCY_CLASSES):
+                fail(def_file, line_num,
+                     "expected %d columns" % (3 + len(LATENCY_CLASSES)))
+            if cols[1] not in ARCHS:
+                fail(def_file, line_num, "unknown isa " + cols[1])
+            sm_min, _, sm_max = cols[2].partition("-")
+            if not sm_min.isdigit() or not (sm_max or sm_min).isdigit():
+                fail(def_file, line_num, "bad sm version range " + cols[2])
+            sm_min, sm_max = int(sm_min), int(sm_max or sm_min)
+            for isa, lo, hi, _ in archs:
+                if sm_min <= hi and lo <= sm_max:
+                    fail(def_file, line_num, "overlapping sm version range")
+            for profile in cols[3:]:
+                if len(profile.split(",")) != 2 or not all(
+                        x.isdigit() for x in profile.split(",")):
+                    fail(def_file, line_num, "bad profile entry " + profile)
+            archs.append((cols[1], sm_min, sm_max, cols[3:]))
+            continue
+        if len(cols) != 2 + len(ARCHS):
+            fail(def_file, line_num, "expected %d columns" % (2 + len(ARCHS)))
+        if pending:
+            comments[len(rows)] = pending
+            pending = []
+        name, power = cols[0], cols[1]
+        cells = []
+        for cell in cols[2:]:
+            if cell == "-":
+                cells.append(None)
+                continue
+            unit, _, target = cell.partition(":")
+            if unit not in UNITS:
+                fail(def_file, line_num, "unknown unit " + unit)
+            cells.append((unit, target or name))
+        rows.append((name, "OTHER_OP" if power == "-" else power, cells))
+    return archs, rows, comments
+
+
+def build_perfect_hash(names):
+    # Hash and displace: keys are put in buckets by isa_hash(key, 0), then the
+    # buckets are placed, biggest first, by searching for a seed that sends
+    # all their keys to free slots. Single key buckets are stored directly in
+    # a free slot as -slot - 1.
+    n = len(names)
+    num_buckets = max(1, n // 2)
+    buckets = [[] for _ in range(num_buckets)]
+    for i, name in enumerate(names):
+        buckets[isa_hash(name, 0) % num_buckets].append(i)
+    disp = [0] * num_buckets
+    slots = [None] * n
+    order = sorted(range(num_buckets), key=lambda b: -len(buckets[b]))
+    for b in order:
+        keys = buckets[b]
+        if len(keys) > 1:
+            seed = 1
+            while True:
+                placed = [isa_hash(names[k], seed) % n for k in keys]
+                if len(set(placed)) == len(placed) and all(
+                        slots[s] is None for s in placed):
+                    break
+                seed += 1
+                if seed > 1000000:
+                    sys.exit("unable to build the perfect hash")
+            for k, s in zip(keys, placed):
+                slots[s] = k
+            disp[b] = seed
+    free = [s for s in range(n) if slots[s] is None]
+    for b in order:
+        if len(buckets[b]) == 1:
+            s = free.pop()
+            slots[s] = buckets[b][0]
+            disp[b] = -s - 1
+    return disp, slots
+
+
+def generate(archs, rows, comments, disp, slots):
+    opcode_id = dict((name, i + 1) for i, (name, _, _) in enumerate(rows))
+    power_of = dict((name, power) for name, power, _ in rows)
+    out = []
+    w = out.append
+    w("// Generated by gen_isa_tables.py from isa_opcodes.def, do not edit.")
+    w("")
+    w("#ifndef ISA_TABLES_H")
+    w("#define ISA_TABLES_H")
+    w("")
+    w("#include <string.h>")
+    w('#include "abstract_hardware_model.h"')
+    w("")
+    w("enum TraceInstrOpcode {")
+    for i, (name, _, _) in enumerate(rows):
+        for c in comments.get(i, []):
+            w("  // " + c)
+        w("  OP_%s%s," % (name, " = 1" if i == 0 else ""))
+    w("  SASS_NUM_OPCODES /* The total number of opcodes. */")
+    w("};")
+    w("")
+    w("// ISAs described by isa_opcodes.def, one column each")
+    w("enum isa_arch_t {")
+    for i, arch in enumerate(ARCHS):
+        w("  ISA_%s%s," % (arch.upper(), " = 0" if i == 0 else ""))
+    w("  ISA_NUM_ARCHS")
+    w("};")
+    w("")
+    w("// default <latency,initiation> profile classes of an architecture,")
+    w("// named after the -trace_opcode_latency_initiation_* options")
+    w("enum isa_latency_class_t {")
+    for i, c in enumerate(LATENCY_CLASSES):
+        w("  ISA_LATENCY_%s%s," % (c.upper(), " = 0" if i == 0 else ""))
+    w("  ISA_NUM_LATENCY_CLASSES")
+    w("};")
+    w("")
+    w("struct isa_arch_def_t {")
+    w("  const char *name;")
+    w("  isa_arch_t isa;")
+    w("  // range of SM versions (trace binary versions) using this ISA")
+    w("  unsigned sm_min;")
+    w("  unsigned sm_max;")
+    w("  const char *latency_initiation[ISA_NUM_LATENCY_CLASSES];")
+    w("};")
+    w("")
+    w("#define ISA_NUM_ARCH_DEFS %d" % len(archs))
+    w("")
+    w("static constexpr isa_arch_def_t isa_arch_defs[ISA_NUM_ARCH_DEFS] = {")
+    for isa, sm_min, sm_max, profile in archs:
+        w('    {"%s", ISA_%s, %d, %d,' % (isa, isa.upper(), sm_min, sm_max))
+        w("     {%s}}," % ", ".join('"%s"' % p for p in profile))
+    w("};")
+    w("")
+    w("// Looks up the architecture of a trace binary version, returns NULL if")
+    w("// no registered SM version range covers it")
+    w("inline const isa_arch_def_t *isa_find_arch(unsigned binary_version) {")
+    w("  for (unsigned i = 0; i < ISA_NUM_ARCH_DEFS; i++)")
+    w("    if (binary_version >= isa_arch_defs[i].sm_min &&")
+    w("        binary_version <= isa_arch_defs[i].sm_max)")
+    w("      return &isa_arch_defs[i];")
+    w("  return NULL;")
+    w("}")
+    w("")
+    w("struct isa_opcode_def_t {")
+    w("  const char *name;")
+    w("  unsigned name_len;")
+    w("  // decoded opcode per ISA, 0 when the opcode is not part of the ISA")
+    w("  unsigned short opcode[ISA_NUM_ARCHS];")
+    w("  // functional unit (uarch_op_t) per ISA")
+    w("  unsigned short category[ISA_NUM_ARCHS];")
+    w("  // AccelWattch power component (special_ops)")
+    w("  unsigned short power;")
+    w("};")
+    w("")
+    w("static constexpr isa_opcode_def_t isa_opcode_defs[SASS_NUM_OPCODES] = {")
+    w('    {"", 0, {%s}, {%s}, OTHER_OP},' %
+      (", ".join(["0"] * len(ARCHS)), ", ".join(["0"] * len(ARCHS))))
+    for name, power, cells in rows:
+        opcodes, categories = [], []
+        for cell in cells:
+            if cell is None:
+                opcodes.append("0")
+                categories.append("0")
+                continue
+            unit, target = cell
+            if target not in opcode_id:
+                sys.exit("%s: unknown opcode %s" % (name, target))
+            if power_of[target] != power:
+                sys.exit("%s: decodes to %s which has a different power "
+                         "component" % (name, target))
+            opcodes.append("OP_" + target)
+            categories.append(UNITS[unit])
+        w('    {"%s", %d,' % (name, len(name)))
+        w("     {%s}," % ", ".join(opcodes))
+        w("     {%s}," % ", ".join(categories))
+        w("     %s}," % power)
+    w("};")
+    w("")
+    w("#define ISA_NUM_MNEMONICS %d" % len(slots))
+    w("#define ISA_HASH_BUCKETS %d" % len(disp))
+    w("")
+    w("// bucket displacements: a seed for isa_hash() or -slot - 1")
+    w("static constexpr int isa_hash_disp[ISA_HASH_BUCKETS] = {")
+    for i in range(0, len(disp), 10):
+        w("    " + ", ".join(str(d) for d in disp[i:i + 10]) + ",")
+    w("};")
+    w("")
+    w("// perfect hash slot to opcode")
+    w("static constexpr unsigned short isa_hash_slots[ISA_NUM_MNEMONICS] = {")
+    for i in range(0, len(slots), 8):
+        w("    " + ", ".join("OP_" + rows[s][0] for s in slots[i:i + 8]) + ",")
+    w("};")
+    w("")
+    w("inline unsigned isa_hash(const char *name, size_t len, unsigned seed) {")
+    w("  unsigned h = %uu ^ (seed * 0x9e3779b9u);" % FNV_OFFSET)
+    w("  for (size_t i = 0; i < len; i++)")
+    w("    h = (h ^ (unsigned char)name[i]) * %uu;" % FNV_PRIME)
+    w("  h ^= h >> 15;")
+    w("  h *= 0x2c1b3c6du;")
+    w("  h ^= h >> 12;")
+    w("  return h;")
+    w("}")
+    w("")
+    w("// Looks up an opcode mnemonic (without modifiers) with a single probe,")
+    w("// returns NULL if it is not defined in isa_opcodes.def")
+    w("inline const isa_opcode_def_t *isa_find_opcode(const char *name,")
+    w("                                               size_t len) {")
+    w("  int d = isa_hash_disp[isa_hash(name, len, 0) % ISA_HASH_BUCKETS];")
+    w("  unsigned slot = d < 0 ? (unsigned)(-d - 1)")
+    w("                        : isa_hash(name, len, d) % ISA_NUM_MNEMONICS;")
+    w("  const isa_opcode_def_t *def = &isa_opcode_defs[isa_hash_slots[slot]];")
+    w("  if (def->name_len != len || memcmp(def->name, name, len) != 0)")
+    w("    return NULL;")
+    w("  return def;")
+    w("}")
+    w("")
+    w("#endif")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: %s <isa_opcodes.def> <isa_tables.h>" % sys.argv[0])
+    archs, rows, comments = parse_def(sys.argv[1])
+    if not archs:
+        sys.exit("no architecture defined in " + sys.argv[1])
+    names = [name for name, _, _ in rows]
+    if len(set(names)) != len(names):
+        sys.exit("duplicate mnemonics in " + sys.argv[1])
+    disp, slots = build_perfect_hash(names)
+    with open(sys.argv[2], "w") as f:
+        f.write(generate(archs, rows, comments, disp, slots))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,3 +1,7 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <set>
+
 #include "accel-sim.h"
 #include "accelsim_version.h"
 
@@ -17,8 +21,6 @@ accel_sim_framework::accel_sim_framework(std::string config_file,
 
   tracer = trace_parser(tconfig.get_traces_filename());
 
-  tconfig.parse_config();
-
   init();
 }
 
@@ -32,8 +34,6 @@ accel_sim_framework::accel_sim_framework(int argc, const char **argv) {
 
   tracer = trace_parser(tconfig.get_traces_filename());
 
-  tconfig.parse_config();
-
   init();
 }
 
@@ -45,8 +45,14 @@ void accel_sim_framework::simulation_loop() {
   // while loop till the end of the end kernel execution
   // prints stats
 
+  // every member of an ensemble runs the loop below in a process of its own
+  if (tconfig.get_ensemble() > 1 && !fork_ensemble()) return;
+
   while (commandlist_index < commandlist.size() || !kernels_info.empty()) {
     parse_commandlist();
+    // nothing left to simulate, e.g. only fast-forwarded kernels or memcpys
+    // remained in the commandlist
+    if (kernels_info.empty()) continue;
 
     // Launch all kernels within window that are on a stream that isn't already
     // running
@@ -57,10 +63,11 @@ void accel_sim_framework::simulation_loop() {
       }
       if (!stream_busy && m_gpgpu_sim->can_start_kernel() &&
           !k->was_launched()) {
-        std::cout << "launching kernel name: " << k->get_name()
-                  << " uid: " << k->get_uid()
-                  << " cuda_stream_id: " << k->get_cuda_stream_id()
-                  << std::endl;
+        ACCELSIM_LOG(ACCELSIM_LOG_INFO,
+                     "launching kernel name: %s uid: %u cuda_stream_id: %llu\n",
+                     k->get_name().c_str(), k->get_uid(),
+                     (unsigned long long)k->get_cuda_stream_id());
+        start_convergence(k, busy_streams.empty());
         m_gpgpu_sim->launch(k);
         k->set_launched();
         busy_streams.push_back(k->get_cuda_stream_id());
@@ -80,6 +87,7 @@ void accel_sim_framework::simulation_loop() {
     }
 
     if (m_gpgpu_sim->cycle_insn_cta_max_hit()) {
+      accelsim_log_flush();
       printf(
           "GPGPU-Sim: ** break due to reaching the maximum cycles (or "
           "instructions) **\n");
@@ -87,6 +95,215 @@ void accel_sim_framework::simulation_loop() {
       break;
     }
   }
+  if (fast_forwarding)
+    ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                 "WARNING: the trace ended before the fast-forward target, "
+                 "%llu kernels were skipped and none simulated\n",
+                 ff_kernels);
+  accelsim_log_flush();
+  if (hw_correl != NULL) {
+    hw_correl->print_summary(stdout);
+    fflush(stdout);
+  }
+  if (ensemble_member) {
+    fflush(stdout);
+    exit(0);
+  }
+}
+
+// Forks the members of an ensemble once the commandlist and the trace
+// headers are loaded, they share them with the parent copy-on-write. Returns
+// true in a member, which goes on to simulate with its own seed and output
+// file, and false in the parent once every member is done. The parent exits
+// with an error if none of the members completed.
+bool accel_sim_framework::fork_ensemble() {
+  unsigned members = tconfig.get_ensemble();
+  std::vector<pid_t> pids;
+  std::vector<std::string> outputs;
+  accelsim_log_flush();
+  fflush(stdout);
+  fflush(stderr);
+
+  for (unsigned i = 0; i < members; ++i) {
+    unsigned seed = tconfig.get_seed() + i;
+    std::string output =
+        "accelsim_ensemble_seed" + std::to_string(seed) + ".txt";
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("ERROR: cannot fork the ensemble");
+      exit(1);
+    }
+    if (pid == 0) {
+      if (freopen(output.c_str(), "w", stdout) == NULL) {
+        fprintf(stderr, "ERROR: cannot write %s\n", output.c_str());
+        exit(1);
+      }
+      ensemble_member = true;
+      srand(seed);
+      printf("Accel-Sim: ** ensemble member %u of %u, seed %u **\n", i + 1,
+             members, seed);
+      return true;
+    }
+    pids.push_back(pid);
+    outputs.push_back(output);
+  }
+
+  trace_ensemble_stats stats;
+  int first = -1;
+  for (unsigned i = 0; i < members; ++i) {
+    int status;
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                   "WARNING: ensemble member %u failed, see %s\n", i + 1,
+                   outputs[i].c_str());
+    } else {
+      stats.add_member(outputs[i]);
+      if (first < 0) first = i;
+    }
+  }
+  accelsim_log_flush();
+  if (first < 0) {
+    fprintf(stderr, "ERROR: all %u ensemble members failed\n", members);
+    exit(1);
+  }
+
+  // the first member that completed stands for the run in the stats scripts
+  FILE *fp = fopen(outputs[first].c_str(), "r");
+  if (fp != NULL) {
+    char buffer[1 << 16];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+      fwrite(buffer, 1, length, stdout);
+    fclose(fp);
+  }
+  stats.print(stdout);
+  fflush(stdout);
+  return false;
+}
+
+void accel_sim_framework::resolve_architecture() {
+  // Every kernel of the trace has to target the same architecture. All the
+  // headers are checked up front so that unsupported or mixed architecture
+  // traces fail at startup rather than in the middle of the simulation.
+  // A trace launched several times is only read once.
+  const isa_arch_def_t *arch = NULL;
+  std::string arch_kernel;
+  std::set<std::string> checked;
+  for (const trace_command &command : commandlist) {
+    if (command.m_type != command_type::kernel_launch) continue;
+    if (!checked.insert(command.command_string).second) continue;
+    unsigned binary_version =
+        tracer.parse_binary_version(command.command_string);
+    if (binary_version == 0) {
+      // missing, unreadable or without a -binary version line
+      std::cerr << "ERROR: cannot read trace " << command.command_string
+                << std::endl;
+      exit(1);
+    }
+    const isa_arch_def_t *kernel_arch = isa_find_arch(binary_version);
+    if (kernel_arch == NULL) {
+      std::cerr << "ERROR: unsupported binary version " << binary_version
+                << " in " << command.command_string
+                << "\nSupported SM versions:";
+      for (unsigned i = 0; i < ISA_NUM_ARCH_DEFS; ++i)
+        std::cerr << " " << isa_arch_defs[i].name << " ("
+                  << isa_arch_defs[i].sm_min << "-" << isa_arch_defs[i].sm_max
+                  << ")";
+      std::cerr << std::endl;
+      exit(1);
+    }
+    if (arch == NULL) {
+      arch = kernel_arch;
+      arch_kernel = command.command_string;
+    } else if (kernel_arch != arch) {
+      std::cerr << "ERROR: traces of different architectures can not be "
+                   "simulated together: "
+                << arch_kernel << " is " << arch->name << ", "
+                << command.command_string << " is " << kernel_arch->name
+                << " (binary version " << binary_version << ")" << std::endl;
+      exit(1);
+    }
+  }
+  if (arch != NULL)
+    ACCELSIM_LOG(ACCELSIM_LOG_INFO, "Trace architecture: %s\n", arch->name);
+
+  tconfig.parse_config(arch);
+}
+
+void accel_sim_framework::init_fast_forward() {
+  kernel_launches = 0;
+  ff_kernels = 0;
+  ff_insts = 0;
+  warmup = NULL;
+  fast_forwarding = tconfig.get_fast_forward_kernel() > 1 ||
+                    tconfig.get_fast_forward_insn() > 0;
+  if (!fast_forwarding || !tconfig.get_fast_forward_warmup() ||
+      tconfig.get_arch() == NULL)
+    return;
+
+  if (!m_gpgpu_sim->getMemoryConfig()->m_perf_sim_memcpy)
+    ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                 "WARNING: -accelsim_fast_forward_warmup needs "
+                 "-perf_sim_memcpy 1, the L2 will stay cold\n");
+  warmup = new trace_warmup(m_gpgpu_sim, tconfig.get_arch()->isa,
+                            tconfig.get_fast_forward_warmup_insn(),
+                            tconfig.get_fast_forward_warmup_threads());
+}
+
+// Consumes a kernel before the region of interest without simulating it. Its
+// trace is only read when its instructions count towards
+// -accelsim_fast_forward_insn or its accesses warm up the L2.
+void accel_sim_framework::fast_forward_kernel(const std::string &command) {
+  ACCELSIM_LOG(ACCELSIM_LOG_INFO, "fast-forwarding kernel command : %s\n",
+               command.c_str());
+  ff_kernels++;
+  if (tconfig.get_fast_forward_insn() == 0 && warmup == NULL) return;
+
+  kernel_trace_t *kernel = tracer.parse_kernel_info(command);
+  unsigned threads = kernel->tb_dim_x * kernel->tb_dim_y * kernel->tb_dim_z;
+  unsigned long long ctas = (unsigned long long)kernel->grid_dim_x *
+                            kernel->grid_dim_y * kernel->grid_dim_z;
+  std::vector<std::vector<inst_trace_t> *> threadblock_traces(
+      (threads + WARP_SIZE - 1) / WARP_SIZE);
+  for (auto &warp : threadblock_traces)
+    warp = new std::vector<inst_trace_t>();
+
+  for (unsigned long long cta = 0; cta < ctas && !kernel->ifs->eof(); ++cta) {
+    tracer.get_next_threadblock_traces(threadblock_traces,
+                                       kernel->trace_verion,
+                                       kernel->enable_lineinfo, kernel->ifs);
+    for (auto warp : threadblock_traces) {
+      ff_insts += warp->size();
+      if (warmup)
+        for (const inst_trace_t &inst : *warp) warmup->access(inst, kernel);
+    }
+  }
+
+  for (auto warp : threadblock_traces) delete warp;
+  tracer.kernel_finalizer(kernel);
+}
+
+void accel_sim_framework::end_fast_forward(const std::string &roi_command) {
+  fast_forwarding = false;
+  if (warmup != NULL) warmup->finish();
+  // mark the start of the region of interest in the stats output
+  accelsim_log_flush();
+  printf("Accel-Sim: ** fast-forwarded %llu kernels, the region of interest "
+         "starts at %s **\n",
+         ff_kernels, roi_command.c_str());
+  printf("accelsim_fast_forward_kernels = %llu\n", ff_kernels);
+  if (tconfig.get_fast_forward_insn() > 0 || warmup != NULL)
+    printf("accelsim_fast_forward_insn = %llu\n", ff_insts);
+  if (warmup != NULL) {
+    printf("accelsim_fast_forward_warmup_accesses = %llu\n",
+           warmup->get_accesses());
+    printf("accelsim_fast_forward_warmup_sectors = %llu\n",
+           warmup->get_sectors());
+  }
+  fflush(stdout);
+  delete warmup;
+  warmup = NULL;
 }
 
 void accel_sim_framework::parse_commandlist() {
@@ -98,19 +315,32 @@ void accel_sim_framework::parse_commandlist() {
     if (commandlist[commandlist_index].m_type == command_type::cpu_gpu_mem_copy) {
       size_t addre, Bcount;
       tracer.parse_memcpy_info(commandlist[commandlist_index].command_string, addre, Bcount);
-      std::cout << "launching memcpy command : "
-                << commandlist[commandlist_index].command_string << std::endl;
+      ACCELSIM_LOG(ACCELSIM_LOG_INFO, "launching memcpy command : %s\n",
+                   commandlist[commandlist_index].command_string.c_str());
       m_gpgpu_sim->perf_memcpy_to_gpu(addre, Bcount);
       commandlist_index++;
     } else if (commandlist[commandlist_index].m_type == command_type::kernel_launch) {
+      kernel_launches++;
+      if (fast_forwarding) {
+        const std::string &command =
+            commandlist[commandlist_index].command_string;
+        if (kernel_launches < tconfig.get_fast_forward_kernel() ||
+            ff_insts < tconfig.get_fast_forward_insn()) {
+          fast_forward_kernel(command);
+          commandlist_index++;
+          continue;
+        }
+        end_fast_forward(command);
+      }
       // Read trace header info for window_size number of kernels
       kernel_trace_t *kernel_trace_info =
           tracer.parse_kernel_info(commandlist[commandlist_index].command_string);
       kernel_info = create_kernel_info(kernel_trace_info, m_gpgpu_context,
                                        &tconfig, &tracer);
       kernels_info.push_back(kernel_info);
-      std::cout << "Header info loaded for kernel command : "
-                << commandlist[commandlist_index].command_string << std::endl;
+      ACCELSIM_LOG(ACCELSIM_LOG_INFO,
+                   "Header info loaded for kernel command : %s\n",
+                   commandlist[commandlist_index].command_string.c_str());
       commandlist_index++;
     } else {
       // unsupported commands will fail the simulation
@@ -122,6 +352,10 @@ void accel_sim_framework::parse_commandlist() {
 void accel_sim_framework::cleanup(unsigned finished_kernel) {
   trace_kernel_info_t *k = NULL;
   unsigned long long finished_kernel_cuda_stream_id = -1;
+  bool converged = false;
+  // a kernel cut short by a cycle/insn/cta limit is not compared
+  unsigned finished_kernel_id = 0;
+  std::string finished_kernel_name;
   for (unsigned j = 0; j < kernels_info.size(); j++) {
     k = kernels_info.at(j);
     if (k->get_uid() == finished_kernel ||
@@ -133,6 +367,14 @@ void accel_sim_framework::cleanup(unsigned finished_kernel) {
           break;
         }
       }
+      if (k == converge_kernel) {
+        converged = convergence->converged();
+        converge_kernel = NULL;
+      }
+      if (k->get_uid() == finished_kernel) {
+        finished_kernel_id = k->get_trace_info()->kernel_id;
+        finished_kernel_name = k->get_name();
+      }
       tracer.kernel_finalizer(k->get_trace_info());
       delete k->entry();
       delete k;
@@ -142,30 +384,124 @@ void accel_sim_framework::cleanup(unsigned finished_kernel) {
     }
   }
   assert(k);
+  // keep the log of the kernel ahead of its stats
+  accelsim_log_flush();
   m_gpgpu_sim->print_stats(finished_kernel_cuda_stream_id);
+  if (converged) {
+    convergence->print(stdout, m_gpgpu_sim->gpu_sim_cycle,
+                       m_gpgpu_sim->gpu_sim_insn);
+    fflush(stdout);
+  }
+  if (hw_correl != NULL && finished_kernel_id != 0)
+    compare_hw(finished_kernel_id, finished_kernel_name, converged);
+}
+
+void accel_sim_framework::load_hw_stats() {
+  hw_correl = new trace_hw_correl(tconfig.get_hw_clock_mhz());
+  std::stringstream files(tconfig.get_hw_stats());
+  std::string file;
+  while (std::getline(files, file, ',')) {
+    if (file.empty()) continue;
+    if (!hw_correl->load(file)) {
+      ACCELSIM_LOG(ACCELSIM_LOG_ERROR,
+                   "ERROR: cannot read the hardware stats %s\n",
+                   file.c_str());
+      exit(1);
+    }
+  }
+  if (hw_correl->num_kernels() == 0)
+    ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                 "WARNING: no kernels found in -accelsim_hw_stats %s\n",
+                 tconfig.get_hw_stats());
+  else
+    ACCELSIM_LOG(ACCELSIM_LOG_INFO, "Hardware stats of %u kernels loaded\n",
+                 hw_correl->num_kernels());
+}
+
+// The stats are those of the kernel only if it ran alone on the GPU
+void accel_sim_framework::compare_hw(unsigned kernel_id,
+                                     const std::string &name,
+                                     bool converged) {
+  double cycle = m_gpgpu_sim->gpu_sim_cycle;
+  double insn = m_gpgpu_sim->gpu_sim_insn;
+  if (converged) {
+    cycle = convergence->projected_cycle(m_gpgpu_sim->gpu_sim_cycle);
+    insn = convergence->projected_insn(m_gpgpu_sim->gpu_sim_insn);
+  }
+  double cycle_error;
+  bool compared = hw_correl->compare(
+      stdout, kernel_id, cycle, insn,
+      m_gpgpu_sim->getShaderCoreConfig()->num_shader(), cycle_error);
+  fflush(stdout);
+  float tolerance = tconfig.get_hw_stats_tolerance();
+  if (compared && tolerance > 0 && fabs(cycle_error) > tolerance)
+    ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                 "WARNING: kernel %u %s is %+.1f%% off the hardware "
+                 "cycles\n",
+                 kernel_id, name.c_str(), cycle_error);
+}
+
+// Only a kernel that has the GPU to itself is sampled, the waves of kernels
+// running side by side say nothing about either of them
+void accel_sim_framework::start_convergence(trace_kernel_info_t *kernel,
+                                            bool alone) {
+  if (convergence == NULL) return;
+  if (converge_kernel != NULL && !convergence->converged())
+    converge_kernel = NULL;
+  if (!alone || converge_kernel != NULL) return;
+
+  converge_kernel = kernel;
+  // the wave size is known once the first CTA is issued
+  convergence->start(0, kernel->num_blocks());
+}
+
+void accel_sim_framework::update_convergence() {
+  trace_kernel_info_t *k = converge_kernel;
+  if (!convergence->started()) {
+    // a wave is as many CTAs as fit on every core at once
+    if (k->get_ctas_issued() == 0) return;
+    const shader_core_config *shader = m_gpgpu_sim->getShaderCoreConfig();
+    convergence->start(
+        (unsigned long long)shader->max_cta(*k) * shader->num_shader(),
+        k->num_blocks());
+  }
+
+  if (convergence->update(k->get_ctas_issued(), m_gpgpu_sim->gpu_sim_cycle,
+                          m_gpgpu_sim->gpu_sim_insn)) {
+    ACCELSIM_LOG(ACCELSIM_LOG_INFO,
+                 "kernel %s converged after %llu of %llu CTAs, draining\n",
+                 k->get_name().c_str(), k->get_ctas_issued(),
+                 (unsigned long long)k->num_blocks());
+    k->stop_cta_issue();
+  }
 }
 
 unsigned accel_sim_framework::simulate() {
+  if (!m_gpgpu_sim->active()) return 0;
+
+  // The cores signal a kernel completion through finished_kernel() when its
+  // last CTA exits, and reaching a cycle/insn/cta limit or a deadlock turns
+  // active() false. The loop only waits for one of these events, so active()
+  // is polled once per cycle and the deadlock report is left to the exit.
+  // finished_kernel() stays per cycle, seeing a completion late would delay
+  // the next launch. The convergence only moves when another CTA of its
+  // kernel is issued, so it is updated on that event alone.
   unsigned finished_kernel_uid = 0;
+  unsigned long long converge_ctas = 0;
+  sim_cycles = true;
   do {
-    if (!m_gpgpu_sim->active()) break;
-
-    // performance simulation
-    if (m_gpgpu_sim->active()) {
-      m_gpgpu_sim->cycle();
-      sim_cycles = true;
-      m_gpgpu_sim->deadlock_check();
-    } else {
-      if (m_gpgpu_sim->cycle_insn_cta_max_hit()) {
-        m_gpgpu_context->the_gpgpusim->g_stream_manager
-            ->stop_all_running_kernels();
-        break;
-      }
+    m_gpgpu_sim->cycle();
+    finished_kernel_uid = m_gpgpu_sim->finished_kernel();
+    if (converge_kernel != NULL &&
+        converge_kernel->get_ctas_issued() != converge_ctas) {
+      converge_ctas = converge_kernel->get_ctas_issued();
+      update_convergence();
     }
+  } while (!finished_kernel_uid && m_gpgpu_sim->active());
+  // a deadlock aborts, write out the queued log first
+  accelsim_log_flush();
+  m_gpgpu_sim->deadlock_check();
 
-    active = m_gpgpu_sim->active();
-    finished_kernel_uid = m_gpgpu_sim->finished_kernel();
-  } while (active && !finished_kernel_uid);
   return finished_kernel_uid;
 }
 
@@ -192,7 +528,6 @@ trace_kernel_info_t *accel_sim_framework::create_kernel_info(kernel_trace_t *ker
 gpgpu_sim *accel_sim_framework::gpgpu_trace_sim_init_perf_model(
     int argc, const char *argv[], gpgpu_context *m_gpgpu_context,
     trace_config *m_config) {
-  srand(1);
   print_splash();
 
   option_parser_t opp = option_parser_create();
@@ -209,6 +544,7 @@ gpgpu_sim *accel_sim_framework::gpgpu_trace_sim_init_perf_model(
   m_config->reg_options(opp);
 
   option_parser_cmdline(opp, argc, argv);  // parse configuration options
+  srand(m_config->get_seed());
   fprintf(stdout, "GPGPU-Sim: Configuration options:\n\n");
   option_parser_print(opp, stdout);
   // Set the Numeric locale to a standard locale where a decimal point is a
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "../ISA_Def/trace_opcode.h"
+#include "../trace-parser/accelsim_log.h"
 #include "../trace-parser/trace_parser.h"
 #include "abstract_hardware_model.h"
 #include "cuda-sim/cuda-sim.h"
@@ -16,7 +17,11 @@
 #include "gpgpu_context.h"
 #include "gpgpusim_entrypoint.h"
 #include "option_parser.h"
+#include "trace_convergence.h"
 #include "trace_driven.h"
+#include "trace_ensemble.h"
+#include "trace_hw_correl.h"
+#include "trace_warmup.h"
 
 class accel_sim_framework {
  public:
@@ -24,10 +29,11 @@ class accel_sim_framework {
   accel_sim_framework(std::string config_file, std::string trace_file);
 
   void init() {
-    active = false;
     sim_cycles = false;
+    ensemble_member = false;
     window_size = 0;
     commandlist_index = 0;
+    accelsim_log_set_level(tconfig.get_log_level());
 
     assert(m_gpgpu_context);
     assert(m_gpgpu_sim);
@@ -39,10 +45,30 @@ class accel_sim_framework {
                       : 1;
     assert(window_size > 0);
     commandlist = tracer.parse_commandlist_file();
+    resolve_architecture();
+    init_fast_forward();
+
+    converge_kernel = NULL;
+    convergence = NULL;
+    if (tconfig.get_converge_tolerance() > 0)
+      convergence = new trace_convergence(tconfig.get_converge_tolerance(),
+                                          tconfig.get_converge_min_waves());
+
+    hw_correl = NULL;
+    if (tconfig.get_hw_stats() != NULL) load_hw_stats();
 
     kernels_info.reserve(window_size);
   }
   void simulation_loop();
+  bool fork_ensemble();
+  void resolve_architecture();
+  void init_fast_forward();
+  void fast_forward_kernel(const std::string &command);
+  void end_fast_forward(const std::string &roi_command);
+  void start_convergence(trace_kernel_info_t *kernel, bool alone);
+  void update_convergence();
+  void load_hw_stats();
+  void compare_hw(unsigned kernel_id, const std::string &name, bool converged);
   void parse_commandlist();
   void cleanup(unsigned finished_kernel);
   unsigned simulate();
@@ -62,10 +88,25 @@ class accel_sim_framework {
   gpgpu_sim *m_gpgpu_sim;
 
   bool concurrent_kernel_sm;
-  bool active;
   bool sim_cycles;
   unsigned window_size;
   unsigned commandlist_index;
+  // a process forked by -accelsim_ensemble
+  bool ensemble_member;
+
+  // fast-forward up to the region of interest, see -accelsim_fast_forward_*
+  bool fast_forwarding;
+  unsigned kernel_launches;
+  unsigned long long ff_kernels;
+  unsigned long long ff_insts;
+  trace_warmup *warmup;
+
+  // early exit of converged kernels, see -accelsim_converge_tolerance
+  trace_convergence *convergence;
+  trace_kernel_info_t *converge_kernel;
+
+  // per-kernel error against the hardware, see -accelsim_hw_stats
+  trace_hw_correl *hw_correl;
 
   std::vector<unsigned long long> busy_streams;
   std::vector<trace_kernel_info_t *> kernels_info;
@@ -5,3 +5,4 @@ clang-format -i ${THIS_DIR}/trace-driven/*.cc
 clang-format -i ${THIS_DIR}/ISA_Def/*.h
 clang-format -i ${THIS_DIR}/trace-parser/*.h
 clang-format -i ${THIS_DIR}/trace-parser/*.cc
+clang-format -i ${THIS_DIR}/trace-tools/*.cc
@@ -0,0 +1,142 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <math.h>
+
+#include "trace_convergence.h"
+
+// two-sided 95% quantiles of Student's t distribution, by degrees of freedom
+static const double t_quantile_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+#define T_QUANTILE_DOF (sizeof(t_quantile_95) / sizeof(t_quantile_95[0]))
+
+void trace_convergence::start(unsigned long long wave_ctas,
+                              unsigned long long total_ctas) {
+  m_wave_ctas = wave_ctas;
+  m_total_ctas = total_ctas;
+  m_next_wave = wave_ctas;
+  m_last_cycle = 0;
+  m_last_insn = 0;
+  m_first_wave = true;
+  m_converged = false;
+  m_skipped_ctas = 0;
+  m_wave_ipc.clear();
+  m_wave_cycles.clear();
+  m_wave_insn.clear();
+}
+
+bool trace_convergence::update(unsigned long long ctas_issued,
+                               unsigned long long cycle,
+                               unsigned long long insn) {
+  if (m_converged || m_wave_ctas == 0 || ctas_issued < m_next_wave)
+    return false;
+  m_next_wave = ctas_issued + m_wave_ctas;
+
+  if (m_first_wave) {
+    m_first_wave = false;
+  } else if (cycle > m_last_cycle) {
+    double cycles = cycle - m_last_cycle;
+    double insts = insn - m_last_insn;
+    m_wave_ipc.push_back(insts / cycles);
+    m_wave_cycles.push_back(cycles);
+    m_wave_insn.push_back(insts);
+  }
+  m_last_cycle = cycle;
+  m_last_insn = insn;
+
+  // nothing left to save once the last wave is issued
+  if (m_wave_ipc.size() < m_min_waves || ctas_issued >= m_total_ctas ||
+      !within_tolerance(m_wave_ipc) || !within_tolerance(m_wave_cycles))
+    return false;
+  m_converged = true;
+  m_skipped_ctas = m_total_ctas - ctas_issued;
+  return true;
+}
+
+trace_convergence::interval_t trace_convergence::confidence_interval(
+    const std::vector<double> &samples) {
+  interval_t interval = {0, 0};
+  unsigned n = samples.size();
+  if (n == 0) return interval;
+  for (double sample : samples) interval.mean += sample;
+  interval.mean /= n;
+  if (n < 2) return interval;
+
+  double variance = 0;
+  for (double sample : samples)
+    variance += (sample - interval.mean) * (sample - interval.mean);
+  variance /= n - 1;
+  double t = n - 1 <= T_QUANTILE_DOF ? t_quantile_95[n - 2] : 1.96;
+  interval.half_width = t * sqrt(variance / n);
+  return interval;
+}
+
+bool trace_convergence::within_tolerance(
+    const std::vector<double> &samples) const {
+  interval_t interval = confidence_interval(samples);
+  return interval.mean > 0 &&
+         interval.half_width <= m_tolerance * interval.mean;
+}
+
+void trace_convergence::print(FILE *fout, unsigned long long cycle,
+                              unsigned long long insn) const {
+  if (!m_converged) return;
+  interval_t ipc = confidence_interval(m_wave_ipc);
+  interval_t wave_cycles = confidence_interval(m_wave_cycles);
+  interval_t wave_insn = confidence_interval(m_wave_insn);
+  double waves = (double)m_skipped_ctas / m_wave_ctas;
+
+  fprintf(fout, "accelsim_converged_waves = %zu\n", m_wave_ipc.size());
+  fprintf(fout, "accelsim_converged_wave_ctas = %llu\n", m_wave_ctas);
+  fprintf(fout, "accelsim_converged_skipped_ctas = %llu\n", m_skipped_ctas);
+  fprintf(fout, "accelsim_converged_ipc = %.4f +- %.4f (95%% confidence)\n",
+          ipc.mean, ipc.half_width);
+  fprintf(fout, "accelsim_measured_sim_cycle = %llu\n", cycle);
+  fprintf(fout, "accelsim_measured_sim_insn = %llu\n", insn);
+  fprintf(fout, "accelsim_projected_sim_cycle = %.0f +- %.0f\n",
+          cycle + waves * wave_cycles.mean, waves * wave_cycles.half_width);
+  fprintf(fout, "accelsim_projected_sim_insn = %.0f +- %.0f\n",
+          insn + waves * wave_insn.mean, waves * wave_insn.half_width);
+}
+
+double trace_convergence::projected_cycle(unsigned long long cycle) const {
+  if (!m_converged) return cycle;
+  return cycle + (double)m_skipped_ctas / m_wave_ctas *
+                     confidence_interval(m_wave_cycles).mean;
+}
+
+double trace_convergence::projected_insn(unsigned long long insn) const {
+  if (!m_converged) return insn;
+  return insn + (double)m_skipped_ctas / m_wave_ctas *
+                    confidence_interval(m_wave_insn).mean;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef TRACE_CONVERGENCE_H
+#define TRACE_CONVERGENCE_H
+
+#include <stdio.h>
+#include <vector>
+
+// Stops a long kernel once its performance has converged over the waves of
+// CTAs, see -accelsim_converge_tolerance.
+//
+// A wave is as many CTAs as fit on the GPU at once. Every time another wave
+// has been issued, the cycles and instructions since the previous wave give
+// one sample. The first wave fills the empty GPU and is not sampled. Once at
+// least min_waves samples are taken and the 95% confidence intervals of both
+// the IPC and the cycles per wave are within the tolerance of their means,
+// the kernel is converged. The caller then stops issuing CTAs and lets the
+// ones in flight drain. The cycles and instructions of the CTAs that were
+// never issued are projected from the mean wave.
+class trace_convergence {
+ public:
+  trace_convergence(float tolerance, unsigned min_waves)
+      : m_tolerance(tolerance), m_min_waves(min_waves) {
+    start(0, 0);
+  }
+
+  void start(unsigned long long wave_ctas, unsigned long long total_ctas);
+  bool started() const { return m_wave_ctas > 0; }
+  bool converged() const { return m_converged; }
+
+  // Called whenever another CTA of the kernel is issued, with the CTAs issued
+  // so far and the kernel's cycles and instructions. Returns true on the call
+  // the kernel converges
+  bool update(unsigned long long ctas_issued, unsigned long long cycle,
+              unsigned long long insn);
+
+  // Reports the measured and projected numbers once the kernel is drained
+  void print(FILE *fout, unsigned long long cycle,
+             unsigned long long insn) const;
+  // The kernel's cycles and instructions with the skipped CTAs projected
+  double projected_cycle(unsigned long long cycle) const;
+  double projected_insn(unsigned long long insn) const;
+
+ private:
+  struct interval_t {
+    double mean;
+    double half_width;
+  };
+  static interval_t confidence_interval(const std::vector<double> &samples);
+  bool within_tolerance(const std::vector<double> &samples) const;
+
+  float m_tolerance;
+  unsigned m_min_waves;
+
+  unsigned long long m_wave_ctas;
+  unsigned long long m_total_ctas;
+  unsigned long long m_next_wave;
+  unsigned long long m_last_cycle;
+  unsigned long long m_last_insn;
+  bool m_first_wave;
+  bool m_converged;
+  unsigned long long m_skipped_ctas;
+
+  std::vector<double> m_wave_ipc;
+  std::vector<double> m_wave_cycles;
+  std::vector<double> m_wave_insn;
+};
+
+#endif
@@ -40,13 +40,8 @@
 #include <string>
 #include <vector>
 
-#include "../ISA_Def/accelwattch_component_mapping.h"
-#include "../ISA_Def/ampere_opcode.h"
-#include "../ISA_Def/kepler_opcode.h"
-#include "../ISA_Def/pascal_opcode.h"
 #include "../ISA_Def/trace_opcode.h"
-#include "../ISA_Def/turing_opcode.h"
-#include "../ISA_Def/volta_opcode.h"
+#include "../trace-parser/accelsim_log.h"
 #include "abstract_hardware_model.h"
 #include "cuda-sim/cuda-sim.h"
 #include "cuda-sim/ptx_ir.h"
@@ -62,7 +57,7 @@ const trace_warp_inst_t *trace_shd_warp_t::get_next_trace_inst() {
     trace_warp_inst_t *new_inst =
         new trace_warp_inst_t(get_shader()->get_config());
     new_inst->parse_from_trace_struct(
-        warp_traces[trace_pc], m_kernel_info->OpcodeMap,
+        warp_traces[trace_pc], m_kernel_info->m_isa_arch,
         m_kernel_info->m_tconfig, m_kernel_info->m_kernel_trace_info);
     trace_pc++;
     return new_inst;
@@ -100,26 +95,12 @@ trace_kernel_info_t::trace_kernel_info_t(dim3 gridDim, dim3 blockDim,
   m_tconfig = config;
   m_kernel_trace_info = kernel_trace_info;
   m_was_launched = false;
+  m_ctas_issued = 0;
 
-  // resolve the binary version
-  if (kernel_trace_info->binary_verion == AMPERE_RTX_BINART_VERSION ||
-      kernel_trace_info->binary_verion == AMPERE_A100_BINART_VERSION)
-    OpcodeMap = &Ampere_OpcodeMap;
-  else if (kernel_trace_info->binary_verion == VOLTA_BINART_VERSION)
-    OpcodeMap = &Volta_OpcodeMap;
-  else if (kernel_trace_info->binary_verion == PASCAL_TITANX_BINART_VERSION ||
-           kernel_trace_info->binary_verion == PASCAL_P100_BINART_VERSION)
-    OpcodeMap = &Pascal_OpcodeMap;
-  else if (kernel_trace_info->binary_verion == KEPLER_BINART_VERSION)
-    OpcodeMap = &Kepler_OpcodeMap;
-  else if (kernel_trace_info->binary_verion == TURING_BINART_VERSION)
-    OpcodeMap = &Turing_OpcodeMap;
-  else {
-    printf("unsupported binary version: %d\n",
-           kernel_trace_info->binary_verion);
-    fflush(stdout);
-    exit(0);
-  }
+  // the architecture is resolved once for the whole trace when the
+  // commandlist is parsed, see accel_sim_framework::resolve_architecture
+  assert(config->get_arch() != NULL);
+  m_isa_arch = config->get_arch()->isa;
 }
 
 void trace_kernel_info_t::get_next_threadblock_traces(
@@ -127,6 +108,7 @@ void trace_kernel_info_t::get_next_threadblock_traces(
   m_parser->get_next_threadblock_traces(
       threadblock_traces, m_kernel_trace_info->trace_verion,
       m_kernel_trace_info->enable_lineinfo, m_kernel_trace_info->ifs);
+  m_ctas_issued++;
 }
 
 types_of_operands get_oprnd_type(op_type op, special_ops sp_op) {
@@ -153,8 +135,7 @@ types_of_operands get_oprnd_type(op_type op, special_ops sp_op) {
 }
 
 bool trace_warp_inst_t::parse_from_trace_struct(
-    const inst_trace_t &trace,
-    const std::unordered_map<std::string, OpcodeChar> *OpcodeMap,
+    const inst_trace_t &trace, isa_arch_t isa_arch,
     const class trace_config *tconfig,
     const class kernel_trace_t *kernel_trace_info) {
   // fill the inst_t and warp_inst_t params
@@ -189,36 +170,35 @@ bool trace_warp_inst_t::parse_from_trace_struct(
   const_cache_operand = 0;
   oprnd_type = UN_OP;
 
-  // get the opcode
-  std::vector<std::string> opcode_tokens = trace.get_opcode_tokens();
-  std::string opcode1 = opcode_tokens[0];
-
-  std::unordered_map<std::string, OpcodeChar>::const_iterator it =
-      OpcodeMap->find(opcode1);
-  if (it != OpcodeMap->end()) {
-    m_opcode = it->second.opcode;
-    op = (op_type)(it->second.opcode_category);
-    const std::unordered_map<unsigned, unsigned> *OpcPowerMap = &OpcodePowerMap;
-    std::unordered_map<unsigned, unsigned>::const_iterator it2 =
-        OpcPowerMap->find(m_opcode);
-    if (it2 != OpcPowerMap->end()) sp_op = (special_ops)(it2->second);
+  // get the opcode, a single probe in the generated opcode table gives both
+  // the functional unit and the power component
+  const std::string &opcode = trace.opcode;
+  size_t opcode1_len = opcode.find('.');
+  if (opcode1_len == std::string::npos) opcode1_len = opcode.size();
+  const isa_opcode_def_t *opcode_def =
+      isa_find_opcode(opcode.c_str(), opcode1_len);
+  if (opcode_def != NULL && opcode_def->opcode[isa_arch] != 0) {
+    m_opcode = opcode_def->opcode[isa_arch];
+    op = (op_type)(opcode_def->category[isa_arch]);
+    sp_op = (special_ops)(opcode_def->power);
     oprnd_type = get_oprnd_type(op, sp_op);
   } else {
-    std::cout << "ERROR:  undefined instruction : " << trace.opcode
-              << " Opcode: " << opcode1 << std::endl;
+    ACCELSIM_LOG(ACCELSIM_LOG_ERROR,
+                 "ERROR:  undefined instruction : %s Opcode: %s\n",
+                 trace.opcode.c_str(),
+                 opcode.substr(0, opcode1_len).c_str());
     assert(0 && "undefined instruction");
   }
-  std::string opcode = trace.opcode;
-  if (opcode1 == "MUFU") {  // Differentiate between different MUFU operations
-                            // for power model
+  // Differentiate between different MUFU operations for power model
+  if (m_opcode == OP_MUFU) {
     if ((opcode == "MUFU.SIN") || (opcode == "MUFU.COS")) sp_op = FP_SIN_OP;
     if ((opcode == "MUFU.EX2") || (opcode == "MUFU.RCP")) sp_op = FP_EXP_OP;
     if (opcode == "MUFU.RSQ") sp_op = FP_SQRT_OP;
     if (opcode == "MUFU.LG2") sp_op = FP_LG_OP;
   }
 
-  if (opcode1 == "IMAD") {  // Differentiate between different IMAD operations
-                            // for power model
+  // Differentiate between different IMAD operations for power model
+  if (m_opcode == OP_IMAD) {
     if ((opcode == "IMAD.MOV") || (opcode == "IMAD.IADD")) sp_op = INT__OP;
   }
 
@@ -241,7 +221,7 @@ bool trace_warp_inst_t::parse_from_trace_struct(
   }
 
   // fill latency and initl
-  tconfig->set_latency(op, latency, initiation_interval);
+  tconfig->get_opcode_latency(m_opcode, opcode, latency, initiation_interval);
 
   // fill addresses
   if (trace.memadd_info != NULL) {
@@ -275,9 +255,12 @@ bool trace_warp_inst_t::parse_from_trace_struct(
       // Add for LDGSTS instruction
       if (m_opcode == OP_LDGSTS) m_is_ldgsts = true;
       // check the cache scope, if its strong GPU, then bypass L1
-      if (trace.check_opcode_contain(opcode_tokens, "STRONG") &&
-          trace.check_opcode_contain(opcode_tokens, "GPU")) {
-        cache_op = CACHE_GLOBAL;
+      {
+        std::vector<std::string> opcode_tokens = trace.get_opcode_tokens();
+        if (trace.check_opcode_contain(opcode_tokens, "STRONG") &&
+            trace.check_opcode_contain(opcode_tokens, "GPU")) {
+          cache_op = CACHE_GLOBAL;
+        }
       }
       break;
     case OP_STG:
@@ -385,19 +368,6 @@ bool trace_warp_inst_t::parse_from_trace_struct(
       m_is_depbar = true;
       m_depbar_group_no = trace.imm;
       break;
-    case OP_HADD2:
-    case OP_HADD2_32I:
-    case OP_HFMA2:
-    case OP_HFMA2_32I:
-    case OP_HMUL2_32I:
-    case OP_HSET2:
-    case OP_HSETP2:
-      initiation_interval =
-          initiation_interval / 2;  // FP16 has 2X throughput than FP32
-      if (initiation_interval <
-          1)  // Make sure initiaion interval never goes below 1
-        initiation_interval = 1;
-      break;
     default:
       break;
   }
@@ -417,27 +387,27 @@ void trace_config::reg_options(option_parser_t opp) {
                          &trace_opcode_latency_initiation_int,
                          "Opcode latencies and initiation for integers in "
                          "trace driven mode <latency,initiation>",
-                         "4,1");
+                         "arch");
   option_parser_register(opp, "-trace_opcode_latency_initiation_sp", OPT_CSTR,
                          &trace_opcode_latency_initiation_sp,
                          "Opcode latencies and initiation for sp in trace "
                          "driven mode <latency,initiation>",
-                         "4,1");
+                         "arch");
   option_parser_register(opp, "-trace_opcode_latency_initiation_dp", OPT_CSTR,
                          &trace_opcode_latency_initiation_dp,
                          "Opcode latencies and initiation for dp in trace "
                          "driven mode <latency,initiation>",
-                         "4,1");
+                         "arch");
   option_parser_register(opp, "-trace_opcode_latency_initiation_sfu", OPT_CSTR,
                          &trace_opcode_latency_initiation_sfu,
                          "Opcode latencies and initiation for sfu in trace "
                          "driven mode <latency,initiation>",
-                         "4,1");
+                         "arch");
   option_parser_register(opp, "-trace_opcode_latency_initiation_tensor",
                          OPT_CSTR, &trace_opcode_latency_initiation_tensor,
                          "Opcode latencies and initiation for tensor in trace "
                          "driven mode <latency,initiation>",
-                         "4,1");
+                         "arch");
 
   for (unsigned j = 0; j < SPECIALIZED_UNIT_NUM; ++j) {
     std::stringstream ss;
@@ -446,23 +416,267 @@ void trace_config::reg_options(option_parser_t opp) {
                            &trace_opcode_latency_initiation_specialized_op[j],
                            "specialized unit config"
                            " <latency,initiation>",
-                           "4,4");
+                           ISA_LATENCY_SPEC_OP_1 + j < ISA_NUM_LATENCY_CLASSES
+                               ? "arch"
+                               : "4,4");
   }
+
+  option_parser_register(
+      opp, "-trace_opcode_latency_initiation_override", OPT_CSTR,
+      &trace_opcode_latency_initiation_override,
+      "Per-opcode latencies and initiation replacing the ones of the unit "
+      "the opcode runs on, <OPCODE[.MODIFIER]*:latency,initiation;...>. "
+      "An entry with modifiers applies to the instructions carrying all of "
+      "them, e.g. MUFU.RSQ:40,8;DFMA:8,4",
+      NULL);
+
+  option_parser_register(
+      opp, "-accelsim_log_level", OPT_INT32, &log_level,
+      "Messages printed by the trace driven front-end, 0: errors, "
+      "1: warnings, 2: kernel launches and memcpys, 3: also the trace "
+      "headers and every thread block",
+      "1");
+
+  option_parser_register(
+      opp, "-accelsim_fast_forward_kernel", OPT_UINT32, &fast_forward_kernel,
+      "Skip the kernels launched before the N-th kernel of the kernelslist "
+      "and start the detailed simulation there, memcpys are still applied",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_fast_forward_insn", OPT_UINT64, &fast_forward_insn,
+      "Skip whole kernels until at least this many warp instructions were "
+      "skipped, the detailed simulation starts at the next kernel",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_fast_forward_warmup", OPT_BOOL, &fast_forward_warmup,
+      "Replay the global memory accesses of the skipped kernels into the L2 "
+      "(needs -perf_sim_memcpy 1)",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_fast_forward_warmup_insn", OPT_UINT64,
+      &fast_forward_warmup_insn,
+      "Only warm up the L2 with the last N skipped warp instructions, "
+      "0 warms up with all of them",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_fast_forward_warmup_threads", OPT_UINT32,
+      &fast_forward_warmup_threads,
+      "Threads replaying the warm-up accesses into the L2 sub-partitions, "
+      "0 uses one per core",
+      "0");
+
+  option_parser_register(
+      opp, "-accelsim_seed", OPT_UINT32, &seed,
+      "Seed of the random number generator used by the simulator", "1");
+  option_parser_register(
+      opp, "-accelsim_ensemble", OPT_UINT32, &ensemble,
+      "Fork this many simulations once the trace headers are loaded, the i-th "
+      "seeded with -accelsim_seed + i, and report the mean and variance of "
+      "every stat",
+      "1");
+
+  option_parser_register(
+      opp, "-accelsim_converge_tolerance", OPT_FLOAT, &converge_tolerance,
+      "Stop issuing the CTAs of a kernel once the 95% confidence intervals "
+      "of its IPC and cycles per CTA wave are within this fraction of their "
+      "mean, the rest of the kernel is projected. 0 disables",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_converge_min_waves", OPT_UINT32, &converge_min_waves,
+      "Waves of CTAs sampled at least before a kernel can converge",
+      "5");
+
+  option_parser_register(
+      opp, "-accelsim_hw_stats", OPT_CSTR, &hw_stats,
+      "Profiler csvs of the traced app on hardware, comma separated, e.g. "
+      "repeated runs that are averaged. Every finished kernel is compared "
+      "to the same kernel launch in them",
+      NULL);
+  option_parser_register(
+      opp, "-accelsim_hw_clock_mhz", OPT_FLOAT, &hw_clock_mhz,
+      "Clock of the profiled GPU, converts kernel durations to cycles when "
+      "the csvs have no cycle counter. 0 only uses cycle counters",
+      "0");
+  option_parser_register(
+      opp, "-accelsim_hw_stats_tolerance", OPT_FLOAT, &hw_stats_tolerance,
+      "Warn about kernels whose cycles are off the hardware by more than "
+      "this percentage. 0 disables",
+      "0");
+}
+
+// Options left at "arch" take the <latency,initiation> of the default profile
+// of the architecture of the traces. Units without a profile entry keep the
+// former built-in defaults.
+static void parse_latency_initiation(const char *option,
+                                     const isa_arch_def_t *arch,
+                                     unsigned latency_class,
+                                     const char *builtin_default,
+                                     unsigned &latency, unsigned &initiation) {
+  if (strcmp(option, "arch") == 0)
+    option = arch && latency_class < ISA_NUM_LATENCY_CLASSES
+                 ? arch->latency_initiation[latency_class]
+                 : builtin_default;
+  sscanf(option, "%u,%u", &latency, &initiation);
 }
 
-void trace_config::parse_config() {
-  sscanf(trace_opcode_latency_initiation_int, "%u,%u", &int_latency, &int_init);
-  sscanf(trace_opcode_latency_initiation_sp, "%u,%u", &fp_latency, &fp_init);
-  sscanf(trace_opcode_latency_initiation_dp, "%u,%u", &dp_latency, &dp_init);
-  sscanf(trace_opcode_latency_initiation_sfu, "%u,%u", &sfu_latency, &sfu_init);
-  sscanf(trace_opcode_latency_initiation_tensor, "%u,%u", &tensor_latency,
-         &tensor_init);
+void trace_config::parse_config(const isa_arch_def_t *arch) {
+  m_arch = arch;
+  parse_latency_initiation(trace_opcode_latency_initiation_int, arch,
+                           ISA_LATENCY_INT, "4,1", int_latency, int_init);
+  parse_latency_initiation(trace_opcode_latency_initiation_sp, arch,
+                           ISA_LATENCY_SP, "4,1", fp_latency, fp_init);
+  parse_latency_initiation(trace_opcode_latency_initiation_dp, arch,
+                           ISA_LATENCY_DP, "4,1", dp_latency, dp_init);
+  parse_latency_initiation(trace_opcode_latency_initiation_sfu, arch,
+                           ISA_LATENCY_SFU, "4,1", sfu_latency, sfu_init);
+  parse_latency_initiation(trace_opcode_latency_initiation_tensor, arch,
+                           ISA_LATENCY_TENSOR, "4,1", tensor_latency,
+                           tensor_init);
 
   for (unsigned j = 0; j < SPECIALIZED_UNIT_NUM; ++j) {
-    sscanf(trace_opcode_latency_initiation_specialized_op[j], "%u,%u",
-           &specialized_unit_latency[j], &specialized_unit_initiation[j]);
+    parse_latency_initiation(trace_opcode_latency_initiation_specialized_op[j],
+                             arch, ISA_LATENCY_SPEC_OP_1 + j, "4,4",
+                             specialized_unit_latency[j],
+                             specialized_unit_initiation[j]);
+  }
+
+  // without kernels there is no architecture and nothing to decode
+  if (m_arch != NULL) {
+    build_opcode_latency_table();
+    parse_opcode_overrides();
+  }
+}
+
+void trace_config::build_opcode_latency_table() {
+  isa_arch_t isa = m_arch->isa;
+  for (unsigned i = 1; i < SASS_NUM_OPCODES; ++i) {
+    unsigned opcode = isa_opcode_defs[i].opcode[isa];
+    if (opcode == 0) continue;  // not part of this ISA
+    opcode_latency_t &entry = m_opcode_latency[opcode];
+    set_latency(isa_opcode_defs[i].category[isa], entry.latency,
+                entry.initiation);
+    entry.has_modifier_overrides = false;
+
+    switch (opcode) {
+      case OP_HADD2:
+      case OP_HADD2_32I:
+      case OP_HFMA2:
+      case OP_HFMA2_32I:
+      case OP_HMUL2_32I:
+      case OP_HSET2:
+      case OP_HSETP2:
+        // FP16 has 2X throughput than FP32
+        entry.initiation = entry.initiation / 2;
+        // Make sure initiaion interval never goes below 1
+        if (entry.initiation < 1) entry.initiation = 1;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void trace_config::parse_opcode_overrides() {
+  m_modifier_overrides.clear();
+  if (trace_opcode_latency_initiation_override == NULL) return;
+
+  std::stringstream ss(trace_opcode_latency_initiation_override);
+  std::string entry;
+  while (std::getline(ss, entry, ';')) {
+    if (entry.empty()) continue;
+    size_t colon = entry.find(':');
+    unsigned latency, initiation;
+    if (colon == std::string::npos || colon == 0 ||
+        sscanf(entry.c_str() + colon + 1, "%u,%u", &latency, &initiation) !=
+            2) {
+      ACCELSIM_LOG(ACCELSIM_LOG_ERROR,
+                   "ERROR: invalid -trace_opcode_latency_initiation_override "
+                   "entry \"%s\", expected "
+                   "OPCODE[.MODIFIER]*:latency,initiation\n",
+                   entry.c_str());
+      exit(1);
+    }
+
+    std::vector<std::string> modifiers;
+    std::stringstream key(entry.substr(0, colon));
+    std::string mnemonic, modifier;
+    std::getline(key, mnemonic, '.');
+    while (std::getline(key, modifier, '.'))
+      if (!modifier.empty()) modifiers.push_back(modifier);
+
+    const isa_opcode_def_t *def =
+        isa_find_opcode(mnemonic.c_str(), mnemonic.size());
+    if (def == NULL) {
+      ACCELSIM_LOG(ACCELSIM_LOG_ERROR,
+                   "ERROR: unknown opcode %s in "
+                   "-trace_opcode_latency_initiation_override\n",
+                   mnemonic.c_str());
+      exit(1);
+    }
+    unsigned opcode = def->opcode[m_arch->isa];
+    if (opcode == 0) {
+      ACCELSIM_LOG(ACCELSIM_LOG_WARNING,
+                   "WARNING: %s is not part of the %s ISA, ignoring its "
+                   "-trace_opcode_latency_initiation_override entry\n",
+                   mnemonic.c_str(), m_arch->name);
+      continue;
+    }
+
+    if (modifiers.empty()) {
+      m_opcode_latency[opcode].latency = latency;
+      m_opcode_latency[opcode].initiation = initiation;
+    } else {
+      modifier_override_t modifier_override;
+      modifier_override.opcode = opcode;
+      modifier_override.modifiers = modifiers;
+      modifier_override.latency = latency;
+      modifier_override.initiation = initiation;
+      m_modifier_overrides.push_back(modifier_override);
+      m_opcode_latency[opcode].has_modifier_overrides = true;
+    }
+  }
+}
+
+// whether one of the '.' separated tokens following the mnemonic is modifier
+static bool has_opcode_modifier(const std::string &opcode,
+                                const std::string &modifier) {
+  size_t start = opcode.find('.');
+  while (start != std::string::npos) {
+    size_t end = opcode.find('.', start + 1);
+    size_t len = (end == std::string::npos ? opcode.size() : end) - start - 1;
+    if (len == modifier.size() &&
+        opcode.compare(start + 1, len, modifier) == 0)
+      return true;
+    start = end;
   }
+  return false;
 }
+
+void trace_config::apply_modifier_overrides(
+    unsigned opcode, const std::string &opcode_string, unsigned &latency,
+    unsigned &initiation_interval) const {
+  // the matching override with the most modifiers wins, the first one given
+  // on ties
+  size_t best = 0;
+  for (const modifier_override_t &modifier_override : m_modifier_overrides) {
+    if (modifier_override.opcode != opcode ||
+        modifier_override.modifiers.size() <= best)
+      continue;
+    bool match = true;
+    for (const std::string &modifier : modifier_override.modifiers) {
+      if (!has_opcode_modifier(opcode_string, modifier)) {
+        match = false;
+        break;
+      }
+    }
+    if (match) {
+      best = modifier_override.modifiers.size();
+      latency = modifier_override.latency;
+      initiation_interval = modifier_override.initiation;
+    }
+  }
+}
+
 void trace_config::set_latency(unsigned category, unsigned &latency,
                                unsigned &initiation_interval) const {
   initiation_interval = latency = 1;
@@ -74,8 +74,7 @@ class trace_warp_inst_t : public warp_inst_t {
   }
 
   bool parse_from_trace_struct(
-      const inst_trace_t &trace,
-      const std::unordered_map<std::string, OpcodeChar> *OpcodeMap,
+      const inst_trace_t &trace, isa_arch_t isa_arch,
       const class trace_config *tconfig,
       const class kernel_trace_t *kernel_trace_info);
 
@@ -103,12 +102,20 @@ class trace_kernel_info_t : public kernel_info_t {
 
   void set_launched() { m_was_launched = true; }
 
+  unsigned long long get_ctas_issued() const { return m_ctas_issued; }
+
+  // the CTAs already running finish, no other one is issued
+  void stop_cta_issue() {
+    while (!no_more_ctas_to_run()) increment_cta_id();
+  }
+
  private:
   trace_config *m_tconfig;
-  const std::unordered_map<std::string, OpcodeChar> *OpcodeMap;
+  isa_arch_t m_isa_arch;
   trace_parser *m_parser;
   kernel_trace_t *m_kernel_trace_info;
   bool m_was_launched;
+  unsigned long long m_ctas_issued;
 
   friend class trace_shd_warp_t;
 };
@@ -119,11 +126,69 @@ class trace_config {
 
   void set_latency(unsigned category, unsigned &latency,
                    unsigned &initiation_interval) const;
-  void parse_config();
+  // <latency,initiation> of a decoded instruction, a lookup in the per-opcode
+  // table built by parse_config, refined by the modifier overrides of the
+  // opcode if it has any
+  void get_opcode_latency(unsigned opcode, const std::string &opcode_string,
+                          unsigned &latency,
+                          unsigned &initiation_interval) const {
+    const opcode_latency_t &entry = m_opcode_latency[opcode];
+    latency = entry.latency;
+    initiation_interval = entry.initiation;
+    if (entry.has_modifier_overrides)
+      apply_modifier_overrides(opcode, opcode_string, latency,
+                               initiation_interval);
+  }
+  // Parses the options once the architecture of the traces is known, the
+  // latency options left at "arch" take its default profile
+  void parse_config(const isa_arch_def_t *arch);
   void reg_options(option_parser_t opp);
   char *get_traces_filename() { return g_traces_filename; }
+  const isa_arch_def_t *get_arch() const { return m_arch; }
+  int get_log_level() const { return log_level; }
+  unsigned get_fast_forward_kernel() const { return fast_forward_kernel; }
+  unsigned long long get_fast_forward_insn() const {
+    return fast_forward_insn;
+  }
+  bool get_fast_forward_warmup() const { return fast_forward_warmup; }
+  unsigned long long get_fast_forward_warmup_insn() const {
+    return fast_forward_warmup_insn;
+  }
+  unsigned get_fast_forward_warmup_threads() const {
+    return fast_forward_warmup_threads;
+  }
+  unsigned get_seed() const { return seed; }
+  unsigned get_ensemble() const { return ensemble; }
+  float get_converge_tolerance() const { return converge_tolerance; }
+  unsigned get_converge_min_waves() const { return converge_min_waves; }
+  const char *get_hw_stats() const { return hw_stats; }
+  float get_hw_clock_mhz() const { return hw_clock_mhz; }
+  float get_hw_stats_tolerance() const { return hw_stats_tolerance; }
 
  private:
+  struct opcode_latency_t {
+    unsigned latency;
+    unsigned initiation;
+    bool has_modifier_overrides;
+  };
+  // override of the opcodes carrying all of the given modifiers
+  struct modifier_override_t {
+    unsigned opcode;
+    std::vector<std::string> modifiers;
+    unsigned latency;
+    unsigned initiation;
+  };
+
+  void build_opcode_latency_table();
+  void parse_opcode_overrides();
+  void apply_modifier_overrides(unsigned opcode,
+                                const std::string &opcode_string,
+                                unsigned &latency,
+                                unsigned &initiation_interval) const;
+
+  const isa_arch_def_t *m_arch = NULL;
+  opcode_latency_t m_opcode_latency[SASS_NUM_OPCODES] = {};
+  std::vector<modifier_override_t> m_modifier_overrides;
   unsigned int_latency, fp_latency, dp_latency, sfu_latency, tensor_latency;
   unsigned int_init, fp_init, dp_init, sfu_init, tensor_init;
   unsigned specialized_unit_latency[SPECIALIZED_UNIT_NUM];
@@ -136,6 +201,20 @@ class trace_config {
   char *trace_opcode_latency_initiation_sfu;
   char *trace_opcode_latency_initiation_tensor;
   char *trace_opcode_latency_initiation_specialized_op[SPECIALIZED_UNIT_NUM];
+  char *trace_opcode_latency_initiation_override;
+  int log_level;
+  unsigned fast_forward_kernel;
+  unsigned long long fast_forward_insn;
+  bool fast_forward_warmup;
+  unsigned long long fast_forward_warmup_insn;
+  unsigned fast_forward_warmup_threads;
+  unsigned seed;
+  unsigned ensemble;
+  float converge_tolerance;
+  unsigned converge_min_waves;
+  char *hw_stats;
+  float hw_clock_mhz;
+  float hw_stats_tolerance;
 };
 
 class trace_shd_warp_t : public shd_warp_t {
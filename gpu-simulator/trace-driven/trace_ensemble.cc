@@ -0,0 +1,109 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <ctype.h>
+#include <stdlib.h>
+#include <fstream>
+
+#include "trace_ensemble.h"
+
+bool trace_ensemble_stats::add_member(const std::string &output_file) {
+  std::ifstream output(output_file.c_str());
+  if (!output.is_open()) return false;
+  m_members++;
+
+  const std::string kernel_name = "kernel_name = ";
+  int kernel = -1;
+  std::map<std::string, unsigned> occurrences;
+  std::string line;
+  while (std::getline(output, line)) {
+    if (line.compare(0, kernel_name.size(), kernel_name) == 0) {
+      kernel++;
+      occurrences.clear();
+      if ((unsigned)kernel == m_kernels.size()) {
+        m_kernels.push_back(kernel_stats_t());
+        m_kernels.back().name = line.substr(kernel_name.size());
+      }
+      continue;
+    }
+    if (kernel < 0) continue;
+
+    // name = number, optionally followed by a unit
+    size_t name_end = line.find_first_of(" \t=");
+    size_t equal = line.find('=');
+    if (name_end == 0 || equal == std::string::npos ||
+        line.find_first_not_of(" \t", name_end) != equal)
+      continue;
+    const char *number = line.c_str() + equal + 1;
+    char *number_end;
+    double value = strtod(number, &number_end);
+    if (number_end == number || (*number_end && !isspace(*number_end)))
+      continue;
+
+    std::string name = line.substr(0, name_end);
+    unsigned occurrence = occurrences[name]++;
+    std::string key = name + "#" + std::to_string(occurrence);
+    kernel_stats_t &stats = m_kernels[kernel];
+    std::map<std::string, unsigned>::iterator it = stats.index.find(key);
+    if (it == stats.index.end()) {
+      it = stats.index.insert(std::make_pair(key, stats.stats.size())).first;
+      stats.stats.push_back(stat_t());
+      stats.stats.back().name = name;
+    }
+    stats.stats[it->second].values.push_back(value);
+  }
+  return true;
+}
+
+void trace_ensemble_stats::print(FILE *fout) const {
+  fprintf(fout, "Accel-Sim: ** ensemble statistics over %u members **\n",
+          m_members);
+  for (unsigned k = 0; k < m_kernels.size(); ++k) {
+    fprintf(fout, "ensemble: kernel %u %s\n", k + 1,
+            m_kernels[k].name.c_str());
+    for (const stat_t &stat : m_kernels[k].stats) {
+      unsigned n = stat.values.size();
+      double mean = 0;
+      for (double value : stat.values) mean += value;
+      mean /= n;
+      double variance = 0;
+      for (double value : stat.values)
+        variance += (value - mean) * (value - mean);
+      variance = n > 1 ? variance / (n - 1) : 0;
+      // the stat name is not followed by "=", the per-kernel regexes of the
+      // stats scripts must not pick these lines up
+      fprintf(fout, "ensemble: %s mean = %.4f variance = %.4f",
+              stat.name.c_str(), mean, variance);
+      if (n != m_members) fprintf(fout, " (%u of %u members)", n, m_members);
+      fprintf(fout, "\n");
+    }
+  }
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef TRACE_ENSEMBLE_H
+#define TRACE_ENSEMBLE_H
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Mean and variance of the stats printed by the members of an ensemble of
+// simulations that only differ in their seed, see -accelsim_ensemble.
+//
+// Every "name = number" line after a "kernel_name = " line is a stat of that
+// kernel. The stats are matched across members by kernel, name and, for
+// names printed more than once per kernel, occurrence.
+class trace_ensemble_stats {
+ public:
+  trace_ensemble_stats() : m_members(0) {}
+
+  bool add_member(const std::string &output_file);
+  void print(FILE *fout) const;
+
+ private:
+  struct stat_t {
+    std::string name;
+    std::vector<double> values;
+  };
+  struct kernel_stats_t {
+    std::string name;
+    std::vector<stat_t> stats;
+    std::map<std::string, unsigned> index;
+  };
+
+  std::vector<kernel_stats_t> m_kernels;
+  unsigned m_members;
+};
+
+#endif
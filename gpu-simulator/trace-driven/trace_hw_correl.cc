@@ -0,0 +1,218 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <math.h>
+#include <stdlib.h>
+#include <fstream>
+
+#include "trace_hw_correl.h"
+
+trace_hw_correl::trace_hw_correl(float clock_mhz)
+    : m_clock_mhz(clock_mhz), m_unmatched(0) {}
+
+bool trace_hw_correl::load(const std::string &csv_file) {
+  std::ifstream csv(csv_file.c_str());
+  if (!csv.is_open()) return false;
+
+  // the profilers print their own messages ahead of the header
+  std::vector<std::string> header;
+  int name_col = -1, id_col = -1, metric_col = -1, value_col = -1;
+  unsigned kernel = 0;
+  std::string line;
+  while (std::getline(csv, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+    std::vector<std::string> row = split_csv(line);
+    if (header.empty()) {
+      for (unsigned i = 0; i < row.size(); ++i) {
+        if (row[i] == "Kernel Name" || row[i] == "Name") name_col = i;
+        if (row[i] == "ID") id_col = i;
+        if (row[i] == "Metric Name") metric_col = i;
+        if (row[i] == "Metric Value") value_col = i;
+      }
+      if (name_col >= 0) header = row;
+      continue;
+    }
+
+    // the units, memcpys and what the profiler prints after the kernels
+    if (row.size() != header.size()) continue;
+    const std::string &name = row[name_col];
+    if (name.empty() || name.compare(0, 6, "[CUDA ") == 0) continue;
+
+    double value;
+    if (metric_col >= 0 && value_col >= 0) {
+      double id;
+      if (id_col >= 0 && parse_number(row[id_col], id) &&
+          parse_number(row[value_col], value))
+        add((unsigned)id, name, row[metric_col], value);
+    } else {
+      for (unsigned i = 0; i < row.size(); ++i)
+        if ((int)i != name_col && parse_number(row[i], value))
+          add(kernel, name, header[i], value);
+      kernel++;
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> trace_hw_correl::split_csv(const std::string &line) {
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); ++i) {
+    char c = line[i];
+    if (quoted) {
+      if (c != '"')
+        fields.back() += c;
+      else if (i + 1 < line.size() && line[i + 1] == '"')
+        fields.back() += line[++i];
+      else
+        quoted = false;
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.push_back(std::string());
+    } else {
+      fields.back() += c;
+    }
+  }
+  return fields;
+}
+
+// Numbers may carry thousands separators, "1,234,567.5"
+bool trace_hw_correl::parse_number(const std::string &field, double &value) {
+  std::string number;
+  for (char c : field)
+    if (c != ',') number += c;
+  if (number.empty()) return false;
+  char *end;
+  value = strtod(number.c_str(), &end);
+  return *end == '\0' && isfinite(value);
+}
+
+void trace_hw_correl::add(unsigned kernel, const std::string &name,
+                          const std::string &metric, double value) {
+  if (kernel >= m_kernels.size()) m_kernels.resize(kernel + 1);
+  hw_kernel_t &hw = m_kernels[kernel];
+  if (hw.name.empty()) hw.name = name;
+  hw.sum[metric] += value;
+  hw.count[metric]++;
+}
+
+bool trace_hw_correl::hw_kernel_t::get(const char *metric,
+                                       double &value) const {
+  std::map<std::string, double>::const_iterator it = sum.find(metric);
+  if (it == sum.end()) return false;
+  value = it->second / count.find(metric)->second;
+  return true;
+}
+
+bool trace_hw_correl::hw_cycle(const hw_kernel_t &kernel,
+                               unsigned num_shaders, double &cycle) const {
+  if (kernel.get("gpc__cycles_elapsed.avg", cycle) ||
+      kernel.get("gpc__cycles_elapsed.max", cycle) ||
+      kernel.get("sm__cycles_elapsed.avg", cycle))
+    return true;
+  // nvprof sums the cycles over the SMs
+  if (kernel.get("elapsed_cycles_sm", cycle)) {
+    cycle /= num_shaders;
+    return true;
+  }
+  if (m_clock_mhz <= 0) return false;
+  double duration;
+  if (kernel.get("gpu__time_duration.sum", duration) ||
+      kernel.get("Duration (ns)", duration)) {
+    cycle = duration * m_clock_mhz / 1000;
+    return true;
+  }
+  // run_hw.py has nvprof report durations in microseconds
+  if (kernel.get("Duration", duration)) {
+    cycle = duration * m_clock_mhz;
+    return true;
+  }
+  return false;
+}
+
+double trace_hw_correl::report(FILE *fout, const char *stat, double sim,
+                               double hw, errors_t &errors) {
+  double error = hw != 0 ? (sim - hw) / hw * 100 : 0;
+  errors.abs_sum += fabs(error);
+  if (fabs(error) > errors.max_abs) errors.max_abs = fabs(error);
+  errors.kernels++;
+  fprintf(fout, "accelsim_hw_%s = %.0f\n", stat, hw);
+  fprintf(fout, "accelsim_hw_%s_error = %+.2f%%\n", stat, error);
+  return error;
+}
+
+bool trace_hw_correl::compare(FILE *fout, unsigned kernel_id,
+                              double sim_cycle, double sim_insn,
+                              unsigned num_shaders, double &cycle_error) {
+  if (kernel_id == 0 || kernel_id > m_kernels.size() ||
+      m_kernels[kernel_id - 1].sum.empty()) {
+    m_unmatched++;
+    fprintf(fout, "accelsim_hw_kernel_name = (not profiled)\n");
+    return false;
+  }
+  const hw_kernel_t &kernel = m_kernels[kernel_id - 1];
+  fprintf(fout, "accelsim_hw_kernel_name = %s\n", kernel.name.c_str());
+
+  double insn;
+  if (kernel.get("smsp__thread_inst_executed.sum", insn) ||
+      kernel.get("thread_inst_executed", insn))
+    report(fout, "thread_insn", sim_insn, insn, m_insn_errors);
+
+  double cycle;
+  if (!hw_cycle(kernel, num_shaders, cycle)) return false;
+  cycle_error = report(fout, "cycle", sim_cycle, cycle, m_cycle_errors);
+  // what a sweep is judged by, the error so far
+  fprintf(fout, "accelsim_hw_mean_abs_cycle_error = %.2f%% (%u kernels)\n",
+          m_cycle_errors.abs_sum / m_cycle_errors.kernels,
+          m_cycle_errors.kernels);
+  return true;
+}
+
+void trace_hw_correl::print_summary(FILE *fout) const {
+  fprintf(fout, "Accel-Sim: ** error against the hardware **\n");
+  if (m_cycle_errors.kernels > 0)
+    fprintf(fout,
+            "hw_correl: cycles mean abs error %.2f%% max %.2f%% over %u "
+            "kernels\n",
+            m_cycle_errors.abs_sum / m_cycle_errors.kernels,
+            m_cycle_errors.max_abs, m_cycle_errors.kernels);
+  if (m_insn_errors.kernels > 0)
+    fprintf(fout,
+            "hw_correl: thread instructions mean abs error %.2f%% max %.2f%% "
+            "over %u kernels\n",
+            m_insn_errors.abs_sum / m_insn_errors.kernels,
+            m_insn_errors.max_abs, m_insn_errors.kernels);
+  if (m_unmatched > 0)
+    fprintf(fout, "hw_correl: %u kernels not found in the hardware stats\n",
+            m_unmatched);
+}
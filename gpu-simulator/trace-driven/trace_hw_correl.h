@@ -0,0 +1,94 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef TRACE_HW_CORREL_H
+#define TRACE_HW_CORREL_H
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Compares each finished kernel with the same kernel launch profiled on
+// hardware, see -accelsim_hw_stats.
+//
+// The csvs are the ones util/hw_stats/run_hw.py collects: nvprof
+// --print-gpu-trace, nv-nsight-cu-cli with one row per kernel (--page raw)
+// or one row per kernel and metric, and nsys gputrace. Memcpys are skipped,
+// the N-th kernel of a csv is the N-th kernel launch of the trace. Metrics
+// found for a kernel in several csvs, e.g. repeated runs, are averaged.
+class trace_hw_correl {
+ public:
+  trace_hw_correl(float clock_mhz);
+
+  bool load(const std::string &csv_file);
+  unsigned num_kernels() const { return m_kernels.size(); }
+
+  // Reports the hardware cycles and thread instructions of the kernel_id-th
+  // kernel launch (starting at 1) and the error of the simulation against
+  // them. Returns false when the hardware cycles of the kernel are unknown,
+  // otherwise cycle_error is the error in percent.
+  bool compare(FILE *fout, unsigned kernel_id, double sim_cycle,
+               double sim_insn, unsigned num_shaders, double &cycle_error);
+  void print_summary(FILE *fout) const;
+
+ private:
+  struct hw_kernel_t {
+    std::string name;
+    std::map<std::string, double> sum;
+    std::map<std::string, unsigned> count;
+
+    bool get(const char *metric, double &value) const;
+  };
+  struct errors_t {
+    errors_t() : abs_sum(0), max_abs(0), kernels(0) {}
+    double abs_sum;
+    double max_abs;
+    unsigned kernels;
+  };
+
+  static std::vector<std::string> split_csv(const std::string &line);
+  static bool parse_number(const std::string &field, double &value);
+  void add(unsigned kernel, const std::string &name, const std::string &metric,
+           double value);
+  bool hw_cycle(const hw_kernel_t &kernel, unsigned num_shaders,
+                double &cycle) const;
+  static double report(FILE *fout, const char *stat, double sim, double hw,
+                       errors_t &errors);
+
+  float m_clock_mhz;
+  std::vector<hw_kernel_t> m_kernels;
+  errors_t m_cycle_errors;
+  errors_t m_insn_errors;
+  unsigned m_unmatched;
+};
+
+#endif
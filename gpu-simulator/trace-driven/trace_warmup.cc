@@ -0,0 +1,236 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "abstract_hardware_model.h"
+#include "gpgpu-sim/gpu-sim.h"
+#include "trace_warmup.h"
+
+// sectors decoded before the workers are handed a batch
+#define WARMUP_BATCH_SIZE (1 << 16)
+
+trace_warmup::trace_warmup(gpgpu_sim *gpu, isa_arch_t isa_arch,
+                           unsigned long long window, unsigned threads)
+    : m_gpu(gpu),
+      m_config(gpu->getMemoryConfig()),
+      m_isa_arch(isa_arch),
+      m_window(window),
+      m_generation(0),
+      m_busy(0),
+      m_stop(false),
+      m_insts(0),
+      m_accesses(0),
+      m_sectors(0) {
+  const l2_cache_config &l2 = m_config->m_L2_config;
+  m_assoc = l2.get_num_lines() / l2.get_nset();
+  m_line_size = l2.get_line_sz();
+  tag_line_t invalid = {0, 0, 0};
+  m_tags.assign(m_config->m_n_mem_sub_partition,
+                tag_array_t(l2.get_num_lines(), invalid));
+
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  m_threads = std::max(1u, std::min(threads, (unsigned)m_tags.size()));
+  m_batch.reserve(WARMUP_BATCH_SIZE);
+  m_replaying.reserve(WARMUP_BATCH_SIZE);
+}
+
+trace_warmup::~trace_warmup() { stop(); }
+
+bool trace_warmup::is_global_access(const inst_trace_t &inst,
+                                    const kernel_trace_t *kernel) const {
+  if (inst.memadd_info == NULL) return false;
+
+  size_t opcode1_len = inst.opcode.find('.');
+  if (opcode1_len == std::string::npos) opcode1_len = inst.opcode.size();
+  const isa_opcode_def_t *opcode_def =
+      isa_find_opcode(inst.opcode.c_str(), opcode1_len);
+  if (opcode_def == NULL) return false;
+
+  switch (opcode_def->opcode[m_isa_arch]) {
+    case OP_LDG:
+    case OP_LDGSTS:
+    case OP_STG:
+    case OP_ATOMG:
+    case OP_RED:
+    case OP_ATOM:
+      return true;
+    case OP_LD:
+    case OP_ST:
+      // generic accesses are resolved as in parse_from_trace_struct, by the
+      // first active address
+      if (kernel->shmem_base_addr == 0 || kernel->local_base_addr == 0)
+        return false;
+      for (unsigned i = 0; i < WARP_SIZE; ++i)
+        if (inst.mask & (1u << i)) {
+          uint64_t addr = inst.memadd_info->addrs[i];
+          return addr < kernel->shmem_base_addr ||
+                 addr >= kernel->local_base_addr + LOCAL_MEM_SIZE_MAX;
+        }
+      return false;
+    default:
+      return false;
+  }
+}
+
+void trace_warmup::access(const inst_trace_t &inst,
+                          const kernel_trace_t *kernel) {
+  m_insts++;
+  if (!is_global_access(inst, kernel)) return;
+
+  // coalesce the lanes into the distinct sectors the warp touches
+  uint64_t sectors[WARP_SIZE];
+  unsigned n = 0;
+  for (unsigned i = 0; i < WARP_SIZE; ++i)
+    if (inst.mask & (1u << i))
+      sectors[n++] = inst.memadd_info->addrs[i] & ~(uint64_t)(SECTOR_SIZE - 1);
+  std::sort(sectors, sectors + n);
+  n = std::unique(sectors, sectors + n) - sectors;
+
+  for (unsigned i = 0; i < n; ++i) {
+    addrdec_t tlx;
+    m_config->m_address_mapping.addrdec_tlx(sectors[i], &tlx);
+    sector_access_t sector = {sectors[i], m_insts, tlx.sub_partition};
+    m_batch.push_back(sector);
+  }
+  m_accesses += n;
+  if (m_batch.size() >= WARMUP_BATCH_SIZE) dispatch();
+}
+
+// Hands the decoded batch to the workers, once they are done with the
+// previous one. The workers are started with the first batch.
+void trace_warmup::dispatch() {
+  wait();
+  m_replaying.swap(m_batch);
+  m_batch.clear();
+  if (m_workers.empty())
+    for (unsigned w = 0; w < m_threads; ++w)
+      m_workers.push_back(std::thread(&trace_warmup::work, this, w));
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_busy = m_threads;
+    m_generation++;
+  }
+  m_batch_ready.notify_all();
+}
+
+void trace_warmup::wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_batch_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void trace_warmup::stop() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_batch_ready.notify_all();
+  for (auto &worker : m_workers) worker.join();
+  m_workers.clear();
+}
+
+void trace_warmup::work(unsigned worker) {
+  uint64_t replayed = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_batch_ready.wait(
+        lock, [&] { return m_stop || m_generation != replayed; });
+    if (m_stop) return;
+    replayed = m_generation;
+    lock.unlock();
+    replay(worker);
+    lock.lock();
+    if (--m_busy == 0) m_batch_done.notify_all();
+  }
+}
+
+// Each worker owns the tag arrays of every m_threads-th sub-partition, so
+// the workers never touch the same line
+void trace_warmup::replay(unsigned worker) {
+  const l2_cache_config &l2 = m_config->m_L2_config;
+  for (const sector_access_t &sector : m_replaying) {
+    if (sector.sub_partition >= m_tags.size() ||
+        sector.sub_partition % m_threads != worker)
+      continue;
+
+    uint64_t block = sector.addr & ~(uint64_t)(m_line_size - 1);
+    unsigned mask = 1u << ((sector.addr % m_line_size) / SECTOR_SIZE);
+    tag_line_t *set =
+        &m_tags[sector.sub_partition][l2.set_index(sector.addr) * m_assoc];
+
+    // hit, or else the first invalid way or the least recently used one
+    tag_line_t *line = NULL;
+    tag_line_t *victim = &set[0];
+    for (unsigned way = 0; way < m_assoc; ++way) {
+      if (set[way].sectors && set[way].block == block) {
+        line = &set[way];
+        break;
+      }
+      if (victim->sectors && (!set[way].sectors ||
+                              set[way].stamp < victim->stamp))
+        victim = &set[way];
+    }
+    if (line == NULL) {
+      line = victim;
+      line->block = block;
+      line->sectors = 0;
+    }
+    line->sectors |= mask;
+    line->stamp = sector.stamp;
+  }
+}
+
+void trace_warmup::finish() {
+  if (!m_batch.empty()) dispatch();
+  stop();
+
+  // the lines touched within the window, installed in the order they were
+  // last touched so that the L2 replacement state ends up the same
+  uint64_t oldest = m_window && m_insts > m_window ? m_insts - m_window : 0;
+  std::vector<tag_line_t> lines;
+  for (const tag_array_t &tags : m_tags)
+    for (const tag_line_t &line : tags)
+      if (line.sectors && line.stamp > oldest) lines.push_back(line);
+  std::sort(lines.begin(), lines.end(),
+            [](const tag_line_t &a, const tag_line_t &b) {
+              return a.stamp < b.stamp;
+            });
+
+  for (const tag_line_t &line : lines)
+    for (unsigned i = 0; i < m_line_size / SECTOR_SIZE; ++i)
+      if (line.sectors & (1u << i)) {
+        m_gpu->perf_memcpy_to_gpu(line.block + i * SECTOR_SIZE, SECTOR_SIZE);
+        m_sectors++;
+      }
+  m_tags.clear();
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2018-2021, Mahmoud Khairy, Vijay Kandiah, Timothy Rogers, Tor
+// M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British
+// Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TRACE_WARMUP_H
+#define TRACE_WARMUP_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../ISA_Def/trace_opcode.h"
+#include "../trace-parser/trace_parser.h"
+
+class gpgpu_sim;
+struct memory_config;
+
+// Warms up the L2 with the global memory accesses of instructions that are
+// not simulated, e.g. the kernels skipped by -accelsim_fast_forward_kernel.
+//
+// Only the addresses are replayed. The sectors are streamed into a model of
+// the L2 tag arrays, which uses the configured set index function and
+// associativity with LRU replacement, without any pipeline or timing. The L2
+// sub-partitions are independent and updated by worker threads, which live
+// for the whole warm-up and replay each batch while the next one is decoded. finish() then installs the surviving
+// lines, oldest first, through the path -perf_sim_memcpy uses for memcpys.
+class trace_warmup {
+ public:
+  // Lines last touched more than window warp instructions before finish()
+  // are not installed, 0 keeps every access
+  trace_warmup(gpgpu_sim *gpu, isa_arch_t isa_arch,
+               unsigned long long window, unsigned threads);
+  ~trace_warmup();
+
+  void access(const inst_trace_t &inst, const kernel_trace_t *kernel);
+  void finish();
+
+  unsigned long long get_accesses() const { return m_accesses; }
+  unsigned long long get_sectors() const { return m_sectors; }
+
+ private:
+  struct sector_access_t {
+    uint64_t addr;
+    uint64_t stamp;
+    unsigned sub_partition;
+  };
+  struct tag_line_t {
+    uint64_t block;
+    uint64_t stamp;
+    unsigned sectors;
+  };
+  typedef std::vector<tag_line_t> tag_array_t;
+
+  bool is_global_access(const inst_trace_t &inst,
+                        const kernel_trace_t *kernel) const;
+  void dispatch();
+  void wait();
+  void stop();
+  void work(unsigned worker);
+  void replay(unsigned worker);
+
+  gpgpu_sim *m_gpu;
+  const memory_config *m_config;
+  isa_arch_t m_isa_arch;
+  unsigned long long m_window;
+
+  unsigned m_assoc;
+  unsigned m_line_size;
+  // one tag array per L2 sub-partition, set-major
+  std::vector<tag_array_t> m_tags;
+
+  // the batch being decoded and the one being replayed by the workers
+  std::vector<sector_access_t> m_batch;
+  std::vector<sector_access_t> m_replaying;
+  std::vector<std::thread> m_workers;
+  unsigned m_threads;
+  // a new batch bumps m_generation, the workers count m_busy down as they
+  // finish it
+  std::mutex m_mutex;
+  std::condition_variable m_batch_ready;
+  std::condition_variable m_batch_done;
+  uint64_t m_generation;
+  unsigned m_busy;
+  bool m_stop;
+
+  uint64_t m_insts;
+  unsigned long long m_accesses;
+  unsigned long long m_sectors;
+};
+
+#endif
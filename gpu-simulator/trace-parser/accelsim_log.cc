@@ -0,0 +1,191 @@
+// Buffered logging of the Accel-Sim front-end, see accelsim_log.h
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "accelsim_log.h"
+
+int g_accelsim_log_level = ACCELSIM_LOG_WARNING;
+
+void accelsim_log_set_level(int level) { g_accelsim_log_level = level; }
+
+namespace {
+
+const unsigned LOG_RING_SLOTS = 4096;
+const unsigned LOG_SLOT_BYTES = 240;
+
+struct log_slot_t {
+  // bounded multi-producer queue: a slot at position pos is free when its
+  // sequence is pos and holds a message when it is pos + 1
+  std::atomic<uint64_t> sequence;
+  // messages that do not fit in the slot are formatted on the heap
+  char *long_text;
+  unsigned length;
+  char text[LOG_SLOT_BYTES];
+};
+
+class log_ring_t {
+ public:
+  log_ring_t() {
+    for (unsigned i = 0; i < LOG_RING_SLOTS; ++i)
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  void push(const char *format, va_list args);
+  void flush();
+  void stop();
+
+ private:
+  void writer_loop();
+  bool write_next();
+
+  log_slot_t m_slots[LOG_RING_SLOTS];
+  std::atomic<uint64_t> m_enqueue_pos{0};
+  // only touched by the writer thread
+  uint64_t m_dequeue_pos = 0;
+  std::atomic<uint64_t> m_written{0};
+  std::atomic<bool> m_stop{false};
+
+  std::once_flag m_started;
+  std::thread m_writer;
+  pid_t m_owner = 0;
+};
+
+log_ring_t *g_log_ring = NULL;
+std::once_flag g_log_ring_created;
+
+// a forked child has no writer thread, it starts over with a ring of its own
+void restart_log_in_child() { g_log_ring = new log_ring_t(); }
+
+// created on first use and never destroyed, messages may still come from
+// other static destructors
+log_ring_t *get_log_ring() {
+  std::call_once(g_log_ring_created, []() {
+    g_log_ring = new log_ring_t();
+    pthread_atfork(NULL, NULL, restart_log_in_child);
+  });
+  return g_log_ring;
+}
+
+void stop_log_writer() { get_log_ring()->stop(); }
+
+void log_ring_t::push(const char *format, va_list args) {
+  std::call_once(m_started, [this]() {
+    m_owner = getpid();
+    m_writer = std::thread(&log_ring_t::writer_loop, this);
+    atexit(stop_log_writer);
+  });
+  if (m_stop.load(std::memory_order_acquire)) {
+    // the writer is gone once the process exits
+    vfprintf(stdout, format, args);
+    return;
+  }
+
+  log_slot_t *slot;
+  uint64_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+  while (true) {
+    slot = &m_slots[pos % LOG_RING_SLOTS];
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = (int64_t)sequence - (int64_t)pos;
+    if (diff == 0) {
+      if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed))
+        break;
+    } else {
+      // the ring is full, wait for the writer rather than drop the message
+      if (diff < 0) std::this_thread::yield();
+      pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  va_list retry;
+  va_copy(retry, args);
+  int length = vsnprintf(slot->text, LOG_SLOT_BYTES, format, args);
+  slot->long_text = NULL;
+  if (length < 0) {
+    length = 0;
+  } else if ((unsigned)length >= LOG_SLOT_BYTES) {
+    slot->long_text = (char *)malloc(length + 1);
+    vsnprintf(slot->long_text, length + 1, format, retry);
+  }
+  va_end(retry);
+  slot->length = length;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool log_ring_t::write_next() {
+  log_slot_t *slot = &m_slots[m_dequeue_pos % LOG_RING_SLOTS];
+  if (slot->sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+    return false;
+
+  if (slot->long_text) {
+    fwrite(slot->long_text, 1, slot->length, stdout);
+    free(slot->long_text);
+  } else {
+    fwrite(slot->text, 1, slot->length, stdout);
+  }
+  slot->sequence.store(m_dequeue_pos + LOG_RING_SLOTS,
+                       std::memory_order_release);
+  m_dequeue_pos++;
+  m_written.store(m_dequeue_pos, std::memory_order_release);
+  return true;
+}
+
+void log_ring_t::writer_loop() {
+  unsigned idle = 0;
+  while (true) {
+    if (write_next()) {
+      idle = 0;
+    } else if (m_stop.load(std::memory_order_acquire)) {
+      // producers are done, write whatever was queued before the stop
+      while (write_next()) {
+      }
+      break;
+    } else if (++idle < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+  }
+  fflush(stdout);
+}
+
+void log_ring_t::flush() {
+  uint64_t target = m_enqueue_pos.load(std::memory_order_acquire);
+  while (m_written.load(std::memory_order_acquire) < target &&
+         !m_stop.load(std::memory_order_acquire))
+    std::this_thread::yield();
+  fflush(stdout);
+}
+
+void log_ring_t::stop() {
+  // forked processes inherit the handler but not the writer thread
+  if (getpid() != m_owner || !m_writer.joinable()) return;
+  m_stop.store(true, std::memory_order_release);
+  m_writer.join();
+}
+
+}  // namespace
+
+void accelsim_log_write(int level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  if (level <= ACCELSIM_LOG_WARNING) {
+    get_log_ring()->flush();
+    vfprintf(stdout, format, args);
+    fflush(stdout);
+  } else {
+    get_log_ring()->push(format, args);
+  }
+  va_end(args);
+}
+
+void accelsim_log_flush() { get_log_ring()->flush(); }
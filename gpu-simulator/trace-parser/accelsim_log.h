@@ -0,0 +1,50 @@
+// Buffered logging of the Accel-Sim front-end
+//
+// Informational messages are formatted straight into a slot of a lock-free
+// ring and written to stdout by a background thread, so the simulation
+// thread neither flushes nor blocks on the terminal or a network file system.
+// Errors and warnings are written synchronously, after everything queued
+// before them, since they are usually followed by an exit.
+//
+// A forked child starts with an empty queue of its own, flush before forking
+// to keep the messages queued so far.
+//
+// The runtime level is set with -accelsim_log_level, messages above
+// ACCELSIM_LOG_MAX_LEVEL are compiled out entirely.
+
+#ifndef ACCELSIM_LOG_H
+#define ACCELSIM_LOG_H
+
+enum accelsim_log_level_t {
+  // always printed
+  ACCELSIM_LOG_ERROR = 0,
+  ACCELSIM_LOG_WARNING,
+  // progress of the simulation, once per command of the kernelslist
+  ACCELSIM_LOG_INFO,
+  // trace contents, down to once per thread block
+  ACCELSIM_LOG_DEBUG,
+};
+
+#ifndef ACCELSIM_LOG_MAX_LEVEL
+#define ACCELSIM_LOG_MAX_LEVEL ACCELSIM_LOG_DEBUG
+#endif
+
+extern int g_accelsim_log_level;
+
+void accelsim_log_set_level(int level);
+
+void accelsim_log_write(int level, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Waits until every queued message is written out and flushes stdout, so
+// that the log stays ordered with what the simulator prints directly
+void accelsim_log_flush();
+
+#define ACCELSIM_LOG(level, ...)                                      \
+  do {                                                                \
+    if ((level) <= ACCELSIM_LOG_MAX_LEVEL &&                          \
+        (level) <= g_accelsim_log_level)                              \
+      accelsim_log_write((level), __VA_ARGS__);                       \
+  } while (0)
+
+#endif
@@ -12,9 +12,13 @@
 #include <vector>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <ext/stdio_filebuf.h>
 
+#include "accelsim_log.h"
 #include "trace_parser.h"
 
 bool is_number(const std::string &s) {
@@ -57,11 +61,13 @@ bool inst_trace_t::check_opcode_contain(const std::vector<std::string> &opcode,
 }
 
 std::vector<std::string> inst_trace_t::get_opcode_tokens() const {
-  std::istringstream iss(opcode);
   std::vector<std::string> opcode_tokens;
-  std::string token;
-  while (std::getline(iss, token, '.')) {
-    if (!token.empty()) opcode_tokens.push_back(token);
+  size_t start = 0;
+  while (start < opcode.size()) {
+    size_t end = opcode.find('.', start);
+    if (end == std::string::npos) end = opcode.size();
+    if (end > start) opcode_tokens.push_back(opcode.substr(start, end - start));
+    start = end + 1;
   }
   return opcode_tokens;
 }
@@ -131,53 +137,102 @@ void inst_memadd_info_t::base_delta_decompress(
   }
 }
 
-bool inst_trace_t::parse_from_string(std::string trace, unsigned trace_version,
-                                     unsigned enable_lineinfo) {
-  std::stringstream ss;
-  ss.str(trace);
+// Cursor based readers for the fields of a trace line. They follow the
+// semantics of the istream extraction operators they replace, but avoid
+// building a stringstream per instruction, which dominated parsing time.
+static inline unsigned long long read_ull(const char *&p, int base) {
+  while (isspace(*p)) p++;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') p++;
+  if (base == 16 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+  unsigned long long v = 0;
+  for (;; p++) {
+    unsigned d;
+    if (*p >= '0' && *p <= '9')
+      d = *p - '0';
+    else if (base == 16 && *p >= 'a' && *p <= 'f')
+      d = *p - 'a' + 10;
+    else if (base == 16 && *p >= 'A' && *p <= 'F')
+      d = *p - 'A' + 10;
+    else
+      break;
+    v = v * base + d;
+  }
+  return negative ? -v : v;
+}
+
+static inline long long read_ll(const char *&p) {
+  return (long long)read_ull(p, 10);
+}
+
+static inline void read_token(const char *&p, const char *&begin,
+                              size_t &len) {
+  while (isspace(*p)) p++;
+  begin = p;
+  while (*p && !isspace(*p)) p++;
+  len = p - begin;
+}
+
+static inline void read_reg(const char *&p, unsigned &reg) {
+  const char *tok;
+  size_t len;
+  read_token(p, tok, len);
+  if (len > 1 && tok[0] == 'R' && (isdigit(tok[1]) || tok[1] == '-'))
+    reg = strtol(tok + 1, NULL, 10);
+}
 
-  std::string temp;
+// true if the first whitespace separated words of the line are first and,
+// if given, second
+static inline bool first_words_are(const std::string &line, const char *first,
+                                   const char *second = NULL) {
+  const char *p = line.c_str();
+  const char *tok;
+  size_t len;
+  read_token(p, tok, len);
+  if (len != strlen(first) || strncmp(tok, first, len) != 0) return false;
+  if (second == NULL) return true;
+  read_token(p, tok, len);
+  return len == strlen(second) && strncmp(tok, second, len) == 0;
+}
+
+bool inst_trace_t::parse_from_string(const std::string &trace,
+                                     unsigned trace_version,
+                                     unsigned enable_lineinfo) {
+  const char *p = trace.c_str();
 
   // Start Parsing
 
   if (trace_version < 3) {
     // for older trace version, read the tb ids and ignore
-    unsigned threadblock_x = 0, threadblock_y = 0, threadblock_z = 0,
-             warpid_tb = 0;
-
-    ss >> std::dec >> threadblock_x >> threadblock_y >> threadblock_z >>
-        warpid_tb;
+    for (unsigned i = 0; i < 4; ++i) read_ull(p, 10);
   }
   if (enable_lineinfo) {
-    ss >> std::dec >> line_num;
+    line_num = read_ull(p, 10);
   }
 
-  ss >> std::hex >> m_pc;
-  ss >> std::hex >> mask;
+  m_pc = read_ull(p, 16);
+  mask = read_ull(p, 16);
 
   std::bitset<WARP_SIZE> mask_bits(mask);
 
-  ss >> std::dec >> reg_dsts_num;
+  reg_dsts_num = read_ull(p, 10);
   assert(reg_dsts_num <= MAX_DST);
-  for (unsigned i = 0; i < reg_dsts_num; ++i) {
-    ss >> temp;
-    sscanf(temp.c_str(), "R%d", &reg_dest[i]);
-  }
+  for (unsigned i = 0; i < reg_dsts_num; ++i) read_reg(p, reg_dest[i]);
 
-  ss >> opcode;
+  const char *tok;
+  size_t len;
+  read_token(p, tok, len);
+  opcode.assign(tok, len);
 
-  ss >> reg_srcs_num;
+  reg_srcs_num = read_ull(p, 10);
   assert(reg_srcs_num <= MAX_SRC);
-  for (unsigned i = 0; i < reg_srcs_num; ++i) {
-    ss >> temp;
-    sscanf(temp.c_str(), "R%d", &reg_src[i]);
-  }
+  for (unsigned i = 0; i < reg_srcs_num; ++i) read_reg(p, reg_src[i]);
 
   // parse mem info
   unsigned address_mode = 0;
-  unsigned mem_width = 0;
-
-  ss >> mem_width;
+  unsigned mem_width = read_ull(p, 10);
+  // the immediate is read in whatever base the address list left the stream
+  int imm_base = 10;
 
   if (mem_width > 0)  // then it is a memory inst
   {
@@ -187,39 +242,37 @@ bool inst_trace_t::parse_from_string(std::string trace, unsigned trace_version,
     std::vector<std::string> opcode_tokens = get_opcode_tokens();
     memadd_info->width = get_datawidth_from_opcode(opcode_tokens);
 
-    ss >> std::dec >> address_mode;
+    address_mode = read_ull(p, 10);
     if (address_mode == address_format::list_all) {
       // read addresses one by one from the file
       for (int s = 0; s < WARP_SIZE; s++) {
-        if (mask_bits.test(s))
-          ss >> std::hex >> memadd_info->addrs[s];
-        else
+        if (mask_bits.test(s)) {
+          memadd_info->addrs[s] = read_ull(p, 16);
+          imm_base = 16;
+        } else
           memadd_info->addrs[s] = 0;
       }
     } else if (address_mode == address_format::base_stride) {
       // read addresses as base address and stride
-      unsigned long long base_address = 0;
-      int stride = 0;
-      ss >> std::hex >> base_address;
-      ss >> std::dec >> stride;
+      unsigned long long base_address = read_ull(p, 16);
+      int stride = read_ll(p);
       memadd_info->base_stride_decompress(base_address, stride, mask_bits);
     } else if (address_mode == address_format::base_delta) {
-      unsigned long long base_address = 0;
       std::vector<long long> deltas;
       // read addresses as base address and deltas
-      ss >> std::hex >> base_address;
+      unsigned long long base_address = read_ull(p, 16);
+      imm_base = 16;
       for (int s = 0; s < WARP_SIZE; s++) {
         if (mask_bits.test(s)) {
-          long long delta = 0;
-          ss >> std::dec >> delta;
-          deltas.push_back(delta);
+          deltas.push_back(read_ll(p));
+          imm_base = 10;
         }
       }
       memadd_info->base_delta_decompress(base_address, deltas, mask_bits);
     }
   }
 
-  ss >> imm;
+  imm = read_ull(p, imm_base);
 
   // Finish Parsing
 
@@ -235,7 +288,8 @@ std::vector<trace_command> trace_parser::parse_commandlist_file() {
   fs.open(kernellist_filename);
 
   if (!fs.is_open()) {
-    std::cout << "Unable to open file: " << kernellist_filename << std::endl;
+    ACCELSIM_LOG(ACCELSIM_LOG_ERROR, "Unable to open file: %s\n",
+                 kernellist_filename.c_str());
     exit(1);
   }
 
@@ -284,7 +338,7 @@ void trace_parser::parse_memcpy_info(const std::string &memcpy_command,
 }
 
 kernel_trace_t *trace_parser::parse_kernel_info(
-    const std::string &kerneltraces_filepath) {
+    const std::string &kerneltraces_filepath, bool private_stream) {
   kernel_trace_t *kernel_info = new kernel_trace_t;
   kernel_info->enable_lineinfo = 0;  // default disabled
 
@@ -305,8 +359,11 @@ kernel_trace_t *trace_parser::parse_kernel_info(
   // Create an interprocess channel, and fork out a data source process. The
   // data source process reads trace from disk, write to the channel, and the
   // simulator process read from the channel.
+  // Private streams may be opened concurrently from several threads, so their
+  // pipes must not leak into the reader processes forked for other kernels,
+  // otherwise those would hold the write end open and delay EOF.
   int *pipefd = kernel_info->pipefd;
-  if (pipe(pipefd) != 0) {
+  if ((private_stream ? pipe2(pipefd, O_CLOEXEC) : pipe(pipefd)) != 0) {
     std::cerr << "Failed to create interprocess channel\n";
     perror("pipe");
     exit(1);
@@ -329,24 +386,32 @@ kernel_trace_t *trace_parser::parse_kernel_info(
     execle("/bin/sh", "sh", "-c", read_trace_cmd.c_str(), NULL, environ);
     perror("execle");  // the child process shouldn't reach here if all is well.
     exit(1);
+  } else if (private_stream) {
+    close(pipefd[1]);
+    kernel_info->private_stream = true;
+    kernel_info->reader_pid = pid;
+    kernel_info->ifs = new std::istream(
+        new __gnu_cxx::stdio_filebuf<char>(pipefd[0], std::ios::in, 1 << 16));
   } else {
     // parent (simulator)
     close(pipefd[1]);
     dup2(pipefd[0], STDIN_FILENO);
+    kernel_info->ifs = &std::cin;
   }
 
   // Parent continues from here.
-  kernel_info->ifs = &std::cin;
   std::istream *ifs = kernel_info->ifs;
 
-  std::cout << "Processing kernel " << kerneltraces_filepath << std::endl;
+  if (m_verbose)
+    ACCELSIM_LOG(ACCELSIM_LOG_INFO, "Processing kernel %s\n",
+                 kerneltraces_filepath.c_str());
 
   std::string line;
 
   // Important to clear the istream. Otherwise, the eofbit from the last
   // kernel may be carried over to this kernel
   ifs->clear();
-  clearerr(stdin);
+  if (!private_stream) clearerr(stdin);
   while (!ifs->eof()) {
     getline(*ifs, line);
 
@@ -405,7 +470,7 @@ kernel_trace_t *trace_parser::parse_kernel_info(
         ss.str(line.substr(equal_idx + 1));
         ss >> std::hex >> kernel_info->local_base_addr;
       }
-      std::cout << line << std::endl;
+      if (m_verbose) ACCELSIM_LOG(ACCELSIM_LOG_DEBUG, "%s\n", line.c_str());
       continue;
     }
   }
@@ -414,6 +479,37 @@ kernel_trace_t *trace_parser::parse_kernel_info(
   return kernel_info;
 }
 
+unsigned trace_parser::parse_binary_version(
+    const std::string &kerneltraces_filepath) {
+  unsigned binary_version = 0;
+  int _l = kerneltraces_filepath.length();
+  if (_l > 3 && kerneltraces_filepath.substr(_l - 3, 3) == ".xz") {
+    // only the header is read, the reader process gets SIGPIPE once the pipe
+    // is closed
+    std::string read_trace_cmd = "xz -dc " + kerneltraces_filepath;
+    FILE *fp = popen(read_trace_cmd.c_str(), "r");
+    if (fp == NULL) return 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    while (getline(&line, &line_size, fp) != -1) {
+      if (line[0] == '#') break;  // the begin of the instruction stream
+      if (sscanf(line, "-binary version = %u", &binary_version) == 1) break;
+    }
+    free(line);
+    pclose(fp);
+  } else {
+    // an uncompressed header is read in place, without a reader process
+    std::ifstream fs(kerneltraces_filepath);
+    std::string line;
+    while (getline(fs, line)) {
+      if (!line.empty() && line[0] == '#') break;
+      if (sscanf(line.c_str(), "-binary version = %u", &binary_version) == 1)
+        break;
+    }
+  }
+  return binary_version;
+}
+
 void trace_parser::kernel_finalizer(kernel_trace_t *trace_info) {
   assert(trace_info);
 
@@ -421,8 +517,16 @@ void trace_parser::kernel_finalizer(kernel_trace_t *trace_info) {
   // have been automatically closed when it terminated. But the parent
   // process may read an arbitrary amount of trace files, so it has to close
   // all file descriptors.
-  close(trace_info->pipefd[0]);
-  close(trace_info->pipefd[1]);
+  if (trace_info->private_stream) {
+    // the filebuf owns the read end of the pipe and closes it on deletion
+    std::streambuf *buf = trace_info->ifs->rdbuf();
+    delete trace_info->ifs;
+    delete buf;
+    waitpid(trace_info->reader_pid, NULL, 0);
+  } else {
+    close(trace_info->pipefd[0]);
+    close(trace_info->pipefd[1]);
+  }
   delete trace_info;
 }
 
@@ -440,38 +544,33 @@ void trace_parser::get_next_threadblock_traces(
   unsigned insts_num = 0;
   unsigned inst_count = 0;
 
+  std::string line;
   while (!ifs->eof()) {
-    std::string line;
-    std::stringstream ss;
-    std::string string1, string2;
-
     getline(*ifs, line);
 
     if (line.length() == 0) {
       continue;
     } else {
-      ss.str(line);
-      ss >> string1 >> string2;
-      if (string1 == "#BEGIN_TB") {
+      if (first_words_are(line, "#BEGIN_TB")) {
         if (!start_of_tb_stream_found) {
           start_of_tb_stream_found = true;
         } else
           assert(0 &&
                  "Parsing error: thread block start before the previous one "
                  "finishes");
-      } else if (string1 == "#END_TB") {
+      } else if (first_words_are(line, "#END_TB")) {
         assert(start_of_tb_stream_found);
         break;  // end of TB stream
-      } else if (string1 == "thread" && string2 == "block") {
+      } else if (first_words_are(line, "thread", "block")) {
         assert(start_of_tb_stream_found);
         sscanf(line.c_str(), "thread block = %d,%d,%d", &block_id_x,
                &block_id_y, &block_id_z);
-        std::cout << line << std::endl;
-      } else if (string1 == "warp") {
+        if (m_verbose) ACCELSIM_LOG(ACCELSIM_LOG_DEBUG, "%s\n", line.c_str());
+      } else if (first_words_are(line, "warp")) {
         // the start of new warp stream
         assert(start_of_tb_stream_found);
         sscanf(line.c_str(), "warp = %d", &warp_id);
-      } else if (string1 == "insts") {
+      } else if (first_words_are(line, "insts")) {
         assert(start_of_tb_stream_found);
         sscanf(line.c_str(), "insts = %d", &insts_num);
         threadblock_traces[warp_id]->resize(
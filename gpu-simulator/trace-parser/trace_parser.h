@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/types.h>
+#include <bitset>
 #include <string>
 #include <vector>
 
@@ -61,7 +63,7 @@ struct inst_trace_t {
 
   inst_memadd_info_t *memadd_info;
 
-  bool parse_from_string(std::string trace, unsigned tracer_version,
+  bool parse_from_string(const std::string &trace, unsigned tracer_version,
                          unsigned enable_lineinfo);
 
   bool check_opcode_contain(const std::vector<std::string> &opcode,
@@ -100,6 +102,10 @@ struct kernel_trace_t {
   // Anonymous pipe through which the trace is transmitted from a trace reader
   // process to the simulator process
   int pipefd[2] = {};
+  // Set when ifs is a stream private to this kernel instead of stdin, in which
+  // case kernel_finalizer also frees it and reaps the reader process
+  bool private_stream = false;
+  pid_t reader_pid = 0;
 };
 
 class trace_parser {
@@ -109,7 +115,16 @@ class trace_parser {
 
   std::vector<trace_command> parse_commandlist_file();
 
-  kernel_trace_t *parse_kernel_info(const std::string &kerneltraces_filepath);
+  // By default the trace is redirected onto stdin, so only one kernel can be
+  // read at a time. With private_stream the kernel gets its own istream, which
+  // lets standalone tools read several kernels concurrently from threads.
+  kernel_trace_t *parse_kernel_info(const std::string &kerneltraces_filepath,
+                                    bool private_stream = false);
+
+  // Reads the binary version from the header of a kernel trace without
+  // setting up the trace stream, returns 0 if the trace cannot be read or
+  // its header has none
+  unsigned parse_binary_version(const std::string &kerneltraces_filepath);
 
   void parse_memcpy_info(const std::string &memcpy_command, size_t &add,
                          size_t &count);
@@ -120,8 +135,13 @@ class trace_parser {
 
   void kernel_finalizer(kernel_trace_t *trace_info);
 
+  // Log the kernel headers (info level) and thread block ids (debug level)
+  // while parsing
+  void set_verbose(bool verbose) { m_verbose = verbose; }
+
  private:
   std::string kernellist_filename;
+  bool m_verbose = true;
 };
 
 #endif
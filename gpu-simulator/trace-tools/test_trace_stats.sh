@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Runs accel-sim-trace-stats over a small post-processed trace directory and
+# checks that the tracer's stats.csv rows (named after the raw kernel-N.trace
+# files) are matched to the kernel-N.traceg(.xz) files of kernelslist.g.
+#
+# usage: test_trace_stats.sh <accel-sim-trace-stats binary>
+
+set -e
+
+TRACE_STATS=$1
+if [ ! -x "$TRACE_STATS" ]; then
+    echo "usage: $0 <accel-sim-trace-stats binary>"
+    exit 1
+fi
+
+DIR=$(mktemp -d)
+trap "rm -rf $DIR" EXIT
+
+write_kernel() {
+    cat >$DIR/kernel-$1.traceg <<EOF
+-kernel name = _Z6kernelPi
+-kernel id = $1
+-grid dim = (1,1,1)
+-block dim = (64,1,1)
+-shmem = 0
+-nregs = 16
+-binary version = 70
+-cuda stream id = 0
+-shmem base_addr = 0x00007f0000000000
+-local mem base_addr = 0x00007f1000000000
+-nvbit version = 1.5.5
+-accelsim tracer version = 4
+-enable lineinfo = 0
+
+#traces format = [line_num] PC mask dest_num [reg_dests] opcode src_num [reg_srcs] mem_width [adrrescompress?] [mem_addresses] immediate
+
+#BEGIN_TB
+
+thread block = 0,0,0
+
+warp = 0
+insts = 3
+0000 ffffffff 1 R1 IADD 2 R2 R3 0
+0010 ffffffff 0 LDG.E 1 R2 4 1 0x7f0000000000 4
+0020 ffffffff 0 EXIT 0 0
+
+warp = 1
+insts = 2
+0000 ffffffff 1 R1 IADD 2 R2 R3 0
+0020 ffffffff 0 EXIT 0 0
+
+#END_TB
+
+EOF
+}
+
+write_kernel 1
+write_kernel 2
+xz $DIR/kernel-2.traceg
+
+cat >$DIR/kernelslist.g <<EOF
+MemcpyHtoD,0x00007f0000000000,256
+kernel-1.traceg
+kernel-2.traceg.xz
+EOF
+
+cat >$DIR/stats.csv <<EOF
+kernel id, kernel mangled name, grid_dimX, grid_dimY, grid_dimZ, #blocks, block_dimX, block_dimY, block_dimZ, #threads, total_insts, total_reported_insts
+kernel-1.trace, _Z6kernelPi, 1, 1, 1, 1, 64, 1, 1, 64, 160,160
+kernel-2.trace.xz, _Z6kernelPi, 1, 1, 1, 1, 64, 1, 1, 64, 160,128
+EOF
+
+"$TRACE_STATS" -j 2 -c $DIR/out.csv $DIR/kernelslist.g >$DIR/out.txt
+
+grep -q "tracer insts = 160 (160 reported)" $DIR/out.txt
+grep -q "tracer insts = 160 (128 reported)" $DIR/out.txt
+grep -q '^kernel-1.traceg,1,.*,160,160$' $DIR/out.csv
+grep -q '^kernel-2.traceg,2,.*,160,128$' $DIR/out.csv
+echo "trace stats: tracer counts matched for all kernels"
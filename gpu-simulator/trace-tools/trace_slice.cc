@@ -0,0 +1,404 @@
+// Standalone trace slicing tool: copies a subset of the kernels of a
+// kernelslist.g, and optionally a subset of the thread blocks of each kernel,
+// into a new trace directory that can be simulated as is. Used to build small
+// but representative regression traces out of full application traces.
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../trace-parser/trace_parser.h"
+
+typedef std::vector<std::pair<unsigned long long, unsigned long long>>
+    id_list_t;
+
+struct slice_options_t {
+  bool filter_name = false;
+  std::regex kernel_name;
+  id_list_t kernel_ids;
+  id_list_t streams;
+
+  unsigned long long first_ctas = 0;
+  unsigned long long every_cta = 0;
+  id_list_t ctas;
+
+  unsigned max_warp_insts = 0;
+  bool compress = false;
+};
+
+struct kernel_slice_t {
+  std::string output_file;
+  bool kept = false;
+  unsigned long long ctas = 0, kept_ctas = 0;
+  unsigned long long insts = 0, kept_insts = 0;
+};
+
+// Parses a list of ids and inclusive ranges, e.g. "1,4,10-20"
+static bool parse_id_list(const char *arg, id_list_t &list) {
+  std::stringstream ss(arg);
+  std::string item;
+  while (getline(ss, item, ',')) {
+    unsigned long long lo, hi;
+    char extra;
+    if (sscanf(item.c_str(), "%llu-%llu%c", &lo, &hi, &extra) == 2) {
+      if (hi < lo) return false;
+    } else if (sscanf(item.c_str(), "%llu%c", &lo, &extra) == 1) {
+      hi = lo;
+    } else {
+      return false;
+    }
+    list.push_back(std::make_pair(lo, hi));
+  }
+  return !list.empty();
+}
+
+static bool in_id_list(const id_list_t &list, unsigned long long id) {
+  for (auto &range : list)
+    if (id >= range.first && id <= range.second) return true;
+  return false;
+}
+
+static bool keep_kernel(const slice_options_t &opts,
+                        const kernel_trace_t *info) {
+  if (opts.filter_name &&
+      !std::regex_search(info->kernel_name, opts.kernel_name))
+    return false;
+  if (!opts.kernel_ids.empty() &&
+      !in_id_list(opts.kernel_ids, info->kernel_id))
+    return false;
+  if (!opts.streams.empty() &&
+      !in_id_list(opts.streams, info->cuda_stream_id))
+    return false;
+  return true;
+}
+
+// CTAs are selected by their linear id in the original grid
+static bool keep_cta(const slice_options_t &opts, unsigned long long cta) {
+  if (opts.first_ctas && cta >= opts.first_ctas) return false;
+  if (opts.every_cta && cta % opts.every_cta != 0) return false;
+  if (!opts.ctas.empty() && !in_id_list(opts.ctas, cta)) return false;
+  return true;
+}
+
+// Same header as written by the tracer, with the grid flattened to the kept
+// thread blocks
+static void print_kernel_header(FILE *out, const kernel_trace_t *info,
+                                unsigned long long kept_ctas) {
+  fprintf(out, "-kernel name = %s\n", info->kernel_name.c_str());
+  fprintf(out, "-kernel id = %u\n", info->kernel_id);
+  fprintf(out, "-grid dim = (%llu,%u,%u)\n", kept_ctas, 1, 1);
+  fprintf(out, "-block dim = (%u,%u,%u)\n", info->tb_dim_x, info->tb_dim_y,
+          info->tb_dim_z);
+  fprintf(out, "-shmem = %u\n", info->shmem);
+  fprintf(out, "-nregs = %u\n", info->nregs);
+  fprintf(out, "-binary version = %u\n", info->binary_verion);
+  fprintf(out, "-cuda stream id = %llu\n", info->cuda_stream_id);
+  fprintf(out, "-shmem base_addr = 0x%016llx\n", info->shmem_base_addr);
+  fprintf(out, "-local mem base_addr = 0x%016llx\n", info->local_base_addr);
+  fprintf(out, "-nvbit version =%s\n", info->nvbit_verion.c_str());
+  fprintf(out, "-accelsim tracer version = %u\n", info->trace_verion);
+  fprintf(out, "-enable lineinfo = %u\n", info->enable_lineinfo);
+  fprintf(out, "\n");
+  fprintf(out,
+          "#traces format = [line_num] PC mask dest_num [reg_dests] opcode "
+          "src_num [reg_srcs] mem_width [adrrescompress?] [mem_addresses] "
+          "immediate\n");
+  fprintf(out, "\n");
+}
+
+// A warp cut short by the instruction cap still has to retire all its
+// threads, otherwise the simulator waits forever for the CTA to finish. The
+// threads that did not exit within the kept instructions exit right after.
+static std::string make_exit_line(const kernel_trace_t *info, unsigned warp,
+                                  unsigned pc, unsigned mask) {
+  char line[128];
+  int pos = 0;
+  if (info->trace_verion < 3)
+    pos += sprintf(line + pos, "0 0 0 %u ", warp);
+  if (info->enable_lineinfo) pos += sprintf(line + pos, "0 ");
+  sprintf(line + pos, "%04x %08x 0 EXIT 0 0 0 ", pc, mask);
+  return line;
+}
+
+static void write_warp(FILE *out, const kernel_trace_t *info,
+                       const slice_options_t &opts, unsigned warp,
+                       const std::vector<std::string> &lines,
+                       kernel_slice_t &slice) {
+  unsigned long long cta_threads =
+      (unsigned long long)info->tb_dim_x * info->tb_dim_y * info->tb_dim_z;
+  unsigned warp_threads =
+      std::min<unsigned long long>(WARP_SIZE, cta_threads - warp * WARP_SIZE);
+  unsigned warp_mask =
+      warp_threads == WARP_SIZE ? 0xffffffffu : (1u << warp_threads) - 1;
+
+  size_t keep = lines.size();
+  std::string exit_line;
+  if (opts.max_warp_insts && lines.size() > opts.max_warp_insts) {
+    keep = opts.max_warp_insts - 1;
+    unsigned exited = 0, pc = 0;
+    for (size_t i = 0; i < keep; ++i) {
+      inst_trace_t inst;
+      inst.parse_from_string(lines[i], info->trace_verion,
+                             info->enable_lineinfo);
+      if (inst.opcode.compare(0, 4, "EXIT") == 0) exited |= inst.mask;
+      pc = inst.m_pc;
+    }
+    if (warp_mask & ~exited)
+      exit_line = make_exit_line(info, warp, pc + 0x10, warp_mask & ~exited);
+  }
+
+  fprintf(out, "warp = %u\n", warp);
+  fprintf(out, "insts = %zu\n", keep + (exit_line.empty() ? 0 : 1));
+  for (size_t i = 0; i < keep; ++i) fprintf(out, "%s\n", lines[i].c_str());
+  if (!exit_line.empty()) fprintf(out, "%s\n", exit_line.c_str());
+  fprintf(out, "\n");
+  slice.kept_insts += keep + (exit_line.empty() ? 0 : 1);
+}
+
+static std::string basename_of(const std::string &path) {
+  return path.substr(path.rfind('/') + 1);
+}
+
+static bool is_xz(const std::string &path) {
+  return path.size() > 3 && path.substr(path.size() - 3) == ".xz";
+}
+
+static void slice_kernel(const std::string &trace_file,
+                         const std::string &output_dir,
+                         const slice_options_t &opts, kernel_slice_t &slice) {
+  trace_parser parser;
+  parser.set_verbose(false);
+  kernel_trace_t *info = parser.parse_kernel_info(trace_file, true);
+
+  if (!keep_kernel(opts, info)) {
+    parser.kernel_finalizer(info);
+    return;
+  }
+
+  unsigned long long grid_ctas = (unsigned long long)info->grid_dim_x *
+                                 info->grid_dim_y * info->grid_dim_z;
+  unsigned long long kept_ctas = 0;
+  for (unsigned long long cta = 0; cta < grid_ctas; ++cta)
+    if (keep_cta(opts, cta)) kept_ctas++;
+  if (kept_ctas == 0) {
+    std::cerr << "WARNING: no thread block of " << trace_file
+              << " is selected, dropping the kernel\n";
+    parser.kernel_finalizer(info);
+    return;
+  }
+
+  std::string name = basename_of(trace_file);
+  if (opts.compress && !is_xz(name)) name += ".xz";
+  slice.output_file = name;
+  std::string output_path = output_dir + "/" + name;
+  FILE *out = is_xz(name)
+                  ? popen(("xz -1 -T0 > " + output_path).c_str(), "w")
+                  : fopen(output_path.c_str(), "w");
+  if (!out) {
+    std::cerr << "Unable to write " << output_path << "\n";
+    exit(1);
+  }
+  print_kernel_header(out, info, kept_ctas);
+
+  // Thread blocks are copied line by line, except for their id that is
+  // renumbered to match the flattened grid, and the warps that are cut to the
+  // instruction cap
+  std::istream *ifs = info->ifs;
+  std::string line;
+  bool keep = false;
+  unsigned warp = 0;
+  unsigned long long insts_left = 0;
+  std::vector<std::string> warp_lines;
+  while (getline(*ifs, line)) {
+    if (line.empty()) continue;
+    if (insts_left) {
+      slice.insts++;
+      if (keep) warp_lines.push_back(line);
+      if (--insts_left == 0 && keep)
+        write_warp(out, info, opts, warp, warp_lines, slice);
+    } else if (line.compare(0, 9, "#BEGIN_TB") == 0) {
+      keep = false;
+    } else if (line.compare(0, 12, "thread block") == 0) {
+      unsigned x = 0, y = 0, z = 0;
+      sscanf(line.c_str(), "thread block = %u,%u,%u", &x, &y, &z);
+      unsigned long long cta =
+          x + (unsigned long long)info->grid_dim_x * (y + info->grid_dim_y * z);
+      slice.ctas++;
+      keep = keep_cta(opts, cta);
+      if (keep) {
+        fprintf(out, "#BEGIN_TB\n\nthread block = %llu,0,0\n\n",
+                slice.kept_ctas++);
+      }
+    } else if (line.compare(0, 4, "warp") == 0) {
+      sscanf(line.c_str(), "warp = %u", &warp);
+    } else if (line.compare(0, 5, "insts") == 0) {
+      sscanf(line.c_str(), "insts = %llu", &insts_left);
+      warp_lines.clear();
+      if (insts_left == 0 && keep)
+        write_warp(out, info, opts, warp, warp_lines, slice);
+    } else if (line.compare(0, 7, "#END_TB") == 0) {
+      if (keep) fprintf(out, "#END_TB\n\n");
+      keep = false;
+    }
+  }
+  parser.kernel_finalizer(info);
+
+  if ((is_xz(name) ? pclose(out) : fclose(out)) != 0) {
+    std::cerr << "Failed to write " << output_path << "\n";
+    exit(1);
+  }
+  if (slice.kept_ctas != kept_ctas)
+    std::cerr << "WARNING: " << trace_file << " only has " << slice.kept_ctas
+              << " of the " << kept_ctas << " selected thread blocks\n";
+  slice.kept = true;
+}
+
+static void usage(const char *prog) {
+  std::cerr
+      << "Usage: " << prog << " [options] <kernelslist.g> <output dir>\n"
+      << "Kernel selection (all given filters must match):\n"
+      << "  -n, --kernel-name REGEX   kernels whose name matches REGEX\n"
+      << "  -k, --kernel-id LIST      kernel ids, e.g. 1,4,10-20\n"
+      << "  -s, --stream LIST         cuda stream ids\n"
+      << "Thread block selection, by linear id in the grid:\n"
+      << "  -f, --first-ctas N        the first N thread blocks\n"
+      << "  -e, --every-cta K         every K-th thread block, from the first\n"
+      << "  -c, --ctas LIST           the listed thread blocks\n"
+      << "Other options:\n"
+      << "  -i, --max-warp-insts N    cut every warp to N instructions\n"
+      << "  -z, --xz                  xz compress the output traces\n"
+      << "  -j, --jobs N              kernels processed in parallel (default: "
+         "all cores)\n";
+}
+
+int main(int argc, char **argv) {
+  slice_options_t opts;
+  unsigned jobs = 0;
+
+  static struct option long_options[] = {
+      {"kernel-name", required_argument, 0, 'n'},
+      {"kernel-id", required_argument, 0, 'k'},
+      {"stream", required_argument, 0, 's'},
+      {"first-ctas", required_argument, 0, 'f'},
+      {"every-cta", required_argument, 0, 'e'},
+      {"ctas", required_argument, 0, 'c'},
+      {"max-warp-insts", required_argument, 0, 'i'},
+      {"xz", no_argument, 0, 'z'},
+      {"jobs", required_argument, 0, 'j'},
+      {"help", no_argument, 0, 'h'},
+      {0, 0, 0, 0}};
+  int opt;
+  bool bad_arg = false;
+  while ((opt = getopt_long(argc, argv, "n:k:s:f:e:c:i:zj:h", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+      case 'n':
+        try {
+          opts.kernel_name = std::regex(optarg, std::regex::extended);
+          opts.filter_name = true;
+        } catch (const std::regex_error &e) {
+          std::cerr << "Invalid kernel name regex: " << optarg << "\n";
+          return 1;
+        }
+        break;
+      case 'k':
+        bad_arg |= !parse_id_list(optarg, opts.kernel_ids);
+        break;
+      case 's':
+        bad_arg |= !parse_id_list(optarg, opts.streams);
+        break;
+      case 'f':
+        opts.first_ctas = strtoull(optarg, NULL, 10);
+        bad_arg |= opts.first_ctas == 0;
+        break;
+      case 'e':
+        opts.every_cta = strtoull(optarg, NULL, 10);
+        bad_arg |= opts.every_cta == 0;
+        break;
+      case 'c':
+        bad_arg |= !parse_id_list(optarg, opts.ctas);
+        break;
+      case 'i':
+        opts.max_warp_insts = atoi(optarg);
+        bad_arg |= opts.max_warp_insts < 2;
+        break;
+      case 'z':
+        opts.compress = true;
+        break;
+      case 'j':
+        jobs = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (bad_arg || optind != argc - 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  std::string kernelslist = argv[optind];
+  std::string output_dir = argv[optind + 1];
+  if (mkdir(output_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    perror(output_dir.c_str());
+    return 1;
+  }
+
+  trace_parser tracer(kernelslist.c_str());
+  std::vector<trace_command> commandlist = tracer.parse_commandlist_file();
+  std::vector<size_t> kernels;
+  for (size_t i = 0; i < commandlist.size(); ++i)
+    if (commandlist[i].m_type == command_type::kernel_launch)
+      kernels.push_back(i);
+
+  std::vector<kernel_slice_t> slices(kernels.size());
+  std::atomic<size_t> next_kernel(0);
+  auto worker = [&]() {
+    for (size_t k = next_kernel++; k < kernels.size(); k = next_kernel++)
+      slice_kernel(commandlist[kernels[k]].command_string, output_dir, opts,
+                   slices[k]);
+  };
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < std::min<size_t>(jobs, kernels.size()); ++i)
+    workers.emplace_back(worker);
+  for (auto &t : workers) t.join();
+
+  // The memory copies are all kept, the kernels that are left may depend on
+  // the data of any of them
+  std::ofstream list(output_dir + "/kernelslist.g");
+  size_t k = 0, kept_kernels = 0;
+  for (size_t i = 0; i < commandlist.size(); ++i) {
+    if (commandlist[i].m_type != command_type::kernel_launch) {
+      list << commandlist[i].command_string << "\n";
+      continue;
+    }
+    const kernel_slice_t &slice = slices[k++];
+    if (!slice.kept) continue;
+    list << slice.output_file << "\n";
+    kept_kernels++;
+    printf("%s: %llu/%llu thread blocks, %llu/%llu warp insts\n",
+           slice.output_file.c_str(), slice.kept_ctas, slice.ctas,
+           slice.kept_insts, slice.insts);
+  }
+  list.close();
+  if (!list) {
+    std::cerr << "Failed to write " << output_dir << "/kernelslist.g\n";
+    return 1;
+  }
+  printf("Kept %zu of %zu kernels in %s\n", kept_kernels, kernels.size(),
+         output_dir.c_str());
+  return 0;
+}
@@ -0,0 +1,582 @@
+// Standalone trace inspection tool: streams the kernels of a kernelslist.g
+// through the trace parser, several kernels at a time, and reports for each one
+// its instruction mix, SIMD efficiency, memory coalescing, address strides and
+// unique cache line footprint, without running the performance model.
+
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../ISA_Def/trace_opcode.h"
+#include "../trace-parser/trace_parser.h"
+
+#define HLL_PRECISION 14
+// Strides that are not the same between all the active lanes of a warp
+#define IRREGULAR_STRIDE INT64_MIN
+
+// HyperLogLog cardinality sketch, used to estimate the number of unique cache
+// lines and sectors touched by a kernel in 16KB of memory whatever its size.
+// Sketches of different kernels merge losslessly into the workload footprint.
+class hyperloglog {
+ public:
+  hyperloglog() : m_registers(1 << HLL_PRECISION, 0) {}
+
+  void add(uint64_t key) {
+    uint64_t h = mix(key);
+    unsigned idx = h >> (64 - HLL_PRECISION);
+    uint64_t w = (h << HLL_PRECISION) | (1ull << (HLL_PRECISION - 1));
+    uint8_t rank = __builtin_clzll(w) + 1;
+    if (rank > m_registers[idx]) m_registers[idx] = rank;
+  }
+
+  void merge(const hyperloglog &other) {
+    for (unsigned i = 0; i < m_registers.size(); ++i)
+      m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+  }
+
+  double estimate() const {
+    const double m = m_registers.size();
+    double sum = 0;
+    unsigned zeros = 0;
+    for (uint8_t r : m_registers) {
+      sum += ldexp(1.0, -r);
+      if (r == 0) zeros++;
+    }
+    double e = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    // small cardinalities are better estimated by linear counting
+    if (e <= 2.5 * m && zeros) e = m * log(m / zeros);
+    return e;
+  }
+
+ private:
+  static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+  }
+
+  std::vector<uint8_t> m_registers;
+};
+
+struct kernel_stats_t {
+  std::string trace_file;
+  std::string kernel_name;
+  unsigned kernel_id = 0;
+  unsigned long long cuda_stream_id = 0;
+  unsigned binary_version = 0;
+  unsigned grid_dim[3] = {};
+  unsigned tb_dim[3] = {};
+
+  unsigned long long ctas = 0;
+  unsigned long long warps = 0;
+  unsigned long long warp_insts = 0;
+  unsigned long long thread_insts = 0;
+  unsigned long long unknown_opcodes = 0;
+  std::unordered_map<std::string, unsigned long long> opcodes;
+  // number of active lanes per warp instruction, 0..32
+  unsigned long long active_lanes[WARP_SIZE + 1] = {};
+
+  unsigned long long global_reqs = 0;
+  unsigned long long local_reqs = 0;
+  unsigned long long shared_reqs = 0;
+  unsigned long long global_sectors = 0;
+  std::map<long long, unsigned long long> strides;
+  hyperloglog lines;
+  hyperloglog sectors;
+
+  // per-kernel counts recorded by the tracer in stats.csv, if available
+  long long tracer_total_insts = -1;
+  long long tracer_reported_insts = -1;
+};
+
+// the definition of an opcode mnemonic in the ISA of the trace, NULL if the
+// mnemonic or the binary version is unknown
+static const isa_opcode_def_t *find_opcode(const std::string &base_opcode,
+                                           unsigned binary_version) {
+  const isa_arch_def_t *arch = isa_find_arch(binary_version);
+  if (arch == NULL) return NULL;
+  const isa_opcode_def_t *def =
+      isa_find_opcode(base_opcode.c_str(), base_opcode.size());
+  if (def == NULL || def->opcode[arch->isa] == 0) return NULL;
+  return def;
+}
+
+static const char *opcode_category_name(unsigned category) {
+  switch (category) {
+    case ALU_OP:
+      return "ALU";
+    case SP_OP:
+      return "SP";
+    case DP_OP:
+      return "DP";
+    case INTP_OP:
+      return "INT";
+    case SFU_OP:
+      return "SFU";
+    case LOAD_OP:
+      return "LOAD";
+    case STORE_OP:
+      return "STORE";
+    case BRANCH_OP:
+      return "BRANCH";
+    case CALL_OPS:
+      return "CALL";
+    case RET_OPS:
+      return "RET";
+    case EXIT_OPS:
+      return "EXIT";
+    case BARRIER_OP:
+      return "BARRIER";
+    case MEMORY_BARRIER_OP:
+      return "MEMBAR";
+    case SPECIALIZED_UNIT_1_OP:
+      return "SPEC_UNIT_1";
+    case SPECIALIZED_UNIT_2_OP:
+      return "SPEC_UNIT_2";
+    case SPECIALIZED_UNIT_3_OP:
+      return "SPEC_UNIT_3";
+    case SPECIALIZED_UNIT_4_OP:
+      return "SPEC_UNIT_4";
+    default:
+      return "OTHER";
+  }
+}
+
+static void add_memory_inst(kernel_stats_t &stats, const inst_trace_t &inst,
+                            const std::string &base_opcode) {
+  if (base_opcode == "LDS" || base_opcode == "STS" || base_opcode == "ATOMS" ||
+      base_opcode == "LDSM") {
+    // shared memory is a scratchpad, it has no cache footprint
+    stats.shared_reqs++;
+    return;
+  }
+  if (base_opcode == "LDL" || base_opcode == "STL")
+    stats.local_reqs++;
+  else
+    stats.global_reqs++;
+
+  const inst_memadd_info_t *mem = inst.memadd_info;
+  unsigned width = mem->width > 0 ? mem->width : 1;
+  uint64_t req_sectors[2 * WARP_SIZE];
+  unsigned num_sectors = 0;
+  long long stride = 0;
+  bool have_stride = false;
+  int prev_lane = -1;
+  for (unsigned s = 0; s < WARP_SIZE; ++s) {
+    if (!(inst.mask & (1u << s))) continue;
+    uint64_t addr = mem->addrs[s];
+    uint64_t first = addr >> 5, last = (addr + width - 1) >> 5;
+    // neighbouring lanes mostly hit the same line, only hash the changes
+    uint64_t prev = num_sectors ? req_sectors[num_sectors - 1] : ~0ull;
+    if (first != prev) {
+      if ((first >> 2) != (prev >> 2)) stats.lines.add(first >> 2);
+      stats.sectors.add(first);
+    }
+    req_sectors[num_sectors++] = first;
+    if (last != first) {
+      if ((last >> 2) != (first >> 2)) stats.lines.add(last >> 2);
+      stats.sectors.add(last);
+      req_sectors[num_sectors++] = last;
+    }
+
+    // stride between consecutive active lanes, as the tracer compresses them
+    if (prev_lane >= 0) {
+      long long delta = (long long)(addr - mem->addrs[prev_lane]);
+      if (!have_stride)
+        stride = delta;
+      else if (stride != delta)
+        stride = IRREGULAR_STRIDE;
+      have_stride = true;
+    }
+    prev_lane = s;
+  }
+  if (num_sectors == 0) return;
+
+  std::sort(req_sectors, req_sectors + num_sectors);
+  unsigned unique_sectors =
+      std::unique(req_sectors, req_sectors + num_sectors) - req_sectors;
+  stats.global_sectors += unique_sectors;
+  if (have_stride) stats.strides[stride]++;
+}
+
+static void process_kernel(const std::string &trace_file,
+                           kernel_stats_t &stats) {
+  trace_parser parser;
+  parser.set_verbose(false);
+  kernel_trace_t *info = parser.parse_kernel_info(trace_file, true);
+
+  stats.trace_file = trace_file;
+  stats.kernel_name = info->kernel_name;
+  stats.kernel_id = info->kernel_id;
+  stats.cuda_stream_id = info->cuda_stream_id;
+  stats.binary_version = info->binary_verion;
+  stats.grid_dim[0] = info->grid_dim_x;
+  stats.grid_dim[1] = info->grid_dim_y;
+  stats.grid_dim[2] = info->grid_dim_z;
+  stats.tb_dim[0] = info->tb_dim_x;
+  stats.tb_dim[1] = info->tb_dim_y;
+  stats.tb_dim[2] = info->tb_dim_z;
+
+  unsigned long long num_ctas = (unsigned long long)info->grid_dim_x *
+                                info->grid_dim_y * info->grid_dim_z;
+  unsigned warps_per_cta =
+      (info->tb_dim_x * info->tb_dim_y * info->tb_dim_z + WARP_SIZE - 1) /
+      WARP_SIZE;
+
+  std::vector<std::vector<inst_trace_t>> warp_storage(warps_per_cta);
+  std::vector<std::vector<inst_trace_t> *> threadblock_traces;
+  for (auto &warp : warp_storage) threadblock_traces.push_back(&warp);
+
+  for (unsigned long long cta = 0; cta < num_ctas; ++cta) {
+    parser.get_next_threadblock_traces(threadblock_traces, info->trace_verion,
+                                       info->enable_lineinfo, info->ifs);
+    bool empty = true;
+    for (auto &warp : warp_storage) {
+      if (warp.empty()) continue;
+      empty = false;
+      stats.warps++;
+      for (const inst_trace_t &inst : warp) {
+        std::string base_opcode = inst.opcode.substr(0, inst.opcode.find('.'));
+        unsigned active = __builtin_popcount(inst.mask);
+        stats.warp_insts++;
+        stats.thread_insts += active;
+        stats.active_lanes[active]++;
+        stats.opcodes[base_opcode]++;
+        if (!find_opcode(base_opcode, info->binary_verion))
+          stats.unknown_opcodes++;
+        if (inst.memadd_info) add_memory_inst(stats, inst, base_opcode);
+      }
+    }
+    // the tracer may not have recorded every thread block of the grid
+    if (empty) break;
+    stats.ctas++;
+  }
+
+  parser.kernel_finalizer(info);
+}
+
+static std::string basename_of(const std::string &path) {
+  std::string name = path.substr(path.rfind('/') + 1);
+  if (name.size() > 3 && name.substr(name.size() - 3) == ".xz")
+    name = name.substr(0, name.size() - 3);
+  return name;
+}
+
+// The tracer names a kernel's stats.csv row after the file it wrote
+// (kernel-N.trace, .traceg when grouping per block, plus .xz), while the
+// kernelslist.g we read lists the post-processed kernel-N.traceg(.xz).
+// Both sides are reduced to kernel-N.trace before they are matched.
+static std::string tracer_stats_key(const std::string &path) {
+  std::string name = basename_of(path);
+  if (name.size() > 7 && name.substr(name.size() - 7) == ".traceg")
+    name.pop_back();
+  return name;
+}
+
+// stats.csv is written by the tracer next to the kernelslist, one row per
+// kernel
+static void read_tracer_stats(
+    const std::string &stats_file,
+    std::unordered_map<std::string, std::pair<long long, long long>> &counts) {
+  std::ifstream fs(stats_file);
+  if (!fs.is_open()) return;
+  std::string line;
+  getline(fs, line);  // header
+  while (getline(fs, line)) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (getline(ss, field, ',')) {
+      size_t b = field.find_first_not_of(" \t\r");
+      size_t e = field.find_last_not_of(" \t\r");
+      fields.push_back(b == std::string::npos ? ""
+                                              : field.substr(b, e - b + 1));
+    }
+    if (fields.size() < 12) continue;
+    counts[tracer_stats_key(fields[0])] =
+        std::make_pair(atoll(fields[fields.size() - 2].c_str()),
+                       atoll(fields[fields.size() - 1].c_str()));
+  }
+}
+
+static double percent(unsigned long long part, unsigned long long total) {
+  return total ? 100.0 * part / total : 0.0;
+}
+
+static void print_kernel(std::ostream &os, const kernel_stats_t &stats,
+                         unsigned top_opcodes) {
+  os << basename_of(stats.trace_file) << ": " << stats.kernel_name << "\n";
+  os << "  id = " << stats.kernel_id << ", stream = " << stats.cuda_stream_id
+     << ", binary version = " << stats.binary_version << ", grid = ("
+     << stats.grid_dim[0] << "," << stats.grid_dim[1] << ","
+     << stats.grid_dim[2] << "), block = (" << stats.tb_dim[0] << ","
+     << stats.tb_dim[1] << "," << stats.tb_dim[2] << ")\n";
+  os << "  ctas = " << stats.ctas << ", warps = " << stats.warps
+     << ", warp insts = " << stats.warp_insts
+     << ", thread insts = " << stats.thread_insts;
+  if (stats.tracer_total_insts >= 0)
+    os << ", tracer insts = " << stats.tracer_total_insts << " ("
+       << stats.tracer_reported_insts << " reported)";
+  os << "\n";
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "  simd efficiency = %.1f%%, full warps = %.1f%%",
+           stats.warp_insts
+               ? 100.0 * stats.thread_insts / (stats.warp_insts * WARP_SIZE)
+               : 0.0,
+           percent(stats.active_lanes[WARP_SIZE], stats.warp_insts));
+  os << buf << ", active lanes:";
+  static const unsigned lane_buckets[] = {1, 8, 16, 24, 31, 32};
+  unsigned lo = 1;
+  for (unsigned hi : lane_buckets) {
+    unsigned long long n = 0;
+    for (unsigned l = lo; l <= hi; ++l) n += stats.active_lanes[l];
+    if (lo == hi)
+      snprintf(buf, sizeof(buf), " [%u] %.1f%%", hi,
+               percent(n, stats.warp_insts));
+    else
+      snprintf(buf, sizeof(buf), " [%u-%u] %.1f%%", lo, hi,
+               percent(n, stats.warp_insts));
+    os << buf;
+    lo = hi + 1;
+  }
+  os << "\n";
+
+  // opcode and unit mix
+  const isa_arch_def_t *arch = isa_find_arch(stats.binary_version);
+  std::vector<std::pair<unsigned long long, std::string>> sorted;
+  std::map<std::string, unsigned long long> categories;
+  for (auto &op : stats.opcodes) {
+    sorted.push_back(std::make_pair(op.second, op.first));
+    const char *category = "UNKNOWN";
+    const isa_opcode_def_t *def = find_opcode(op.first, stats.binary_version);
+    if (def) category = opcode_category_name(def->category[arch->isa]);
+    categories[category] += op.second;
+  }
+  std::sort(sorted.rbegin(), sorted.rend());
+  os << "  opcodes:";
+  for (unsigned i = 0; i < sorted.size() && i < top_opcodes; ++i) {
+    snprintf(buf, sizeof(buf), " %s %.1f%%", sorted[i].second.c_str(),
+             percent(sorted[i].first, stats.warp_insts));
+    os << buf;
+  }
+  if (sorted.size() > top_opcodes)
+    os << " (+" << sorted.size() - top_opcodes << " more)";
+  os << "\n  units:";
+  for (auto &cat : categories) {
+    snprintf(buf, sizeof(buf), " %s %.1f%%", cat.first.c_str(),
+             percent(cat.second, stats.warp_insts));
+    os << buf;
+  }
+  os << "\n";
+
+  // memory behaviour
+  unsigned long long cached_reqs = stats.global_reqs + stats.local_reqs;
+  snprintf(buf, sizeof(buf),
+           "  memory reqs: global = %llu, local = %llu, shared = %llu, "
+           "sectors/req = %.2f",
+           stats.global_reqs, stats.local_reqs, stats.shared_reqs,
+           cached_reqs ? (double)stats.global_sectors / cached_reqs : 0.0);
+  os << buf << "\n";
+  double lines = stats.lines.estimate(), sectors = stats.sectors.estimate();
+  snprintf(buf, sizeof(buf),
+           "  footprint: ~%.0f 128B lines (%.1f MB), ~%.0f 32B sectors "
+           "(%.1f MB)",
+           lines, lines * 128 / (1 << 20), sectors, sectors * 32 / (1 << 20));
+  os << buf << "\n";
+
+  std::vector<std::pair<unsigned long long, long long>> strides;
+  unsigned long long strided_reqs = 0;
+  for (auto &s : stats.strides) {
+    strides.push_back(std::make_pair(s.second, s.first));
+    strided_reqs += s.second;
+  }
+  std::sort(strides.rbegin(), strides.rend());
+  os << "  strides:";
+  for (unsigned i = 0; i < strides.size() && i < 6; ++i) {
+    if (strides[i].second == IRREGULAR_STRIDE)
+      snprintf(buf, sizeof(buf), " irregular %.1f%%",
+               percent(strides[i].first, strided_reqs));
+    else
+      snprintf(buf, sizeof(buf), " %lldB %.1f%%", strides[i].second,
+               percent(strides[i].first, strided_reqs));
+    os << buf;
+  }
+  os << "\n";
+  if (stats.unknown_opcodes)
+    os << "  WARNING: " << stats.unknown_opcodes
+       << " instructions are not in the ISA definition of binary version "
+       << stats.binary_version << "\n";
+  os << "\n";
+}
+
+static void print_csv_header(std::ostream &os) {
+  os << "trace,kernel id,kernel name,stream,binary version,ctas,warps,"
+        "warp insts,thread insts,simd efficiency,global reqs,local reqs,"
+        "shared reqs,sectors per req,unique lines,unique sectors,"
+        "tracer total insts,tracer reported insts\n";
+}
+
+static void print_csv(std::ostream &os, const kernel_stats_t &stats) {
+  unsigned long long cached_reqs = stats.global_reqs + stats.local_reqs;
+  os << basename_of(stats.trace_file) << "," << stats.kernel_id << ",\""
+     << stats.kernel_name << "\"," << stats.cuda_stream_id << ","
+     << stats.binary_version << "," << stats.ctas << "," << stats.warps << ","
+     << stats.warp_insts << "," << stats.thread_insts << ","
+     << (stats.warp_insts
+             ? (double)stats.thread_insts / (stats.warp_insts * WARP_SIZE)
+             : 0.0)
+     << "," << stats.global_reqs << "," << stats.local_reqs << ","
+     << stats.shared_reqs << ","
+     << (cached_reqs ? (double)stats.global_sectors / cached_reqs : 0.0) << ","
+     << (unsigned long long)stats.lines.estimate() << ","
+     << (unsigned long long)stats.sectors.estimate() << ","
+     << stats.tracer_total_insts << "," << stats.tracer_reported_insts
+     << "\n";
+}
+
+static void usage(const char *prog) {
+  std::cerr
+      << "Usage: " << prog << " [options] <kernelslist.g>\n"
+      << "  -j, --jobs N       kernels processed in parallel (default: all "
+         "cores)\n"
+      << "  -c, --csv FILE     also write one line of statistics per kernel\n"
+      << "  -t, --top N        opcodes listed per kernel (default: 10)\n"
+      << "  -s, --stats FILE   tracer stats.csv (default: next to the "
+         "kernelslist)\n";
+}
+
+int main(int argc, char **argv) {
+  unsigned jobs = 0, top_opcodes = 10;
+  std::string csv_file, stats_file;
+
+  static struct option long_options[] = {{"jobs", required_argument, 0, 'j'},
+                                         {"csv", required_argument, 0, 'c'},
+                                         {"top", required_argument, 0, 't'},
+                                         {"stats", required_argument, 0, 's'},
+                                         {"help", no_argument, 0, 'h'},
+                                         {0, 0, 0, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "j:c:t:s:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+      case 'j':
+        jobs = atoi(optarg);
+        break;
+      case 'c':
+        csv_file = optarg;
+        break;
+      case 't':
+        top_opcodes = atoi(optarg);
+        break;
+      case 's':
+        stats_file = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  std::string kernelslist = argv[optind];
+  trace_parser tracer(kernelslist.c_str());
+  std::vector<std::string> kernel_files;
+  for (const trace_command &cmd : tracer.parse_commandlist_file())
+    if (cmd.m_type == command_type::kernel_launch)
+      kernel_files.push_back(cmd.command_string);
+
+  if (stats_file.empty()) {
+    size_t last_slash_idx = kernelslist.rfind('/');
+    stats_file = (last_slash_idx == std::string::npos
+                      ? std::string(".")
+                      : kernelslist.substr(0, last_slash_idx)) +
+                 "/stats.csv";
+  }
+  std::unordered_map<std::string, std::pair<long long, long long>>
+      tracer_counts;
+  read_tracer_stats(stats_file, tracer_counts);
+
+  // Kernels are independent, so each worker pulls the next one off the list.
+  // Reports are still printed in kernelslist order as soon as the kernels
+  // before them are done.
+  std::vector<kernel_stats_t> stats(kernel_files.size());
+  std::vector<bool> done(kernel_files.size(), false);
+  std::atomic<size_t> next_kernel(0);
+  std::mutex print_mutex;
+  size_t next_print = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  auto worker = [&]() {
+    for (size_t k = next_kernel++; k < kernel_files.size();
+         k = next_kernel++) {
+      process_kernel(kernel_files[k], stats[k]);
+      auto it = tracer_counts.find(tracer_stats_key(kernel_files[k]));
+      if (it != tracer_counts.end()) {
+        stats[k].tracer_total_insts = it->second.first;
+        stats[k].tracer_reported_insts = it->second.second;
+      }
+
+      std::lock_guard<std::mutex> lock(print_mutex);
+      done[k] = true;
+      while (next_print < done.size() && done[next_print]) {
+        print_kernel(std::cout, stats[next_print], top_opcodes);
+        next_print++;
+      }
+      std::cout.flush();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < std::min<size_t>(jobs, kernel_files.size()); ++i)
+    workers.emplace_back(worker);
+  for (auto &t : workers) t.join();
+
+  // workload totals
+  hyperloglog lines, sectors;
+  unsigned long long warp_insts = 0, thread_insts = 0;
+  for (const kernel_stats_t &s : stats) {
+    lines.merge(s.lines);
+    sectors.merge(s.sectors);
+    warp_insts += s.warp_insts;
+    thread_insts += s.thread_insts;
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              start)
+                    .count();
+  printf(
+      "total: kernels = %zu, warp insts = %llu, thread insts = %llu, "
+      "footprint ~%.1f MB in 128B lines (~%.1f MB in 32B sectors)\n",
+      stats.size(), warp_insts, thread_insts,
+      lines.estimate() * 128 / (1 << 20), sectors.estimate() * 32 / (1 << 20));
+  fprintf(stderr, "Processed %llu warp insts in %.1f s (%.2f Minsts/s)\n",
+          warp_insts, secs, secs > 0 ? warp_insts / secs / 1e6 : 0.0);
+
+  if (!csv_file.empty()) {
+    std::ofstream csv(csv_file);
+    if (!csv.is_open()) {
+      std::cerr << "Unable to open " << csv_file << "\n";
+      return 1;
+    }
+    print_csv_header(csv);
+    for (const kernel_stats_t &s : stats) print_csv(csv, s);
+  }
+  return 0;
+}
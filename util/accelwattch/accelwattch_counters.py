@@ -0,0 +1,434 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+# Northwestern University, Purdue University, The University of British Columbia
+# All rights reserved.
+
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer;
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution;
+# 3. Neither the names of Northwestern University, Purdue University,
+#    The University of British Columbia nor the names of their contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+# Compact binary files of AccelWattch activity counters
+#
+# gen_sim_power_csv.py and reeval_power.py read the per-kernel power
+# components of an accelwattch_power_report.log through this module. A log is
+# parsed once and packed next to it as <name>.awc, which is what is read from
+# then on.
+#
+# An .awc file is little-endian:
+#   "AWPC", uint32 version, uint32 number of counters, uint32 number of records
+#   each counter name: uint16 length, utf-8 bytes
+#   each record name (the kernel): uint16 length, utf-8 bytes
+#   records x counters float64 values, NaN where a record has no such counter
+# A record is a kernel launch in a packed report log. Per-interval dumps use
+# one record per interval, with the interval cycles as counters.
+
+import collections
+import os
+import struct
+import sys
+from optparse import OptionParser
+
+import numpy
+
+MAGIC = b"AWPC"
+VERSION = 1
+HEADER = struct.Struct("<4sIII")
+LENGTH = struct.Struct("<H")
+
+all_configs = [
+    "volta_sass_sim",
+    "volta_sass_hw",
+    "volta_sass_hybrid",
+    "volta_ptx_sim",
+    "turing_ptx_sim",
+    "turing_sass_sim",
+    "pascal_ptx_sim",
+    "pascal_sass_sim",
+]
+
+power_counters = [
+    "IBP,",
+    "ICP,",
+    "DCP,",
+    "TCP,",
+    "CCP,",
+    "SHRDP,",
+    "RFP,",
+    "INTP,",
+    "FPUP,",
+    "DPUP,",
+    "INT_MUL24P,",
+    "INT_MUL32P,",
+    "INT_MULP,",
+    "INT_DIVP,",
+    "FP_MULP,",
+    "FP_DIVP,",
+    "FP_SQRTP,",
+    "FP_LGP,",
+    "FP_SINP,",
+    "FP_EXP,",
+    "DP_MULP,",
+    "DP_DIVP,",
+    "TENSORP,",
+    "TEXP,",
+    "SCHEDP,",
+    "L2CP,",
+    "MCP,",
+    "NOCP,",
+    "DRAMP,",
+    "PIPEP,",
+    "IDLE_COREP,",
+    "CONSTP",
+    "STATICP",
+    "kernel_avg_power",
+]
+
+# The validation kernel of each benchmark, for the first and second kernel
+# version. An empty name matches every kernel of the benchmark.
+validation_kernels = {
+    1: {
+        "backprop-rodinia-3.1": "_Z22bpnn_layerforward_CUDAPfS_S_S_ii",
+        "binomialOptions": "_Z21binomialOptionsKernelv",
+        "b+tree-rodinia-3.1": "findRangeK",
+        "dct8x8": "_Z14CUDAkernel1DCTPfiiiy",
+        "fastWalshTransform": "_Z15fwtBatch2KernelPfS_i",
+        "histogram": "_Z17histogram64KernelPjP5uint4j",
+        "hotspot-rodinia-3.1": "_Z14calculate_tempiPfS_S_iiiiffffff",
+        "kmeans-rodinia-3.1": "_Z11kmeansPointPfiiiPiS_S_S0_",
+        "mergeSort": "_Z30mergeElementaryIntervalsKernelILj1EEvPjS0_S0_S0_S0_S0_jj",
+        "pathfinder-rodinia-3.1": "_Z14dynproc_kerneliPiS_S_iiii",
+        "quasirandomGenerator": "_Z26quasirandomGeneratorKernelPfjj",
+        "sobolQRNG": "_Z15sobolGPU_kerneljjPjPf",
+        "srad_v1-rodinia-3.1": "_Z4sradfiilPiS_S_S_PfS0_S0_S0_fS0_S0_",
+        "parboil-mri-q": "_Z12ComputeQ_GPUiiPfS_S_S_S_",
+        "parboil-sad": "_Z11mb_sad_calcPtS_ii",
+        "parboil-sgemm": "_Z9mysgemmNTPKfiS0_iPfiiff",
+        "cutlass_perf_test_k1": "",
+        "cutlass_perf_test_k2": "",
+        "cutlass_perf_test_k3": "",
+        "cudaTensorCoreGemm": "",
+    },
+    2: {
+        "backprop-rodinia-3.1": "_Z24bpnn_adjust_weights_cudaPfiS_iS_S_",
+        "binomialOptions": "_Z21binomialOptionsKernelv",
+        "b+tree-rodinia-3.1": "findK",
+        "dct8x8": "_Z14CUDAkernel2DCTPfS_i",
+        "fastWalshTransform": "_Z15fwtBatch1KernelPfS_i",
+        "histogram": "_Z18histogram256KernelPjS_j",
+        "hotspot-rodinia-3.1": "_Z14calculate_tempiPfS_S_iiiiffffff",
+        "kmeans-rodinia-3.1": "_Z11kmeansPointPfiiiPiS_S_S0_",
+        "mergeSort": "_Z21mergeSortSharedKernelILj1EEvPjS0_S0_S0_j",
+        "pathfinder-rodinia-3.1": "_Z14dynproc_kerneliPiS_S_iiii",
+        "quasirandomGenerator": "_Z16inverseCNDKernelPfPjj",
+        "sobolQRNG": "_Z15sobolGPU_kerneljjPjPf",
+        "srad_v1-rodinia-3.1": "_Z4sradfiilPiS_S_S_PfS0_S0_S0_fS0_S0_",
+        "parboil-mri-q": "_Z12ComputeQ_GPUiiPfS_S_S_S_",
+        "parboil-sad": "_Z11mb_sad_calcPtS_ii",
+        "parboil-sgemm": "_Z9mysgemmNTPKfiS0_iPfiiff",
+        "cutlass_perf_test_k1": "",
+        "cutlass_perf_test_k2": "",
+        "cutlass_perf_test_k3": "",
+        "cudaTensorCoreGemm": "",
+    },
+}
+
+# Benchmarks without a second validation kernel
+single_kernel_benchmarks = [
+    "binomialOptions",
+    "hotspot-rodinia-3.1",
+    "histogram",
+    "kmeans-rodinia-3.1",
+    "pathfinder-rodinia-3.1",
+    "sobolQRNG",
+    "srad_v1-rodinia-3.1",
+    "parboil-mri-q",
+    "parboil-sad",
+    "parboil-sgemm",
+    "cutlass_perf_test_k1",
+    "cutlass_perf_test_k2",
+    "cutlass_perf_test_k3",
+    "cudaTensorCoreGemm",
+]
+
+cutlass_benchmarks = [
+    "cutlass_perf_test_k1",
+    "cutlass_perf_test_k2",
+    "cutlass_perf_test_k3",
+]
+
+# Benchmarks each config is not validated with
+excluded_benchmarks = {
+    "volta_ptx_sim": cutlass_benchmarks
+    + ["hotspot-rodinia-3.1", "pathfinder-rodinia-3.1"],
+    "turing_ptx_sim": cutlass_benchmarks
+    + ["hotspot-rodinia-3.1", "pathfinder-rodinia-3.1"],
+    "pascal_ptx_sim": cutlass_benchmarks
+    + ["hotspot-rodinia-3.1", "pathfinder-rodinia-3.1", "cudaTensorCoreGemm"],
+    "volta_sass_hw": ["pathfinder-rodinia-3.1"],
+    "volta_sass_hybrid": ["pathfinder-rodinia-3.1"],
+    "pascal_sass_sim": ["cudaTensorCoreGemm"] + cutlass_benchmarks,
+}
+
+# The names of the benchmarks in the hardware power csvs of
+# accelwattch_hw_profiler, where they differ
+hw_benchmark_names = {
+    "backprop-rodinia-3.1": "backprop",
+    "b+tree-rodinia-3.1": "btree",
+    "hotspot-rodinia-3.1": "hotspot",
+    "kmeans-rodinia-3.1": "kmeans",
+    "pathfinder-rodinia-3.1": "pathfinder",
+    "srad_v1-rodinia-3.1": "srad_v1",
+    "parboil-mri-q": "parboil_mriq",
+    "parboil-sad": "parboil_sad",
+    "parboil-sgemm": "parboil_sgemm",
+    "cutlass_perf_test_k1": "cutlass_k1",
+    "cutlass_perf_test_k2": "cutlass_k2",
+    "cutlass_perf_test_k3": "cutlass_k3",
+}
+
+
+def parse_report_log(path):
+    """Returns the (counters, kernels, values) of an accelwattch_power_report.log:
+    a record per kernel_name line, with the numeric "name = value" lines
+    that follow it."""
+    counters = []
+    index = {}
+    kernels = []
+    records = []
+    with open(path, "r") as f:
+        for line in f:
+            line = line.replace(" ", "").rstrip("\n")
+            if line.startswith("kernel_name="):
+                kernels.append(line[len("kernel_name=") :])
+                records.append({})
+                continue
+            if len(records) == 0 or "=" not in line:
+                continue
+            key, value = line.split("=", 1)
+            try:
+                value = float(value)
+            except ValueError:
+                continue
+            if key not in index:
+                index[key] = len(counters)
+                counters.append(key)
+            records[-1].setdefault(index[key], value)
+
+    values = numpy.full((len(records), len(counters)), numpy.nan)
+    for row, record in enumerate(records):
+        for column, value in record.items():
+            values[row, column] = value
+    return counters, kernels, values
+
+
+def write_counters(path, counters, kernels, values):
+    tmp_path = "{0}.tmp.{1}".format(path, os.getpid())
+    with open(tmp_path, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, len(counters), len(kernels)))
+        for name in list(counters) + list(kernels):
+            encoded = name.encode("utf-8")
+            f.write(LENGTH.pack(len(encoded)))
+            f.write(encoded)
+        f.write(numpy.asarray(values, dtype="<f8").tobytes())
+    os.rename(tmp_path, path)
+
+
+def read_counters(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, ncounters, nrecords = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("{0} is not a version {1} .awc file".format(path, VERSION))
+    offset = HEADER.size
+    names = []
+    for i in range(ncounters + nrecords):
+        (length,) = LENGTH.unpack_from(data, offset)
+        offset += LENGTH.size
+        names.append(data[offset : offset + length].decode("utf-8"))
+        offset += length
+    values = numpy.frombuffer(
+        data, dtype="<f8", count=ncounters * nrecords, offset=offset
+    ).reshape(nrecords, ncounters)
+    return names[:ncounters], names[ncounters:], values
+
+
+def load_report(basepath):
+    """Reads the counters of <basepath>.awc, packing <basepath>.log into it
+    first when the log is newer."""
+    log = basepath + ".log"
+    packed = basepath + ".awc"
+    if os.path.isfile(packed) and (
+        not os.path.isfile(log) or os.path.getmtime(packed) >= os.path.getmtime(log)
+    ):
+        return read_counters(packed)
+    counters, kernels, values = parse_report_log(log)
+    try:
+        write_counters(packed, counters, kernels, values)
+    except OSError:
+        pass
+    return counters, kernels, values
+
+
+# The benchmarks with a report log in reportspath, then those only dumped
+def report_benchmarks(reportspath):
+    filenames = os.listdir(reportspath)
+    benchmarks = [f[:-4] for f in filenames if f.endswith(".log")]
+    for filename in filenames:
+        if filename.endswith(".awc") and filename[:-4] not in benchmarks:
+            benchmarks.append(filename[:-4])
+    return benchmarks
+
+
+def power_breakdown(reportspath, config):
+    """The average power per component of each validation kernel in the
+    reports of a config, keyed by <benchmark>_k<kernel version>. Kernels that
+    were not simulated have no components."""
+    power_dict = collections.OrderedDict()
+    for kernelVer in [1, 2]:
+        kernelnames = validation_kernels[kernelVer]
+        benchmarks = report_benchmarks(reportspath)
+        excluded = excluded_benchmarks.get(config, [])
+        if kernelVer != 1:
+            excluded = excluded + single_kernel_benchmarks
+        benchmarks = [b for b in benchmarks if b not in excluded]
+
+        for benchmark in benchmarks:
+            if benchmark not in kernelnames:
+                continue
+
+            counters, kernels, values = load_report(os.path.join(reportspath, benchmark))
+            if benchmark in cutlass_benchmarks:
+                benchmark_idx = benchmark
+            else:
+                benchmark_idx = benchmark + "_k" + str(kernelVer)
+            power_dict[benchmark_idx] = collections.OrderedDict()
+
+            rows = [
+                row
+                for row, kernel in enumerate(kernels)
+                if kernel.startswith(kernelnames[benchmark])
+            ]
+            kernel_count = len(rows)
+            baseline = [0] * len(power_counters)
+            for i, each in enumerate(power_counters):
+                if kernel_count == 0:
+                    break
+                key = each if each == "kernel_avg_power" else "gpu_avg_" + each
+                if key not in counters:
+                    sys.exit(
+                        "{0} has no {1} counter".format(
+                            os.path.join(reportspath, benchmark), key
+                        )
+                    )
+                column = counters.index(key)
+                for row in rows:
+                    baseline[i] += float(values[row, column])
+
+            if kernel_count != 0:
+                breakdown = power_dict[benchmark_idx]
+                for i, each in enumerate(power_counters):
+                    breakdown[each] = float(baseline[i]) / float(kernel_count)
+                breakdown["DRAMP,"] = breakdown["DRAMP,"] + breakdown["MCP,"]
+                breakdown["L2CP,"] = breakdown["L2CP,"] + breakdown["NOCP,"]
+                if config in ["volta_ptx_sim", "turing_ptx_sim", "pascal_ptx_sim"]:
+                    # PTX model doesnt need these counters anymore
+                    unused = ["MCP,", "NOCP,"]
+                elif config in ["volta_sass_hw", "volta_sass_hybrid"]:
+                    # HW and HYBRID model doesnt need these counters anymore
+                    unused = ["ICP,", "RFP,"]
+                else:
+                    # SASS model doesnt need these counters anymore
+                    unused = [
+                        "MCP,",
+                        "TCP,",
+                        "INT_MUL24P,",
+                        "INT_MUL32P,",
+                        "INT_DIVP,",
+                        "FP_DIVP,",
+                        "DP_DIVP,",
+                        "NOCP,",
+                    ]
+                for each in unused:
+                    del breakdown[each]
+            else:
+                print(f"Warning: {benchmark_idx} has no simulator data.")
+    return power_dict
+
+
+def hw_kernel_name(benchmark_idx):
+    for benchmark, hw_name in hw_benchmark_names.items():
+        if benchmark_idx == benchmark:
+            return hw_name
+        if benchmark_idx.startswith(benchmark + "_k"):
+            return hw_name + benchmark_idx[len(benchmark) :]
+    return benchmark_idx
+
+
+def pack(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            logs = [
+                os.path.join(root, f)
+                for root, dirs, files in os.walk(path)
+                for f in files
+                if f.endswith(".log")
+            ]
+        else:
+            logs = [path]
+        for log in sorted(logs):
+            counters, kernels, values = parse_report_log(log)
+            if len(kernels) == 0:
+                continue
+            packed = os.path.splitext(log)[0] + ".awc"
+            write_counters(packed, counters, kernels, values)
+            print(
+                "{0}: {1} kernels, {2} -> {3} bytes".format(
+                    packed,
+                    len(kernels),
+                    os.path.getsize(log),
+                    os.path.getsize(packed),
+                )
+            )
+
+
+def dump(path):
+    counters, kernels, values = read_counters(path)
+    print(",".join(["kernel_name"] + counters))
+    for kernel, row in zip(kernels, values):
+        print(",".join([kernel] + [repr(float(v)) for v in row]))
+
+
+if __name__ == "__main__":
+    parser = OptionParser(
+        usage="%prog pack <report.log|directory>...\n       %prog dump <file.awc>"
+    )
+    (options, args) = parser.parse_args()
+    if len(args) >= 2 and args[0] == "pack":
+        pack(args[1:])
+    elif len(args) == 2 and args[0] == "dump":
+        dump(args[1])
+    else:
+        parser.print_usage()
+        sys.exit(1)
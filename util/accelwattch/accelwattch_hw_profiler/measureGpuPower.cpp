@@ -50,7 +50,12 @@
 #include <sys/time.h>
 #include <unistd.h>
 #include <signal.h>
-#include <nvml.h>
+#include <sched.h>
+#include <atomic>
+#include <thread>
+#include "power_source.h"
+#include "power_summary.h"
+#include "sample_buffer.h"
 
 // CTRL+C handler
 static volatile int exitFlag = 0;
@@ -59,81 +64,6 @@ void intHandler(int v)
     exitFlag = 1;
 }
 
-int init()
-{
-    printf("Initializing NVML... ");
-    nvmlReturn_t res;
-    res = nvmlInit();
-    if( res != NVML_SUCCESS ) {
-        printf("Error: failed to initialize NVML: %s\n", nvmlErrorString(res));
-        return 0;
-    }
-    printf("Success\n");
-    return 1;
-}
-
-int shutdown()
-{
-    printf("Shutting down NVML... ");
-    nvmlReturn_t res;
-    res = nvmlShutdown();
-    if( res != NVML_SUCCESS ) {
-        printf("Error: Failed to shutdown NVML: %s\n", nvmlErrorString(res));
-        return 0;
-    }
-    printf("Success\n");
-    return 1;
-}
-
-int getDevice(int devId, nvmlDevice_t* dev, nvmlUnit_t* unit)
-{
-    nvmlReturn_t res;
-    unsigned numDev = 0;
-
-    printf("Getting device... ");
-
-    res = nvmlDeviceGetCount(&numDev);
-    if( res != NVML_SUCCESS ) {
-        printf("Error: Failed to get number of devices: %s\n", nvmlErrorString(res));
-        return 0;
-    }
-
-    if( devId >= numDev ) {
-        printf("Error: Invalid device ID: %d\n", devId);
-        return 0;
-    }
-
-    char devName[NVML_DEVICE_NAME_BUFFER_SIZE];
-
-    res = nvmlDeviceGetHandleByIndex(devId, dev);
-    if( res != NVML_SUCCESS ) {
-        printf("Error: failed to get handle for device %i: %s\n", devId, nvmlErrorString(res));
-        return 0;
-    }
-
-    res = nvmlDeviceGetName(*dev, devName, NVML_DEVICE_NAME_BUFFER_SIZE);
-    if( res != NVML_SUCCESS ) {
-        printf("Error: failed to get name of device %i: %s\n", devId, nvmlErrorString(res));
-        return 0;
-    }
-
-    printf("Selected device %d: %s\n", devId, devName);
-
-#if 0
-    printf("Getting NVML Unit... ");
-    unsigned unitCount = 0;
-    nvmlUnitGetCount(&unitCount);
-    printf("%d units\n", unitCount);
-    res = nvmlUnitGetHandleByIndex( devId, unit );
-    if( res != NVML_SUCCESS ) {
-        printf("Error: failed to get unit %i: %s\n", devId, nvmlErrorString(res));
-        return 0;
-    }
-#endif
-
-    return 1;
-}
-
 int processIsAlive(int pid)
 {
 	char command[256];
@@ -154,18 +84,91 @@ int processIsAlive(int pid)
 	return 0;
 }
 
-int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sampleRate, int numSamples, nvmlUnit_t* unit, int printPsuInfo, int pid, int temp_cutoff_T)
+// Drains the samples polled by measurePower on its own thread: writes them
+// all to the samples file and summarizes those accepted since the last
+// restart of the measurement. A skipped sample splits the summary, so the
+// energy is not integrated across it.
+class SampleWriter
 {
-    nvmlReturn_t res;
-    unsigned int mWatts = 0;
-	unsigned int temperature = 0;
-    nvmlPSUInfo_t psu;
-    nvmlPstates_t pState;
+public:
+    SampleWriter(FILE* sampleFile) : m_sampleFile(sampleFile), m_done(false), m_segment(0) {}
+
+    void start()
+    {
+        m_thread = std::thread(&SampleWriter::run, this);
+    }
+
+    void push(const PowerSample& sample)
+    {
+        while( !m_buffer.push(sample) )
+            sched_yield();
+    }
+
+    // Waits for all the pushed samples to be written
+    void finish()
+    {
+        m_done.store(true, std::memory_order_release);
+        m_thread.join();
+    }
+
+    const PowerSummary& summary() const { return m_summary; }
+
+private:
+    void run()
+    {
+        PowerSample sample;
+        for( ;; ) {
+            if( m_buffer.pop(&sample) ) {
+                write(sample);
+            } else if( m_done.load(std::memory_order_acquire) ) {
+                while( m_buffer.pop(&sample) )
+                    write(sample);
+                break;
+            } else {
+                usleep(1000);
+            }
+        }
+    }
+
+    void write(const PowerSample& sample)
+    {
+        if( m_sampleFile )
+            writeSample(m_sampleFile, &sample);
+        if( sample.segment != m_segment ) {
+            m_summary.reset();
+            m_segment = sample.segment;
+        }
+        if( sample.accepted )
+            m_summary.add(sample.time, (double)sample.mWatts / 1000.0);
+        else
+            m_summary.split();
+    }
+
+    SampleBuffer<PowerSample, 4096> m_buffer;
+    FILE* m_sampleFile;
+    std::atomic<bool> m_done;
+    int m_segment;
+    PowerSummary m_summary;
+    std::thread m_thread;
+};
+
+// Fills in a sample that is only recorded, not measured
+void readRemaining(PowerSource* source, PowerSample* sample)
+{
+    source->getTemperature(&sample->temperature);
+    source->getPowerUsage(&sample->mWatts);
+    source->getPerformanceState(&sample->pState);
+}
+
+int measurePower(char* oFileName, int csv, int devId, PowerSource* source, int sampleRate, int numSamples, int printPsuInfo, int pid, int temp_cutoff_T, char* sFileName)
+{
+    int pState = 0;
     int samplesRemaining = (numSamples == -1 ? 1 : numSamples);
     double avgWatts = 0.0;
-    unsigned int sampleCount = 0;
-    FILE *f;
-    nvmlUtilization_t util;
+    int segment = 0;
+    int ok = 1;
+    FILE *f = NULL;
+    FILE *sampleFile = NULL;
     bool temp_cutoff = false;
     if( oFileName ) {
         f = fopen(oFileName, "w");
@@ -174,12 +177,30 @@ int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sam
             return 0;
         }
     }
+    if( sFileName ) {
+        sampleFile = fopen(sFileName, "w");
+        if( sampleFile == NULL ) {
+            printf("Error: failed to open file %s\n", sFileName);
+            return 0;
+        }
+        fprintf(sampleFile, "# time (s), power (mW), GPU utilization (%%), memory utilization (%%), temperature (C), pstate\n");
+    }
+    SampleWriter writer(sampleFile);
+    writer.start();
 
     printf("\n\nStarting power measurement...\n");
 
     while( samplesRemaining > 0 ) {
-        // Throttle to sample rate
-        usleep(sampleRate * 1000.0);
+        int next = source->nextSample(sampleRate);
+        if( next < 0 ) {
+            printf("Error: failed to get the next sample for device %i: %s\n", devId, source->errorString());
+            ok = 0;
+            break;
+        }
+        if( next == 0 ) {
+            printf("No more power samples. Stopping power measurement...\n");
+            break;
+        }
         //increment number of samples processed
 
 
@@ -187,9 +208,16 @@ int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sam
 			printf("Application terminated. Closing profiler...\n");
 			break;
 		}
-        res = nvmlDeviceGetUtilizationRates ( *dev, &util);
-
-        if(util.gpu < 95) {
+        PowerSample sample;
+        memset(&sample, 0, sizeof(sample));
+        sample.time = source->timestamp();
+        sample.segment = segment;
+        source->getUtilization(&sample.gpuUtil, &sample.memUtil);
+
+        if(sample.gpuUtil < 95) {
+            if( sampleFile )
+                readRemaining(source, &sample);
+            writer.push(sample);
             if (samplesRemaining >1){
                 samplesRemaining--;
                 continue;
@@ -204,37 +232,41 @@ int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sam
 
 		if (temp_cutoff_T)
 		{
-			res = nvmlDeviceGetTemperature( *dev, NVML_TEMPERATURE_GPU, &temperature );
-			if( res != NVML_SUCCESS ) {
-				printf("Error: failed to get temperature for device %i: %s\n", devId, nvmlErrorString(res));
-				return 0;
+			if( !source->getTemperature(&sample.temperature) ) {
+				printf("Error: failed to get temperature for device %i: %s\n", devId, source->errorString());
+				ok = 0;
+				break;
 			}
-			if (temperature == temp_cutoff_T) {
+			if (sample.temperature == temp_cutoff_T) {
                 temp_cutoff = true;
 				printf("Cutoff temperature %d C reached: concluding power measurements\n", temp_cutoff_T);
 				samplesRemaining = 1; // record the temperature one last time
-                avgWatts = 0.0;
-                sampleCount = 0;
+                sample.segment = ++segment;
 			}
 		}
-        res = nvmlDeviceGetPowerUsage( *dev, &mWatts );
-        if( res != NVML_SUCCESS ) {
-            printf("Error: failed to get power for device %i: %s\n", devId, nvmlErrorString(res));
-            return 0;
+        if( !source->getPowerUsage(&sample.mWatts) ) {
+            printf("Error: failed to get power for device %i: %s\n", devId, source->errorString());
+            ok = 0;
+            break;
         }
 
         if( printPsuInfo ) {
-            res = nvmlDeviceGetPerformanceState(*dev, &pState);
-            //res = nvmlUnitGetPsuInfo(*unit, &psu);
-            if( res != NVML_SUCCESS ) {
-                printf("Error: failed to get pState info for device %i: %s\n", devId, nvmlErrorString(res));
-                return 0;
+            if( !source->getPerformanceState(&pState) ) {
+                printf("Error: failed to get pState info for device %i: %s\n", devId, source->errorString());
+                ok = 0;
+                break;
             }
+            sample.pState = pState;
+        }
+        if( sampleFile ) {
+            if( !temp_cutoff_T )
+                source->getTemperature(&sample.temperature);
+            if( !printPsuInfo )
+                source->getPerformanceState(&sample.pState);
         }
 
-        double watts = (double)mWatts / 1000.0;
-        avgWatts += watts;
-        sampleCount++;
+        sample.accepted = 1;
+        writer.push(sample);
 
         if(( numSamples != -1 ) || (temp_cutoff == true))
             samplesRemaining--;
@@ -245,10 +277,17 @@ int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sam
          }
     }
 
-    if (sampleCount == 0)
-        avgWatts = 0.0;
-    else
-        avgWatts /= sampleCount;
+    writer.finish();
+    if( sampleFile )
+        fclose(sampleFile);
+    if( !ok ) {
+        if( f )
+            fclose(f);
+        return 0;
+    }
+
+    const PowerSummary& summary = writer.summary();
+    avgWatts = summary.mean();
     if( csv ) {
         if( oFileName ) {
             if( !printPsuInfo )
@@ -271,7 +310,11 @@ int measurePower(char* oFileName, int csv, int devId, nvmlDevice_t* dev, int sam
                 printf("Power draw = %.4lf W, power state = %d \n", avgWatts, pState);
         }
     }
+    if( f )
+        fclose(f);
 
+    printf("\n");
+    summary.print(stdout);
 
     if ((temp_cutoff_T) && (!temp_cutoff))
         printf("WARNING: TEMPERATURE CUTTOFF NOT REACHED \n\n");
@@ -291,16 +334,18 @@ void printHelp()
     printf("-p: \t\t\t\tPrint PSU info as well \n");
 	printf("-a: <process name>: \t\tApplication to profile with this profiler. Profiler will stop when process terminates\n");
 	printf("-t: <temp>:\t\tCutoff temperature in degrees C. Profiler will stop profiling if the GPU reaches this temperature\n");
+    printf("-s <samples file name>:\tRecord every sample with its timestamp to this file\n");
+    printf("-R <samples file name>:\tReplay the samples recorded with -s instead of reading the GPU\n");
 
     printf("\nCTRL+C will stop the power measurements and shutdown NVML\n");
     printf("=============================================================================================\n\n");
 }
 
-int parseOptions(int argc, char** argv, char** outFileName, int* csv, int* devId, int* sampleRate, int* numSamples, int* printPsuInfo, char** pname, int* temp_cutoff_T)
+int parseOptions(int argc, char** argv, char** outFileName, int* csv, int* devId, int* sampleRate, int* numSamples, int* printPsuInfo, char** pname, int* temp_cutoff_T, char** sFileName, char** replayFileName)
 {
     int opt;
     opterr = 0;
-    while( (opt = getopt(argc, argv, "ho:cd:r:n:pa:t:")) != -1 ) {
+    while( (opt = getopt(argc, argv, "ho:cd:r:n:pa:t:s:R:")) != -1 ) {
         switch(opt) {
             case 'h':
                 printHelp();
@@ -338,6 +383,14 @@ int parseOptions(int argc, char** argv, char** outFileName, int* csv, int* devId
 				*temp_cutoff_T = atoi(optarg);
 				break;
 
+            case 's':
+                *sFileName = optarg;
+                break;
+
+            case 'R':
+                *replayFileName = optarg;
+                break;
+
             default:
                 printf("Error: unknown option\n");
                 return 0;
@@ -352,17 +405,18 @@ int parseOptions(int argc, char** argv, char** outFileName, int* csv, int* devId
             "\tNumber of power samples = %d\n"
             "\tPrint PSU info = %d\n"
 			"\tProcess Name = %s\n\n"
-			"\tTemperature Cutoff (0 iff disabled) = %d\n",
-            *outFileName, *csv, *devId, *sampleRate, *numSamples, *printPsuInfo, *pname, *temp_cutoff_T);
+			"\tTemperature Cutoff (0 iff disabled) = %d\n"
+            "\tSamples File = %s\n"
+            "\tReplayed Samples File = %s\n",
+            *outFileName, *csv, *devId, *sampleRate, *numSamples, *printPsuInfo, *pname, *temp_cutoff_T,
+            *sFileName, *replayFileName);
 
     return 1;
 }
 
 int main(int argc, char** argv)
 {
-    nvmlReturn_t res;
-    nvmlDevice_t dev;
-    nvmlUnit_t unit;
+    PowerSource* source;
     int ret = 0;
 
     // Defaults
@@ -375,22 +429,35 @@ int main(int argc, char** argv)
 	char* pname = NULL;
 	int pid = 0;
 	int temp_cutoff_T = 0;
+    char* sFileName = NULL;
+    char* replayFileName = NULL;
 
     // Setup CTRL+C handler
     signal(SIGINT, intHandler);
 
-    ret = parseOptions(argc, argv, &oFileName, &csv, &devId, &sampleRate, &numSamples, &printPsuInfo, &pname, &temp_cutoff_T);
+    ret = parseOptions(argc, argv, &oFileName, &csv, &devId, &sampleRate, &numSamples, &printPsuInfo, &pname, &temp_cutoff_T, &sFileName, &replayFileName);
     if( !ret )
         return EXIT_FAILURE;
 
     if( ret == 2)
         return EXIT_SUCCESS;
 
-    if( !init() )
+    if( replayFileName ) {
+        source = new ReplayPowerSource(replayFileName);
+    } else {
+#ifndef REPLAY_ONLY
+        source = new NvmlPowerSource();
+#else
+        printf("Error: built without NVML, only samples replayed with -R can be measured\n");
+        return EXIT_FAILURE;
+#endif
+    }
+
+    if( !source->init() )
         return EXIT_FAILURE;
 
-    if( !getDevice(devId, &dev, &unit) ) {
-        shutdown();
+    if( !source->getDevice(devId) ) {
+        source->shutdown();
         return EXIT_FAILURE;
     }
 
@@ -412,7 +479,7 @@ int main(int argc, char** argv)
 		if( f == NULL ) {
 			printf("Error: failed to run ps command.\n");
 			pclose(f);
-			shutdown();
+			source->shutdown();
 			return EXIT_FAILURE;
 		}
 		char line[8];
@@ -421,19 +488,20 @@ int main(int argc, char** argv)
 		} else {
 			pclose(f);
 			printf("Error: application not found in process list. Make sure to start application before profiling!\n");
-			shutdown();
+			source->shutdown();
 			return EXIT_FAILURE;
 		}
 		pclose(f);
 		printf("Got the pid\n");
 	}
 
-    if( !measurePower(oFileName, csv, devId, &dev, sampleRate, numSamples, &unit, printPsuInfo, pid, temp_cutoff_T) ) {
-        shutdown();
+    if( !measurePower(oFileName, csv, devId, source, sampleRate, numSamples, printPsuInfo, pid, temp_cutoff_T, sFileName) ) {
+        source->shutdown();
         return EXIT_FAILURE;
     }
 
-    shutdown();
+    source->shutdown();
+    delete source;
 
     printf("Complete \n");
 
@@ -0,0 +1,257 @@
+// Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British Columbia
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <errno.h>
+#include <string.h>
+#include "power_source.h"
+
+int writeSample(FILE* f, const PowerSample* sample)
+{
+    return fprintf(f, "%.6lf, %u, %u, %u, %u, %d\n", sample->time, sample->mWatts,
+                   sample->gpuUtil, sample->memUtil, sample->temperature, sample->pState) > 0;
+}
+
+#ifndef REPLAY_ONLY
+NvmlPowerSource::NvmlPowerSource()
+    : m_res(NVML_SUCCESS), m_started(0), m_timestamp(0.0)
+{
+}
+
+int NvmlPowerSource::init()
+{
+    printf("Initializing NVML... ");
+    m_res = nvmlInit();
+    if( m_res != NVML_SUCCESS ) {
+        printf("Error: failed to initialize NVML: %s\n", nvmlErrorString(m_res));
+        return 0;
+    }
+    printf("Success\n");
+    return 1;
+}
+
+int NvmlPowerSource::shutdown()
+{
+    printf("Shutting down NVML... ");
+    m_res = nvmlShutdown();
+    if( m_res != NVML_SUCCESS ) {
+        printf("Error: Failed to shutdown NVML: %s\n", nvmlErrorString(m_res));
+        return 0;
+    }
+    printf("Success\n");
+    return 1;
+}
+
+int NvmlPowerSource::getDevice(int devId)
+{
+    unsigned numDev = 0;
+
+    printf("Getting device... ");
+
+    m_res = nvmlDeviceGetCount(&numDev);
+    if( m_res != NVML_SUCCESS ) {
+        printf("Error: Failed to get number of devices: %s\n", nvmlErrorString(m_res));
+        return 0;
+    }
+
+    if( devId < 0 || (unsigned)devId >= numDev ) {
+        printf("Error: Invalid device ID: %d\n", devId);
+        return 0;
+    }
+
+    char devName[NVML_DEVICE_NAME_BUFFER_SIZE];
+
+    m_res = nvmlDeviceGetHandleByIndex(devId, &m_dev);
+    if( m_res != NVML_SUCCESS ) {
+        printf("Error: failed to get handle for device %i: %s\n", devId, nvmlErrorString(m_res));
+        return 0;
+    }
+
+    m_res = nvmlDeviceGetName(m_dev, devName, NVML_DEVICE_NAME_BUFFER_SIZE);
+    if( m_res != NVML_SUCCESS ) {
+        printf("Error: failed to get name of device %i: %s\n", devId, nvmlErrorString(m_res));
+        return 0;
+    }
+
+    printf("Selected device %d: %s\n", devId, devName);
+    return 1;
+}
+
+int NvmlPowerSource::nextSample(int sampleRate)
+{
+    if( !m_started ) {
+        clock_gettime(CLOCK_MONOTONIC, &m_deadline);
+        m_started = 1;
+    }
+    long long deadline = m_deadline.tv_nsec + sampleRate * 1000000LL;
+    m_deadline.tv_sec += deadline / 1000000000LL;
+    m_deadline.tv_nsec = deadline % 1000000000LL;
+
+    // Throttle to sample rate
+    while( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &m_deadline, NULL) == EINTR )
+        ;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    m_timestamp = now.tv_sec + now.tv_nsec / 1e9;
+    return 1;
+}
+
+double NvmlPowerSource::timestamp()
+{
+    return m_timestamp;
+}
+
+int NvmlPowerSource::getUtilization(unsigned int* gpu, unsigned int* memory)
+{
+    nvmlUtilization_t util;
+    m_res = nvmlDeviceGetUtilizationRates(m_dev, &util);
+    if( m_res != NVML_SUCCESS )
+        return 0;
+    *gpu = util.gpu;
+    *memory = util.memory;
+    return 1;
+}
+
+int NvmlPowerSource::getTemperature(unsigned int* temperature)
+{
+    m_res = nvmlDeviceGetTemperature(m_dev, NVML_TEMPERATURE_GPU, temperature);
+    return m_res == NVML_SUCCESS;
+}
+
+int NvmlPowerSource::getPowerUsage(unsigned int* mWatts)
+{
+    m_res = nvmlDeviceGetPowerUsage(m_dev, mWatts);
+    return m_res == NVML_SUCCESS;
+}
+
+int NvmlPowerSource::getPerformanceState(int* pState)
+{
+    nvmlPstates_t state;
+    m_res = nvmlDeviceGetPerformanceState(m_dev, &state);
+    if( m_res != NVML_SUCCESS )
+        return 0;
+    *pState = (int)state;
+    return 1;
+}
+
+const char* NvmlPowerSource::errorString()
+{
+    return nvmlErrorString(m_res);
+}
+#endif
+
+ReplayPowerSource::ReplayPowerSource(const char* fileName)
+    : m_fileName(fileName), m_file(NULL), m_line(0)
+{
+    memset(&m_sample, 0, sizeof(m_sample));
+    m_error[0] = '\0';
+}
+
+int ReplayPowerSource::init()
+{
+    printf("Opening power samples %s... ", m_fileName);
+    m_file = fopen(m_fileName, "r");
+    if( m_file == NULL ) {
+        printf("Error: failed to open %s: %s\n", m_fileName, strerror(errno));
+        return 0;
+    }
+    printf("Success\n");
+    return 1;
+}
+
+int ReplayPowerSource::shutdown()
+{
+    if( m_file != NULL ) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    return 1;
+}
+
+int ReplayPowerSource::getDevice(int devId)
+{
+    printf("Selected device %d: replay of %s\n", devId, m_fileName);
+    return 1;
+}
+
+int ReplayPowerSource::nextSample(int /* sampleRate */)
+{
+    char line[256];
+    while( fgets(line, sizeof(line), m_file) != NULL ) {
+        m_line++;
+        char* start = line + strspn(line, " \t");
+        if( *start == '#' || *start == '\n' || *start == '\0' )
+            continue;
+        PowerSample sample;
+        memset(&sample, 0, sizeof(sample));
+        if( sscanf(start, "%lf , %u , %u , %u , %u , %d", &sample.time, &sample.mWatts,
+                   &sample.gpuUtil, &sample.memUtil, &sample.temperature, &sample.pState) != 6 ) {
+            snprintf(m_error, sizeof(m_error), "malformed sample at %s:%lu", m_fileName, m_line);
+            return -1;
+        }
+        m_sample = sample;
+        return 1;
+    }
+    return 0;
+}
+
+double ReplayPowerSource::timestamp()
+{
+    return m_sample.time;
+}
+
+int ReplayPowerSource::getUtilization(unsigned int* gpu, unsigned int* memory)
+{
+    *gpu = m_sample.gpuUtil;
+    *memory = m_sample.memUtil;
+    return 1;
+}
+
+int ReplayPowerSource::getTemperature(unsigned int* temperature)
+{
+    *temperature = m_sample.temperature;
+    return 1;
+}
+
+int ReplayPowerSource::getPowerUsage(unsigned int* mWatts)
+{
+    *mWatts = m_sample.mWatts;
+    return 1;
+}
+
+int ReplayPowerSource::getPerformanceState(int* pState)
+{
+    *pState = m_sample.pState;
+    return 1;
+}
+
+const char* ReplayPowerSource::errorString()
+{
+    return m_error;
+}
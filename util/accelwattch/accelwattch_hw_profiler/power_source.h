@@ -0,0 +1,141 @@
+// Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British Columbia
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Where measureGpuPower reads the GPU from: NVML on a machine with the
+// driver, or a file of recorded samples replayed without any GPU.
+
+#ifndef POWER_SOURCE_H
+#define POWER_SOURCE_H
+
+#include <stdio.h>
+#include <time.h>
+#ifndef REPLAY_ONLY
+#include <nvml.h>
+#endif
+
+// One poll of the GPU. Power samples files hold one per line, as
+//   time (s), power (mW), GPU utilization (%), memory utilization (%),
+//   temperature (C), performance state
+// with lines starting with '#' ignored.
+struct PowerSample
+{
+    double time;
+    unsigned int mWatts;
+    unsigned int gpuUtil;
+    unsigned int memUtil;
+    unsigned int temperature;
+    int pState;
+    // Bookkeeping of the measurement: whether the sample is part of the
+    // measured power, and which restart of the measurement it belongs to
+    int accepted;
+    int segment;
+};
+
+int writeSample(FILE* f, const PowerSample* sample);
+
+// The queries of measureGpuPower. All return 1 on success and 0 on failure,
+// with errorString() describing the failure.
+class PowerSource
+{
+public:
+    virtual ~PowerSource() {}
+
+    virtual int init() = 0;
+    virtual int shutdown() = 0;
+    virtual int getDevice(int devId) = 0;
+
+    // Waits until the next sample is due, every sampleRate ms. Returns 1 when
+    // it is, 0 when there are no more samples and -1 on failure.
+    virtual int nextSample(int sampleRate) = 0;
+    // When the current sample was taken, in seconds
+    virtual double timestamp() = 0;
+
+    virtual int getUtilization(unsigned int* gpu, unsigned int* memory) = 0;
+    virtual int getTemperature(unsigned int* temperature) = 0;
+    virtual int getPowerUsage(unsigned int* mWatts) = 0;
+    virtual int getPerformanceState(int* pState) = 0;
+
+    virtual const char* errorString() = 0;
+};
+
+#ifndef REPLAY_ONLY
+class NvmlPowerSource : public PowerSource
+{
+public:
+    NvmlPowerSource();
+
+    int init();
+    int shutdown();
+    int getDevice(int devId);
+    int nextSample(int sampleRate);
+    double timestamp();
+    int getUtilization(unsigned int* gpu, unsigned int* memory);
+    int getTemperature(unsigned int* temperature);
+    int getPowerUsage(unsigned int* mWatts);
+    int getPerformanceState(int* pState);
+    const char* errorString();
+
+private:
+    nvmlDevice_t m_dev;
+    nvmlReturn_t m_res;
+    // Samples are due at fixed deadlines, so that the time spent polling
+    // does not stretch the sample rate
+    struct timespec m_deadline;
+    int m_started;
+    double m_timestamp;
+};
+#endif
+
+// Streams the samples of a power samples file, one per nextSample(), as
+// fast as they can be read. The sample rate is the one they were recorded at.
+class ReplayPowerSource : public PowerSource
+{
+public:
+    ReplayPowerSource(const char* fileName);
+
+    int init();
+    int shutdown();
+    int getDevice(int devId);
+    int nextSample(int sampleRate);
+    double timestamp();
+    int getUtilization(unsigned int* gpu, unsigned int* memory);
+    int getTemperature(unsigned int* temperature);
+    int getPowerUsage(unsigned int* mWatts);
+    int getPerformanceState(int* pState);
+    const char* errorString();
+
+private:
+    const char* m_fileName;
+    FILE* m_file;
+    unsigned long m_line;
+    PowerSample m_sample;
+    char m_error[256];
+};
+
+#endif
@@ -0,0 +1,115 @@
+// Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British Columbia
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <math.h>
+#include "power_summary.h"
+
+void PowerSummary::add(double time, double watts)
+{
+    m_times.push_back(time);
+    m_watts.push_back(watts);
+}
+
+void PowerSummary::split()
+{
+    if( !m_watts.empty() && (m_splits.empty() || m_splits.back() != m_watts.size()) )
+        m_splits.push_back(m_watts.size());
+}
+
+void PowerSummary::reset()
+{
+    m_times.clear();
+    m_watts.clear();
+    m_splits.clear();
+}
+
+double PowerSummary::mean() const
+{
+    if( m_watts.empty() )
+        return 0.0;
+    double sum = 0.0;
+    for( size_t i = 0; i < m_watts.size(); i++ )
+        sum += m_watts[i];
+    return sum / m_watts.size();
+}
+
+double PowerSummary::stddev() const
+{
+    if( m_watts.empty() )
+        return 0.0;
+    double avg = mean();
+    double sum = 0.0;
+    for( size_t i = 0; i < m_watts.size(); i++ )
+        sum += (m_watts[i] - avg) * (m_watts[i] - avg);
+    return sqrt(sum / m_watts.size());
+}
+
+double PowerSummary::percentile(double p) const
+{
+    if( m_watts.empty() )
+        return 0.0;
+    std::vector<double> sorted(m_watts);
+    std::sort(sorted.begin(), sorted.end());
+    double rank = p / 100.0 * (sorted.size() - 1);
+    size_t below = (size_t)floor(rank);
+    if( below + 1 >= sorted.size() )
+        return sorted.back();
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+double PowerSummary::duration() const
+{
+    if( m_times.empty() )
+        return 0.0;
+    return m_times.back() - m_times.front();
+}
+
+double PowerSummary::energy() const
+{
+    double joules = 0.0;
+    size_t split = 0;
+    for( size_t i = 1; i < m_watts.size(); i++ ) {
+        if( split < m_splits.size() && m_splits[split] == i ) {
+            split++;
+            continue;
+        }
+        joules += (m_watts[i - 1] + m_watts[i]) / 2.0 * (m_times[i] - m_times[i - 1]);
+    }
+    return joules;
+}
+
+void PowerSummary::print(FILE* f) const
+{
+    fprintf(f, "Power samples = %zu over %.6lf s\n", count(), duration());
+    fprintf(f, "Power mean = %.4lf W, stddev = %.4lf W\n", mean(), stddev());
+    fprintf(f, "Power min = %.4lf W, p50 = %.4lf W, p90 = %.4lf W, p95 = %.4lf W, p99 = %.4lf W, max = %.4lf W\n",
+            percentile(0), percentile(50), percentile(90), percentile(95), percentile(99), percentile(100));
+    fprintf(f, "Energy = %.4lf J\n", energy());
+}
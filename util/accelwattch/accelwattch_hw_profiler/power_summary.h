@@ -0,0 +1,66 @@
+// Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British Columbia
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef POWER_SUMMARY_H
+#define POWER_SUMMARY_H
+
+#include <stdio.h>
+#include <vector>
+
+// Statistics of the power samples of a measurement
+class PowerSummary
+{
+public:
+    void add(double time, double watts);
+    // The next sample does not follow the last one, e.g. the samples in
+    // between were skipped, and the time in between is not integrated
+    void split();
+    void reset();
+
+    size_t count() const { return m_watts.size(); }
+    double mean() const;
+    double stddev() const;
+    // p in [0, 100], interpolated between the two closest samples
+    double percentile(double p) const;
+    // Seconds between the first and the last sample
+    double duration() const;
+    // Joules, integrating the power over time with the trapezoidal rule
+    // within each run of contiguous samples
+    double energy() const;
+
+    void print(FILE* f) const;
+
+private:
+    std::vector<double> m_times;
+    std::vector<double> m_watts;
+    // indices of the samples that start a new run
+    std::vector<size_t> m_splits;
+};
+
+#endif
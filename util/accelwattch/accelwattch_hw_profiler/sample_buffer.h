@@ -0,0 +1,77 @@
+// Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+// Northwestern University, Purdue University, The University of British Columbia
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer;
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution;
+// 3. Neither the names of Northwestern University, Purdue University,
+//    The University of British Columbia nor the names of their contributors
+//    may be used to endorse or promote products derived from this software
+//    without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SAMPLE_BUFFER_H
+#define SAMPLE_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+
+// Lock-free queue of samples from the thread polling the GPU to the thread
+// saving them, so that the polling thread never waits on file I/O. There must
+// be a single producer and a single consumer. CAPACITY is a power of two.
+template <typename T, size_t CAPACITY>
+class SampleBuffer
+{
+public:
+    SampleBuffer() : m_head(0), m_tail(0) {}
+
+    // Returns false when the buffer is full
+    bool push(const T& sample)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if( head - m_tail.load(std::memory_order_acquire) == CAPACITY )
+            return false;
+        m_samples[head & (CAPACITY - 1)] = sample;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false when the buffer is empty
+    bool pop(T* sample)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if( tail == m_head.load(std::memory_order_acquire) )
+            return false;
+        *sample = m_samples[tail & (CAPACITY - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    T m_samples[CAPACITY];
+    // Total samples pushed and popped. The producer and consumer update
+    // their own, on separate cache lines.
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+
+#endif
@@ -27,6 +27,11 @@
 %ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 %POSSIBILITY OF SUCH DAMAGE.
 
+% The input is one row per kernel: its power components, then its hardware
+% power. reeval_power.py -q <csv> -w <hw power csv> <config> writes it from the
+% simulated power reports, scaled by the coefficients of every -s it is given.
+% The coefficients fitted here are relative to those: pass the same -s files
+% plus the new scaled_coefficients.csv to reeval_power.py to evaluate them.
 input = csvread('accelwattch_volta_sass_sim.csv');
 A = input(:,1:31); % change 30 to number of power counters if different
 b = input(:,32);
@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2018-2021, Vijay Kandiah, Junrui Pan, Mahmoud Khairy, Scott Peverelle, Timothy Rogers, Tor M. Aamodt, Nikos Hardavellas
+# Northwestern University, Purdue University, The University of British Columbia
+# All rights reserved.
+
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer;
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution;
+# 3. Neither the names of Northwestern University, Purdue University,
+#    The University of British Columbia nor the names of their contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+# Re-evaluates AccelWattch power for new scaling coefficients without
+# re-running the simulations.
+#
+# The power of a kernel is the sum of its power components, which scale
+# linearly with the coefficients quadprog_solver.m fits. Given the
+# scaled_coefficients.csv the solver writes, one coefficient per component
+# column of accelwattch_<config>.csv, the re-evaluated power of each kernel is
+# the sum of its components multiplied by their coefficients. The components
+# are read from the same power reports and .awc counter files as
+# gen_sim_power_csv.py.
+#
+# -s can be given several times, the coefficients of all files are multiplied
+# together. With -w, each kernel is compared with its hardware power measured
+# by accelwattch_hw_profiler. With -q, the components (after applying the
+# coefficients) and the hardware power of those kernels are written as a
+# numeric csv that quadprog_solver.m reads with csvread, so that refitting
+# does not need a new simulation either. The coefficients the solver fits on
+# that csv are relative to the ones it was written with: the power they
+# predict is evaluated by passing the same -s files again plus the new one.
+
+import csv
+import os
+import sys
+from optparse import OptionParser
+from os.path import dirname
+
+import numpy
+
+sys.path.insert(0, dirname(os.path.abspath(__file__)))
+from accelwattch_counters import all_configs, hw_kernel_name, power_breakdown
+
+parser = OptionParser(usage="%prog [options] <accelwattch_configuration>")
+parser.add_option(
+    "-r",
+    "--reports",
+    dest="reports",
+    default="",
+    help="directory of the power reports of the config. "
+    + "Defaults to ./accelwattch_power_reports/<config>",
+)
+parser.add_option(
+    "-s",
+    "--coefficients",
+    dest="coefficients",
+    action="append",
+    default=[],
+    help="scaling coefficients written by quadprog_solver.m, one per "
+    + "power component. Repeat to apply the fits of several rounds, their "
+    + "coefficients are multiplied. Without them the simulated power is kept.",
+)
+parser.add_option(
+    "-w",
+    "--hw_power",
+    dest="hw_power",
+    default="",
+    help="hardware power csv generated by accelwattch_hw_profiler/gen_hw_power_csv.py",
+)
+parser.add_option(
+    "-o",
+    "--output",
+    dest="output",
+    default="",
+    help="csv to write the re-evaluated power of each kernel to",
+)
+parser.add_option(
+    "-q",
+    "--solver_input",
+    dest="solver_input",
+    default="",
+    help="csv to write the input of quadprog_solver.m to. Needs -w.",
+)
+(options, args) = parser.parse_args()
+
+if len(args) != 1 or args[0] not in all_configs:
+    parser.print_usage()
+    print(
+        "Please enter AccelWattch config: One of [{0}]".format(",".join(all_configs))
+    )
+    sys.exit(1)
+config = args[0]
+if options.solver_input != "" and options.hw_power == "":
+    sys.exit("-q needs the hardware power of the kernels (-w)")
+
+reportspath = options.reports
+if reportspath == "":
+    reportspath = os.path.join(os.getcwd(), "accelwattch_power_reports", config)
+
+power_dict = power_breakdown(reportspath, config)
+kernels = [k for k in power_dict if len(power_dict[k]) != 0]
+if len(kernels) == 0:
+    sys.exit("No simulated kernels in {0}".format(reportspath))
+components = [c for c in power_dict[kernels[0]] if c != "kernel_avg_power"]
+breakdown = numpy.array(
+    [[power_dict[k][c] for c in components] for k in kernels], dtype=float
+)
+simulated = numpy.array([power_dict[k]["kernel_avg_power"] for k in kernels])
+
+for coefficients_file in options.coefficients:
+    coefficients = []
+    with open(coefficients_file, "r") as f:
+        for row in csv.reader(f):
+            coefficients += [float(v) for v in row if v.strip() != ""]
+    if len(coefficients) != len(components):
+        sys.exit(
+            "{0} has {1} coefficients, {2} has {3} power components: {4}".format(
+                coefficients_file,
+                len(coefficients),
+                config,
+                len(components),
+                " ".join(components),
+            )
+        )
+    breakdown = breakdown * numpy.array(coefficients)
+power = breakdown.sum(axis=1)
+
+hw_power = numpy.full(len(kernels), numpy.nan)
+if options.hw_power != "":
+    measured = {}
+    with open(options.hw_power, "r") as f:
+        reader = csv.reader(f)
+        header = next(reader)
+        column = header.index("mean HW_power")
+        for row in reader:
+            if len(row) > column and row[column].strip() != "":
+                measured[row[0]] = float(row[column])
+    for i, kernel in enumerate(kernels):
+        hw_power[i] = measured.get(hw_kernel_name(kernel), numpy.nan)
+
+if options.output != "":
+    with open(options.output, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["", "sim_power", "reevaluated_power", "hw_power", "error"])
+        for i, kernel in enumerate(kernels):
+            error = (power[i] - hw_power[i]) / hw_power[i] * 100
+            writer.writerow([kernel, simulated[i], power[i], hw_power[i], error])
+
+if options.solver_input != "":
+    measured = ~numpy.isnan(hw_power)
+    numpy.savetxt(
+        options.solver_input,
+        numpy.column_stack((breakdown[measured], hw_power[measured])),
+        delimiter=",",
+    )
+    print(
+        "Wrote {0} kernels with {1} power components to {2}".format(
+            numpy.count_nonzero(measured), len(components), options.solver_input
+        )
+    )
+
+print(
+    "{0}: {1} kernels, mean simulated power {2:.2f}W, re-evaluated {3:.2f}W".format(
+        config, len(kernels), simulated.mean(), power.mean()
+    )
+)
+measured = ~numpy.isnan(hw_power)
+if numpy.any(measured):
+    for name, values in [("simulated", simulated), ("re-evaluated", power)]:
+        error = numpy.abs(values[measured] - hw_power[measured]) / hw_power[measured]
+        print(
+            "Mean absolute error against hardware of the {0} power: {1:.2f}% over {2} kernels".format(
+                name, error.mean() * 100, numpy.count_nonzero(measured)
+            )
+        )
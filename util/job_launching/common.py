@@ -34,6 +34,9 @@ import os
 import yaml
 import glob
 import hashlib
+import json
+import sqlite3
+import shutil
 
 this_directory = os.path.dirname(os.path.realpath(__file__)) + "/"
 
@@ -315,7 +318,8 @@ def parse_run_simulations_options():
         dest="cores",
         default=None,
         help="Specify the core limit when using procman. If nothing is specified, all the cores"
-        " on the local node will be used.",
+        " on the local node will be used. With slurm or torque, it is the number of jobs"
+        " that can run at once when estimating the makespan of the launch.",
     )
     parser.add_option(
         "-a",
@@ -324,6 +328,16 @@ def parse_run_simulations_options():
         action="store_true",
         help="Enable passing hw_perf_bench_name for accelwattch hw and hybrid runs to config file.",
     )
+    parser.add_option(
+        "-R",
+        "--result_cache",
+        dest="result_cache",
+        default=os.getenv("ACCELSIM_RESULT_CACHE", ""),
+        help="Trace-driven mode only. A directory, which can be shared, where finished "
+        + "simulations are kept. Runs whose simulator build, resolved config and traces "
+        + "match a cached one reuse its output instead of being launched. "
+        + "Defaults to $ACCELSIM_RESULT_CACHE.",
+    )
 
     (options, args) = parser.parse_args()
     # Parser seems to leave some whitespace on the options, getting rid of it
@@ -337,11 +351,380 @@ def parse_run_simulations_options():
     options.run_directory = options.run_directory.strip()
     options.simulator_dir = options.simulator_dir.strip()
     options.launch_name = options.launch_name.strip()
+    options.result_cache = options.result_cache.strip()
     if options.job_mem != None:
         options.job_mem = options.job_mem.strip()
     return (options, args)
 
 
+# Parsing state of the simulator output files, so that the scripts polling
+# a running sweep only read what was appended since their last run.
+# Each output file keeps the byte offset it was parsed up to, a digest of
+# the bytes before it and the parser state, in a small sqlite database.
+# parser names the script and its options: outputs parsed with other
+# options or rewritten by a rerun are parsed again from the start.
+class OutputCheckpoints:
+    HEAD_BYTES = 4096
+
+    def __init__(self, db_file, parser):
+        self.parser = parser
+        self.db = sqlite3.connect(db_file, timeout=600)
+        self.db.execute(
+            "CREATE TABLE IF NOT EXISTS checkpoints (outfile TEXT, parser TEXT, "
+            + "offset INTEGER, head TEXT, state TEXT, PRIMARY KEY (outfile, parser))"
+        )
+
+    def head_digest(self, outfile, offset):
+        with open(outfile, "rb") as f:
+            return hashlib.md5(f.read(min(offset, self.HEAD_BYTES))).hexdigest()
+
+    # Returns the offset and state to resume from, (0, None) to start over
+    def load(self, outfile):
+        row = self.db.execute(
+            "SELECT offset, head, state FROM checkpoints WHERE outfile = ? "
+            + "AND parser = ?",
+            (outfile, self.parser),
+        ).fetchone()
+        if row == None:
+            return 0, None
+        offset, head, state = row
+        if (
+            os.stat(outfile).st_size < offset
+            or self.head_digest(outfile, offset) != head
+        ):
+            return 0, None
+        return offset, json.loads(state)
+
+    def save(self, outfile, offset, state):
+        self.db.execute(
+            "INSERT OR REPLACE INTO checkpoints VALUES (?, ?, ?, ?, ?)",
+            (
+                outfile,
+                self.parser,
+                offset,
+                self.head_digest(outfile, offset),
+                json.dumps(state),
+            ),
+        )
+
+    def close(self):
+        self.db.commit()
+        self.db.close()
+
+
+# Yields the lines of outfile after offset, each with the offset just past
+# it. An unterminated last line may still be being written, it is only
+# yielded with partial, for the caller to parse without checkpointing it.
+def read_new_lines(outfile, offset, partial=False):
+    with open(outfile, "rb") as f:
+        f.seek(offset)
+        for line in f:
+            if not line.endswith(b"\n") and not partial:
+                break
+            offset += len(line)
+            yield line.decode(errors="replace"), offset
+
+
+# Job id logged for runs whose output was taken from the result cache
+RESULT_CACHE_JOB_ID = "0"
+
+
+# Wall time of the simulations that finished, to predict how long new ones
+# will take. Runs are kept per app, args and config family (the base config
+# the config name starts with), with the number of instructions the tracer
+# recorded in stats.csv, if any.
+class RuntimeHistory:
+    # runs of the same app, args and family a prediction averages
+    HISTORY_LENGTH = 5
+    TAIL_BYTES = 1024 * 1024
+    SIM_TIME_RE = re.compile(rb"gpgpu_simulation_time\s*=.*\(([0-9]+) sec\)")
+    EXIT_STRING = b"GPGPU-Sim: *** exit detected ***"
+
+    def __init__(self, db_file):
+        self.db = sqlite3.connect(db_file, timeout=600)
+        self.db.execute(
+            "CREATE TABLE IF NOT EXISTS runtimes (outfile TEXT PRIMARY KEY, "
+            + "mtime REAL, app TEXT, args TEXT, family TEXT, insts INTEGER, "
+            + "seconds INTEGER)"
+        )
+        self.trace_insts_of = {}
+
+    def config_family(self, config):
+        return config.split("-")[0]
+
+    # The total number of traced instructions, from the tracer's stats.csv
+    def trace_insts(self, run_dir):
+        stats_file = os.path.realpath(os.path.join(run_dir, "traces", "stats.csv"))
+        if stats_file not in self.trace_insts_of:
+            insts = None
+            if os.path.isfile(stats_file):
+                insts = 0
+                with open(stats_file) as f:
+                    next(f, None)  # header
+                    for line in f:
+                        try:
+                            insts += int(line.split(",")[-1])
+                        except ValueError:
+                            pass
+            self.trace_insts_of[stats_file] = insts
+        return self.trace_insts_of[stats_file]
+
+    # Records the simulations in run_dir that exited since the last call
+    def record_outputs(self, run_dir, app, args, config):
+        if not os.path.isdir(run_dir):
+            return
+        for name in os.listdir(run_dir):
+            match = re.match(r".*\.o([0-9]+)$", name)
+            # outputs from the result cache did not run here
+            if not match or match.group(1) == RESULT_CACHE_JOB_ID:
+                continue
+            outfile = os.path.join(run_dir, name)
+            st = os.stat(outfile)
+            row = self.db.execute(
+                "SELECT mtime FROM runtimes WHERE outfile = ?", (outfile,)
+            ).fetchone()
+            if row != None and row[0] == st.st_mtime:
+                continue
+            with open(outfile, "rb") as f:
+                f.seek(max(0, st.st_size - self.TAIL_BYTES))
+                tail = f.read()
+            times = self.SIM_TIME_RE.findall(tail)
+            if self.EXIT_STRING not in tail or len(times) == 0:
+                continue
+            self.db.execute(
+                "INSERT OR REPLACE INTO runtimes VALUES (?, ?, ?, ?, ?, ?, ?)",
+                (
+                    outfile,
+                    st.st_mtime,
+                    app,
+                    args,
+                    self.config_family(config),
+                    self.trace_insts(run_dir),
+                    int(times[-1]),
+                ),
+            )
+
+    # Predicted wall time in seconds, None if there is nothing to go by.
+    # The last runs of the same app, args and family are averaged, scaled by
+    # the instruction counts when the traces changed. Otherwise the traced
+    # instructions are divided by the simulation rate of the family, or of
+    # all the runs if the family never ran.
+    def predict(self, run_dir, app, args, config):
+        family = self.config_family(config)
+        insts = self.trace_insts(run_dir)
+        rows = self.db.execute(
+            "SELECT insts, seconds FROM runtimes WHERE app = ? AND args = ? "
+            + "AND family = ? ORDER BY mtime DESC LIMIT ?",
+            (app, args, family, self.HISTORY_LENGTH),
+        ).fetchall()
+        if len(rows) > 0:
+            total = 0.0
+            for row_insts, seconds in rows:
+                if insts and row_insts:
+                    seconds = seconds * float(insts) / row_insts
+                total += seconds
+            return total / len(rows)
+
+        if not insts:
+            return None
+        for where, params in [("AND family = ?", (family,)), ("", ())]:
+            row = self.db.execute(
+                "SELECT SUM(insts), SUM(seconds) FROM runtimes WHERE insts > 0 "
+                + where,
+                params,
+            ).fetchone()
+            if row[0]:
+                return insts * float(row[1]) / row[0]
+        return None
+
+    def close(self):
+        self.db.commit()
+        self.db.close()
+
+
+# Finished simulations, stored under a digest of everything that determines
+# their output: the simulator build, the resolved gpgpusim.config with the
+# files it reads and the contents of the trace directory. The directory is
+# meant to be shared, possibly over NFS, so everything is written to a
+# temporary name first and renamed into place, and made group writable.
+class ResultCache:
+    BLOCK_SIZE = 1024 * 1024
+    EXIT_STRING = b"GPGPU-Sim: *** exit detected ***"
+    TAIL_BYTES = 64 * 1024
+
+    def __init__(self, cache_dir):
+        self.cache_dir = os.path.abspath(cache_dir)
+        self.trace_digests = {}
+        self.makedirs(os.path.join(self.cache_dir, "traces"))
+
+    def makedirs(self, path):
+        if not os.path.isdir(path):
+            try:
+                os.makedirs(path)
+                os.chmod(path, 0o2775)
+            except OSError:
+                # someone else just made it
+                pass
+
+    def write_atomic(self, path, text):
+        tmp_path = "{0}.tmp.{1}.{2}".format(path, os.uname()[1], os.getpid())
+        with open(tmp_path, "w") as f:
+            f.write(text)
+        os.chmod(tmp_path, 0o664)
+        os.rename(tmp_path, path)
+
+    def file_digest(self, path):
+        digest = hashlib.sha256()
+        with open(path, "rb") as f:
+            for block in iter(lambda: f.read(self.BLOCK_SIZE), b""):
+                digest.update(block)
+        return digest.hexdigest()
+
+    # The traces are hashed once, after that only the files whose size or
+    # modification time changed are read again. The per file digests are
+    # kept in the cache, so that every user benefits from them.
+    def trace_digest(self, trace_dir):
+        trace_dir = os.path.realpath(trace_dir)
+        if trace_dir in self.trace_digests:
+            return self.trace_digests[trace_dir]
+
+        memo_file = os.path.join(
+            self.cache_dir,
+            "traces",
+            hashlib.sha256(trace_dir.encode()).hexdigest() + ".json",
+        )
+        known = {}
+        if os.path.isfile(memo_file):
+            try:
+                known = json.load(open(memo_file))["files"]
+            except (ValueError, KeyError):
+                pass
+
+        files = {}
+        for root, dirs, names in os.walk(trace_dir, followlinks=True):
+            dirs.sort()
+            for name in sorted(names):
+                path = os.path.join(root, name)
+                rel_path = os.path.relpath(path, trace_dir)
+                st = os.stat(path)
+                if (
+                    rel_path in known
+                    and known[rel_path][0] == st.st_size
+                    and known[rel_path][1] == st.st_mtime_ns
+                ):
+                    files[rel_path] = known[rel_path]
+                else:
+                    files[rel_path] = [
+                        st.st_size,
+                        st.st_mtime_ns,
+                        self.file_digest(path),
+                    ]
+        if files != known:
+            self.write_atomic(
+                memo_file, json.dumps({"path": trace_dir, "files": files})
+            )
+
+        digest = hashlib.sha256()
+        for rel_path in sorted(files):
+            digest.update("{0}\0{1}\0".format(rel_path, files[rel_path][2]).encode())
+        self.trace_digests[trace_dir] = digest.hexdigest()
+        return self.trace_digests[trace_dir]
+
+    # The accel-sim build handle ends in the time the build was configured,
+    # which changes with every clean rebuild, so only the commits and counts
+    # of modified files in front of it are kept. A build with uncommitted
+    # changes cannot be told apart from another one with different changes,
+    # so None is returned and it is not cached.
+    @staticmethod
+    def build_id(build_handle):
+        build_id = re.sub(r"(_modified_[\d.]+)_\d[\d:T+-]*", r"\1", build_handle)
+        for modified in re.findall(r"_modified_([\d.]+)", build_id):
+            if any(n.strip("0") != "" for n in modified.split(".")):
+                return None
+        return build_id
+
+    def key(self, build_id, command_line, config_text, config_files, trace_dir):
+        digest = hashlib.sha256()
+        for part in [build_id, command_line, config_text]:
+            digest.update(part.encode() + b"\0")
+        for path in sorted(config_files, key=os.path.basename):
+            digest.update(os.path.basename(path).encode() + b"\0")
+            digest.update(self.file_digest(path).encode() + b"\0")
+        digest.update(self.trace_digest(trace_dir).encode())
+        return digest.hexdigest()
+
+    def entry_dir(self, key):
+        return os.path.join(self.cache_dir, key[:2], key)
+
+    # Copies the cached output of key to outfile and errfile, returns False
+    # if there is none
+    def fetch(self, key, outfile, errfile):
+        entry = self.entry_dir(key)
+        if not os.path.isfile(os.path.join(entry, "info.json")):
+            return False
+        shutil.copyfile(os.path.join(entry, "sim.o"), outfile)
+        shutil.copyfile(os.path.join(entry, "sim.e"), errfile)
+        return True
+
+    # Stores the output of a run that exited cleanly under key. Returns False
+    # if it did not, or the key is already stored.
+    def store(self, key, outfile, errfile, info):
+        entry = self.entry_dir(key)
+        if os.path.isdir(entry) or not os.path.isfile(outfile):
+            return False
+        with open(outfile, "rb") as f:
+            f.seek(max(0, os.stat(outfile).st_size - self.TAIL_BYTES))
+            if self.EXIT_STRING not in f.read():
+                return False
+
+        self.makedirs(os.path.dirname(entry))
+        tmp_entry = "{0}.tmp.{1}.{2}".format(entry, os.uname()[1], os.getpid())
+        self.makedirs(tmp_entry)
+        shutil.copyfile(outfile, os.path.join(tmp_entry, "sim.o"))
+        if os.path.isfile(errfile):
+            shutil.copyfile(errfile, os.path.join(tmp_entry, "sim.e"))
+        else:
+            open(os.path.join(tmp_entry, "sim.e"), "w").close()
+        # info.json is written last, an entry without it is incomplete
+        self.write_atomic(os.path.join(tmp_entry, "info.json"), json.dumps(info))
+        for name in ["sim.o", "sim.e"]:
+            os.chmod(os.path.join(tmp_entry, name), 0o664)
+        try:
+            os.rename(tmp_entry, entry)
+        except OSError:
+            # stored by someone else in the meantime
+            shutil.rmtree(tmp_entry, ignore_errors=True)
+            return False
+        return True
+
+
+# run_simulations.py leaves the cache key of a launched run in its run
+# directory, see record_cached_run(). Once the job is over, procman and
+# job_status.py call this to store its output if it exited cleanly. Returns
+# True if the run was stored.
+def store_finished_run(run_dir, job_id=None, result_cache=None):
+    record_file = os.path.join(run_dir, "result_cache.json")
+    if not os.path.isfile(record_file):
+        return False
+    try:
+        record = json.load(open(record_file))
+    except ValueError:
+        return False
+    if job_id != None and record["job_id"] != job_id:
+        return False
+    if result_cache == None:
+        if "cache_dir" not in record:
+            return False
+        result_cache = ResultCache(record["cache_dir"])
+    output_base = os.path.join(run_dir, record["sim_name"])
+    return result_cache.store(
+        record["key"],
+        output_base + ".o" + record["job_id"],
+        output_base + ".e" + record["job_id"],
+        record["info"],
+    )
+
+
 # After collection, spew out the tables
 def print_stat(
     stat_name,
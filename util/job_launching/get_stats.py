@@ -10,6 +10,10 @@ import common
 import math
 import yaml
 import time
+import tempfile
+import json
+import hashlib
+import copy
 
 millnames = ["", " K", " M", " B", " T"]
 
@@ -143,6 +147,32 @@ parser.add_option(
     action="store_true",
     help="Print the averages for each statistic",
 )
+parser.add_option(
+    "-b",
+    "--backend",
+    dest="backend",
+    help="How the output files are parsed. native: with the compiled "
+    + "stats-extract tool (build it with make in stats-extract), python: "
+    + "line by line in this script, auto: native when it is built",
+    default="auto",
+)
+parser.add_option(
+    "-j",
+    "--jobs",
+    dest="jobs",
+    type="int",
+    help="native backend: number of output files parsed in parallel",
+    default=os.cpu_count(),
+)
+parser.add_option(
+    "-i",
+    "--incremental",
+    dest="incremental",
+    action="store_true",
+    help="Remember how far each output file was parsed in "
+    + "<run_dir>/stats_checkpoints.db and only parse what was appended since. "
+    + "Uses the python parser",
+)
 (options, args) = parser.parse_args()
 options.logfile = options.logfile.strip()
 options.run_dir = options.run_dir.strip()
@@ -261,6 +291,7 @@ else:
                 specific_jobIds[config + app_and_args] = (jobId, jobname)
 
 all_named_kernels = {}
+outfiles = []
 for idx, app_and_args in enumerate(apps_and_args):
     all_named_kernels[app_and_args] = []
     for config in configs:
@@ -293,187 +324,329 @@ for idx, app_and_args in enumerate(apps_and_args):
             else:
                 continue
 
-        stat_found = set()
-
         if not os.path.isfile(outfile):
             print("WARNING - " + outfile + " does not exist", file=sys.stderr)
             continue
+        outfiles.append((app_and_args, config, outfile))
+
+
+MAX_BUILD_LINES = 100
+MAX_EXIT_LINES = 10000
+BYTES_TO_READ = int(250 * 1024 * 1024)
+SIM_EXIT_STRING = "GPGPU-Sim: \*\*\* exit detected \*\*\*"
+
+
+# Everything parse_outfile() learns about one output file. It is kept in the
+# checkpoint database with --incremental, so it has to stay json friendly.
+def new_outfile_state():
+    return {
+        # lines searched for the build numbers so far and the numbers found
+        "head_lines": 0,
+        "builds": {},
+        # lines parsed and the last one with the simulation exit string
+        "lines": 0,
+        "exit_line": None,
+        # kernel -> stat_name -> value, as they go in the stat_map
+        "stats": {},
+        "named_kernels": [],
+        # per-kernel parsing
+        "current_kernel": "",
+        "last_kernel": "",
+        "raw_last": {},
+        "running_kcount": {},
+        "max_breaks": 0,
+    }
+
+
+def parse_build_lines(state, lines):
+    # the GPGPU-Sim Version number is in the first 100 lines
+    for line in lines:
+        if state["head_lines"] >= MAX_BUILD_LINES - 1:
+            return
+        state["head_lines"] += 1
+        gpgpu_build_match = re.match(".*GPGPU-Sim.*\[build\s+(.*)\].*", line)
+        if gpgpu_build_match:
+            state["builds"]["GPGPU-Sim-build"] = gpgpu_build_match.group(1)
+            state["head_lines"] = MAX_BUILD_LINES - 1
+            return
+        accelsim_build_match = re.match("Accel-Sim.*\[build\s+(.*)\].*", line)
+        if accelsim_build_match:
+            state["builds"]["Accel-Sim-build"] = accelsim_build_match.group(1)
+
+
+# Without -k only the last value of each stat matters. The first pass reverse
+# searches the last 250MB of the file, later ones keep the newest values.
+def parse_final_window(state, outfile, offset):
+    lines = []
+    for line, offset in common.read_new_lines(outfile, offset):
+        lines.append(line)
+    if state["head_lines"] < MAX_BUILD_LINES - 1:
+        head = common.read_new_lines(outfile, 0)
+        parse_build_lines(state, (line for line, end in head))
+
+    state["lines"] = len(lines)
+    for idx in range(len(lines) - 1, max(len(lines) - MAX_EXIT_LINES, -1), -1):
+        if re.match(SIM_EXIT_STRING, lines[idx]):
+            state["exit_line"] = idx
+            break
+
+    final_stats = state["stats"].setdefault("final_kernel", {})
+    for line in reversed(lines):
+        # pull out some stats
+        for stat_name, tup in stats_to_pull.items():
+            token, statType = tup
+            if stat_name in final_stats:
+                continue
+            existance_test = token.search(line.rstrip())
+            if existance_test != None:
+                final_stats[stat_name] = existance_test.group(1).strip()
+        if len(final_stats) == len(stats_to_pull):
+            break
+    return offset
+
+
+def parse_final_line(state, line):
+    final_stats = state["stats"].setdefault("final_kernel", {})
+    for stat_name, tup in stats_to_pull.items():
+        token, statType = tup
+        existance_test = token.search(line.rstrip())
+        if existance_test != None:
+            final_stats[stat_name] = existance_test.group(1).strip()
+
+
+def parse_kernel_line(state, line):
+    kernel_stats = state["stats"]
+    current_kernel = state["current_kernel"]
+    raw_last = state["raw_last"]
+
+    # If we ended simulation due to too many insn - ignore the last kernel launch, as it is no complete.
+    # Note: This only appies if we are doing kernel-by-kernel stats
+    last_kernel_break = re.match(
+        "GPGPU-Sim: \*\* break due to reaching the maximum cycles \(or instructions\) \*\*",
+        line,
+    )
+    if last_kernel_break:
+        state["max_breaks"] += 1
+        for stat_name in stats_to_pull.keys():
+            kernel_stats.get(current_kernel, {}).pop(stat_name, None)
+
+    kernel_match = re.match("kernel_name\s+=\s+(.*)", line)
+    if kernel_match:
+        state["last_kernel"] = current_kernel
+        current_kernel = kernel_match.group(1).strip()
+
+        if options.kernel_instance:
+            running_kcount = state["running_kcount"]
+            if current_kernel not in running_kcount:
+                running_kcount[current_kernel] = 0
+            else:
+                running_kcount[current_kernel] += 1
+            current_kernel += "--" + str(running_kcount[current_kernel])
+        state["current_kernel"] = current_kernel
+
+        if current_kernel not in state["named_kernels"]:
+            state["named_kernels"].append(current_kernel)
+
+        current_stats = kernel_stats.setdefault(current_kernel, {})
+        current_stats["k-count"] = current_stats.get("k-count", 0) + 1
+        return
+
+    last_stats = kernel_stats.get(state["last_kernel"], {})
+    for stat_name, tup in stats_to_pull.items():
+        token, statType = tup
+        existance_test = token.search(line.rstrip())
+        if existance_test != None:
+            number = existance_test.group(1).strip()
+            current_stats = kernel_stats.setdefault(current_kernel, {})
+            if statType != "agg":
+                current_stats[stat_name] = number
+            elif stat_name in current_stats:
+                if stat_name in raw_last:
+                    stat_last_kernel = raw_last[stat_name]
+                else:
+                    stat_last_kernel = 0.0
+                raw_last[stat_name] = float(number)
+                current_stats[stat_name] += float(number) - stat_last_kernel
+            else:
+                if stat_name in last_stats:
+                    stat_last_kernel = raw_last[stat_name]
+                else:
+                    stat_last_kernel = 0.0
+                raw_last[stat_name] = float(number)
+                current_stats[stat_name] = float(number) - stat_last_kernel
+
+
+def parse_line(state, line):
+    parse_build_lines(state, [line])
+    if re.match(SIM_EXIT_STRING, line):
+        state["exit_line"] = state["lines"]
+    state["lines"] += 1
+    if options.per_kernel:
+        parse_kernel_line(state, line)
+    else:
+        parse_final_line(state, line)
+
+
+def parse_outfile(app_and_args, config, outfile, checkpoints=None):
+    offset, state = 0, None
+    if checkpoints != None:
+        offset, state = checkpoints.load(outfile)
+    if state == None:
+        state = new_outfile_state()
 
-        # Do a quick 100-line pass to get the GPGPU-Sim Version number
-        MAX_LINES = 100
-        count = 0
-        f = open(outfile)
-        for line in f:
-            count += 1
-            if count >= MAX_LINES:
-                break
-            gpgpu_build_match = re.match(".*GPGPU-Sim.*\[build\s+(.*)\].*", line)
-            if gpgpu_build_match:
-                stat_map[
-                    "all_kernels" + app_and_args + config + "GPGPU-Sim-build"
-                ] = gpgpu_build_match.group(1)
-                break
-            accelsim_build_match = re.match("Accel-Sim.*\[build\s+(.*)\].*", line)
-            if accelsim_build_match:
-                stat_map[
-                    "all_kernels" + app_and_args + config + "Accel-Sim-build"
-                ] = accelsim_build_match.group(1)
-        f.close()
-
-        # Do a quick 10000-line reverse pass to make sure the simualtion thread finished
-        SIM_EXIT_STRING = "GPGPU-Sim: \*\*\* exit detected \*\*\*"
-        exit_success = False
-        MAX_LINES = 10000
-        BYTES_TO_READ = int(250 * 1024 * 1024)
-        count = 0
-        f = open(outfile)
-        fsize = int(os.stat(outfile).st_size)
-        if fsize > BYTES_TO_READ:
-            f.seek(0, os.SEEK_END)
-            f.seek(f.tell() - BYTES_TO_READ, os.SEEK_SET)
-        lines = f.readlines()
-        for line in reversed(lines):
-            count += 1
-            if count >= MAX_LINES:
-                break
-            exit_match = re.match(SIM_EXIT_STRING, line)
-            if exit_match:
-                exit_success = True
-                break
-        del lines
-        f.close()
-
-        if not exit_success:
+    if not options.per_kernel and offset == 0:
+        start = max(0, os.stat(outfile).st_size - BYTES_TO_READ)
+        offset = parse_final_window(state, outfile, start)
+    else:
+        start = offset
+        for line, offset in common.read_new_lines(outfile, offset):
+            parse_line(state, line)
+    if checkpoints != None:
+        checkpoints.save(outfile, offset, state)
+
+    # the last line may still be being written, it is parsed again next time
+    last_lines = list(common.read_new_lines(outfile, offset, True))
+    if len(last_lines) > 0 and checkpoints != None:
+        state = copy.deepcopy(state)
+    for line, offset in last_lines:
+        parse_line(state, line)
+    add_outfile_stats(app_and_args, config, outfile, state, offset - start)
+
+
+def add_outfile_stats(app_and_args, config, outfile, state, bytes_read):
+    global files_parsed, bytes_parsed
+    for build_name, build in state["builds"].items():
+        stat_map["all_kernels" + app_and_args + config + build_name] = build
+
+    # make sure the simualtion thread finished within the last 10000 lines
+    exit_success = (
+        state["exit_line"] != None
+        and state["lines"] - state["exit_line"] < MAX_EXIT_LINES
+    )
+    if not exit_success:
+        print(
+            "WARNING - Detected that {0} does not contain a terminating string from GPGPU-Sim. The output is potentially invalid".format(
+                outfile
+            ),
+            file=sys.stderr,
+        )
+        if not options.ignore_failures:
+            return
+
+    files_parsed += 1
+    bytes_parsed += bytes_read
+    for i in range(state["max_breaks"]):
+        print(
+            "NOTE::::: Found Max Insn reached in {0} - ignoring last kernel.".format(
+                outfile
+            ),
+            file=sys.stderr,
+        )
+
+    if not options.per_kernel and len(all_named_kernels[app_and_args]) == 0:
+        all_named_kernels[app_and_args].append("final_kernel")
+    for kernel in state["named_kernels"]:
+        if kernel not in all_named_kernels[app_and_args]:
+            all_named_kernels[app_and_args].append(kernel)
+    for kernel, kernel_stats in state["stats"].items():
+        for stat_name, value in kernel_stats.items():
+            stat_map[kernel + app_and_args + config + stat_name] = value
+
+
+def parse_outfiles_native(outfiles):
+    global files_parsed, bytes_parsed
+    # the stats in the order get_stats.py tries them, a regex listed twice
+    # keeps its first position and its last type
+    with tempfile.NamedTemporaryFile("w", suffix=".txt") as patterns:
+        for stat_name, tup in stats_to_pull.items():
+            patterns.write(tup[1] + "\t" + stat_name + "\n")
+        patterns.flush()
+        command = [native_extractor, "-p", patterns.name, "-j", str(options.jobs)]
+        if options.per_kernel:
+            command.append("-k")
+        if options.kernel_instance:
+            command.append("-K")
+        if options.ignore_failures:
+            command.append("-I")
+        result = subprocess.run(
+            command,
+            input="".join(outfile + "\n" for _, _, outfile in outfiles),
+            stdout=subprocess.PIPE,
+            universal_newlines=True,
+        )
+    if result.returncode != 0:
+        return False
+
+    # apply the records exactly as parse_outfile() updates the stat map
+    for record in result.stdout.split("\n"):
+        fields = record.split("\t", 4)
+        kind = fields[0]
+        if kind == "F":
+            app_and_args, config, outfile = outfiles[int(fields[1])]
+        elif kind == "B":
+            stat_map["all_kernels" + app_and_args + config + fields[1]] = fields[2]
+        elif kind == "X" and fields[1] == "0":
             print(
                 "WARNING - Detected that {0} does not contain a terminating string from GPGPU-Sim. The output is potentially invalid".format(
                     outfile
                 ),
                 file=sys.stderr,
             )
-            if not options.ignore_failures:
-                continue
-
-        if not options.per_kernel:
-            if len(all_named_kernels[app_and_args]) == 0:
-                all_named_kernels[app_and_args].append("final_kernel")
-            BYTES_TO_READ = int(250 * 1024 * 1024)
-            count = 0
-            f = open(outfile)
-            fsize = int(os.stat(outfile).st_size)
+        elif kind == "P":
             files_parsed += 1
-            if fsize > BYTES_TO_READ:
-                f.seek(0, os.SEEK_END)
-                f.seek(f.tell() - BYTES_TO_READ, os.SEEK_SET)
-                bytes_parsed += BYTES_TO_READ
-            else:
-                bytes_parsed += fsize
-            lines = f.readlines()
-            for line in reversed(lines):
-                # pull out some stats
-                for stat_name, tup in stats_to_pull.items():
-                    token, statType = tup
-                    if stat_name in stat_found:
-                        continue
-                    existance_test = token.search(line.rstrip())
-                    if existance_test != None:
-                        stat_found.add(stat_name)
-                        number = existance_test.group(1).strip()
-                        stat_map[
-                            "final_kernel" + app_and_args + config + stat_name
-                        ] = number
-                if len(stat_found) == len(stats_to_pull):
-                    break
-            del lines
-            f.close()
-        else:
-            current_kernel = ""
-            last_kernel = ""
-            raw_last = {}
-            running_kcount = {}
-            files_parsed += 1
-            bytes_parsed += os.stat(outfile).st_size
-            f = open(outfile)
-            # print("Parsing File {0}. Size: {1}".format(outfile, millify(os.stat(outfile).st_size)))
-            for line in f:
-                # If we ended simulation due to too many insn - ignore the last kernel launch, as it is no complete.
-                # Note: This only appies if we are doing kernel-by-kernel stats
-                last_kernel_break = re.match(
-                    "GPGPU-Sim: \*\* break due to reaching the maximum cycles \(or instructions\) \*\*",
-                    line,
-                )
-                if last_kernel_break:
-                    print(
-                        "NOTE::::: Found Max Insn reached in {0} - ignoring last kernel.".format(
-                            outfile
-                        ),
-                        file=sys.stderr,
-                    )
-                    for stat_name in stats_to_pull.keys():
-                        if (
-                            current_kernel + app_and_args + config + stat_name
-                            in stat_map
-                        ):
-                            del stat_map[
-                                current_kernel + app_and_args + config + stat_name
-                            ]
-
-                kernel_match = re.match("kernel_name\s+=\s+(.*)", line)
-                if kernel_match:
-                    last_kernel = current_kernel
-                    current_kernel = kernel_match.group(1).strip()
-
-                    if options.kernel_instance:
-                        if current_kernel not in running_kcount:
-                            running_kcount[current_kernel] = 0
-                        else:
-                            running_kcount[current_kernel] += 1
-                        current_kernel += "--" + str(running_kcount[current_kernel])
-
-                    if current_kernel not in all_named_kernels[app_and_args]:
-                        all_named_kernels[app_and_args].append(current_kernel)
-
-                    if current_kernel + app_and_args + config + "k-count" in stat_map:
-                        stat_map[
-                            current_kernel + app_and_args + config + "k-count"
-                        ] += 1
-                    else:
-                        stat_map[current_kernel + app_and_args + config + "k-count"] = 1
-                    continue
-
-                for stat_name, tup in stats_to_pull.items():
-                    token, statType = tup
-                    existance_test = token.search(line.rstrip())
-                    if existance_test != None:
-                        stat_found.add(stat_name)
-                        number = existance_test.group(1).strip()
-                        if statType != "agg":
-                            stat_map[
-                                current_kernel + app_and_args + config + stat_name
-                            ] = number
-                        elif (
-                            current_kernel + app_and_args + config + stat_name
-                            in stat_map
-                        ):
-                            if stat_name in raw_last:
-                                stat_last_kernel = raw_last[stat_name]
-                            else:
-                                stat_last_kernel = 0.0
-                            raw_last[stat_name] = float(number)
-                            stat_map[
-                                current_kernel + app_and_args + config + stat_name
-                            ] += (float(number) - stat_last_kernel)
-                        else:
-                            if (
-                                last_kernel + app_and_args + config + stat_name
-                                in stat_map
-                            ):
-                                stat_last_kernel = raw_last[stat_name]
-                            else:
-                                stat_last_kernel = 0.0
-                            raw_last[stat_name] = float(number)
-                            stat_map[
-                                current_kernel + app_and_args + config + stat_name
-                            ] = (float(number) - stat_last_kernel)
+            bytes_parsed += int(fields[1])
+        elif kind == "M":
+            print(
+                "NOTE::::: Found Max Insn reached in {0} - ignoring last kernel.".format(
+                    outfile
+                ),
+                file=sys.stderr,
+            )
+        elif kind == "N":
+            if fields[1] not in all_named_kernels[app_and_args]:
+                all_named_kernels[app_and_args].append(fields[1])
+        elif kind == "S":
+            kernel, stat_name, value_type, value = fields[1:]
+            if value_type == "f":
+                value = float(value)
+            elif value_type == "i":
+                value = int(value)
+            stat_map[kernel + app_and_args + config + stat_name] = value
+        elif kind == "E":
+            exit("ERROR - " + outfile + ": " + fields[1])
+    return True
+
+
+native_extractor = os.path.join(this_directory, "stats-extract", "stats-extract")
+parsed = False
+if options.incremental:
+    # the checkpoints key on the stats and options that shape the parse
+    parse_options = json.dumps(
+        [options.per_kernel, options.kernel_instance]
+        + [[stat_name, tup[1]] for stat_name, tup in stats_to_pull.items()]
+    )
+    checkpoints = common.OutputCheckpoints(
+        os.path.join(options.run_dir, "stats_checkpoints.db"),
+        "get_stats-" + hashlib.md5(parse_options.encode()).hexdigest(),
+    )
+    for app_and_args, config, outfile in outfiles:
+        parse_outfile(app_and_args, config, outfile, checkpoints)
+    checkpoints.close()
+    parsed = True
+elif options.backend != "python" and os.access(native_extractor, os.X_OK):
+    parsed = parse_outfiles_native(outfiles)
+    if not parsed:
+        if options.backend == "native":
+            exit("ERROR - " + native_extractor + " failed")
+        print(
+            "WARNING - " + native_extractor + " failed, using the python parser",
+            file=sys.stderr,
+        )
+elif options.backend == "native":
+    exit("ERROR - " + native_extractor + " is not built, run make in stats-extract")
+if not parsed:
+    for app_and_args, config, outfile in outfiles:
+        parse_outfile(app_and_args, config, outfile)
 # Just adding this in here since it is a special case and is not parsed like everything else, because you need
 # to read from the beginning not the end
 # if options.per_kernel and not options.kernel_instance:
@@ -9,8 +9,8 @@ import sys
 import common
 import math
 import json
-from procman import ProcMan, Job
-import pickle
+import procman
+import copy
 
 
 def get_procman_status(jobId, node_details):
@@ -21,25 +21,17 @@ def get_procman_status(jobId, node_details):
         "mem_used": "UNKNOWN",
     }
 
-    out, err = subprocess.Popen(
-        [os.path.join(this_directory, "procman.py"), "-j", jobId], stdout=PIPE
-    ).communicate()
-    if out != None:
-        try:
-            procMan = pickle.load(open(out.rstrip(), "rb"))
-        except Exception as e:
-            return job_status
-        job = procMan.getJob(int(jobId))
-        if job != None:
-            job_status["state"] = job.status
-            job_status["exec_host"] = job.hostname
-            job_status["running_time"] = job.runningTime
-            job_status["mem_used"] = str(job.maxVmSize)
-            node_details[jobId] = (
-                job_status["exec_host"],
-                job_status["mem_used"],
-                job_status["running_time"],
-            )
+    job = procman.getJob(int(jobId))
+    if job != None:
+        job_status["state"] = job.status
+        job_status["exec_host"] = job.hostname
+        job_status["running_time"] = job.runningTime
+        job_status["mem_used"] = str(job.maxVmSize)
+        node_details[jobId] = (
+            job_status["exec_host"],
+            job_status["mem_used"],
+            job_status["running_time"],
+        )
 
     if jobId in node_details:
         (
@@ -223,6 +215,107 @@ def millify(n):
     return "{:.0f}{}".format(n / 10 ** (3 * millidx), millnames[millidx])
 
 
+# Only the last 10000 lines of the output and error files are searched
+MAX_LINES = 10000
+
+
+# Offset of the last MAX_LINES lines of sim_file, read back from its end
+def get_tail_offset(sim_file):
+    BLOCK_BYTES = 1024 * 1024
+    with open(sim_file, "rb") as f:
+        offset = f.seek(0, os.SEEK_END)
+        newlines = 0
+        while offset > 0:
+            size = min(BLOCK_BYTES, offset)
+            offset -= size
+            f.seek(offset)
+            block = f.read(size)
+            newlines += block.count(b"\n")
+            if newlines > MAX_LINES:
+                # skip the lines in front of the last MAX_LINES
+                end = -1
+                for i in range(newlines - MAX_LINES):
+                    end = block.index(b"\n", end + 1)
+                offset += end + 1
+                break
+    return offset
+
+
+def search_line(state, line):
+    line = line.rstrip()
+    statuses = []
+    for token, name in status_strings.items():
+        if re.search(token, line):
+            statuses.append(name)
+    stats = []
+    for name, token in stats_to_pull.items():
+        existance_test = re.search(token, line)
+        if existance_test != None:
+            stats.append([name, existance_test.group(1).strip()])
+    if len(statuses) > 0 or len(stats) > 0:
+        state["matches"].append([state["lines"], statuses, stats])
+    state["lines"] += 1
+
+
+# Records the lines of sim_file that hold a status string or a stat, numbered
+# from where the search started, so the search can resume from the offset
+def search_sim_file(sim_file, checkpoints):
+    offset, state = 0, None
+    if checkpoints != None:
+        offset, state = checkpoints.load(sim_file)
+    if state == None:
+        offset = get_tail_offset(sim_file)
+        state = {"lines": 0, "matches": []}
+
+    for line, offset in common.read_new_lines(sim_file, offset):
+        search_line(state, line)
+
+    # lines further back than where the search stops will never be looked at
+    first = len(state["matches"])
+    for found in replay_matches(state, set(), set(), []):
+        first -= 1
+    state["matches"] = state["matches"][first:]
+    if checkpoints != None:
+        checkpoints.save(sim_file, offset, state)
+
+    # the last line may still be being written, it is searched again next time
+    last_lines = list(common.read_new_lines(sim_file, offset, True))
+    if len(last_lines) > 0:
+        state = copy.deepcopy(state)
+    for line, offset in last_lines:
+        search_line(state, line)
+    return state
+
+
+# Goes up the matching lines the way a reverse search of the file would:
+# within the last MAX_LINES lines, until every stat and some status is found
+def replay_matches(state, status_found, stat_found, additional_stats):
+    for line_num, statuses, stats in reversed(state["matches"]):
+        count = state["lines"] - line_num
+        if count >= MAX_LINES:
+            break
+        # the search stops after any line once everything is found
+        if (
+            count > 1
+            and len(stat_found) == len(stats_to_pull)
+            and len(status_found) > 0
+        ):
+            break
+        yield line_num
+        # search for the failue conditions
+        for name in statuses:
+            status_found.add(name)
+
+        # pull out some stats
+        for name, number in stats:
+            if name in stat_found:
+                continue
+            stat_found.add(name)
+            if isNumber(number):
+                number = millify(number)
+            additional_stats.append("{0}={1}".format(name, number))
+
+
 # *********************************************************--
 # main script start
 # *********************************************************--
@@ -272,6 +365,14 @@ parser.add_option(
     + ' logfile with "-l"',
     default="",
 )
+parser.add_option(
+    "-i",
+    "--incremental",
+    dest="incremental",
+    action="store_true",
+    help="Remember how far each output file was searched in "
+    + "<run_dir>/stats_checkpoints.db and only search what was appended since.",
+)
 (options, args) = parser.parse_args()
 options.logfile = options.logfile.strip()
 options.num_lines = options.num_lines.strip()
@@ -383,6 +484,12 @@ ROW_STRING = (
     + "{stat:50}\t"
 )
 
+checkpoints = None
+if options.incremental:
+    checkpoints = common.OutputCheckpoints(
+        os.path.join(options.run_dir, "stats_checkpoints.db"), "job_status"
+    )
+
 # At this point we have the logfile we want to get a synopsis for.
 for logfile in parsed_logfiles:
     if not os.path.isfile(logfile):
@@ -454,7 +561,15 @@ for logfile in parsed_logfiles:
             stat_found = set()
             status_found = set()
 
-            if job_manager == "squeue":
+            if jobId == common.RESULT_CACHE_JOB_ID:
+                # the output was copied from the result cache, nothing was launched
+                job_status = {
+                    "state": "COMPLETE_NO_OTHER_INFO",
+                    "exec_host": "result_cache",
+                    "running_time": "0",
+                    "mem_used": "UNKNOWN",
+                }
+            elif job_manager == "squeue":
                 job_status = get_squeue_status(jobId, node_details)
             elif job_manager == "qstat":
                 job_status = get_qstat_status(jobId)
@@ -473,6 +588,14 @@ for logfile in parsed_logfiles:
             ):
                 files_to_check = [outfile, errfile]
                 status_string = "COMPLETE_NO_OTHER_INFO"
+                if jobId != common.RESULT_CACHE_JOB_ID:
+                    try:
+                        common.store_finished_run(output_dir, jobId)
+                    except (OSError, IOError, ValueError, KeyError) as e:
+                        errs += (
+                            "Failed to store job {0} in the result cache: "
+                            "{1}\n".format(jobId, e)
+                        )
             else:
                 files_to_check = []
                 status_string = "NOT_RUNNING_NO_OUTPUT"
@@ -484,42 +607,17 @@ for logfile in parsed_logfiles:
                 mem_used = "UNKNOWN"
             running_time = job_status["running_time"]
 
+            found_stats = []
             for sim_file in files_to_check:
                 if not os.path.isfile(sim_file):
                     print("WARNING - " + sim_file + " does not exist")
                     continue
-
-                # Only go up for 1000 lines looking for stuff
-                MAX_LINES = 10000
-                count = 0
-                for line in reversed(open(sim_file).readlines()):
-                    count += 1
-                    if count >= MAX_LINES:
-                        break
-                    # search for the failue conditions
-                    for token, name in status_strings.items():
-                        if name in status_found:
-                            continue
-                        if re.search(token, line.rstrip()):
-                            failed = True
-                            status_found.add(name)
-
-                    # pull out some stats
-                    for name, token in stats_to_pull.items():
-                        if token in stat_found:
-                            continue
-                        existance_test = re.search(token, line.rstrip())
-                        if existance_test != None:
-                            stat_found.add(token)
-                            number = existance_test.group(1).strip()
-                            if isNumber(number):
-                                number = millify(number)
-                            if additional_stats != "":
-                                additional_stats += "\t{0}={1}".format(name, number)
-                            else:
-                                additional_stats = "{0}={1}".format(name, number)
-                    if len(stat_found) == len(stats_to_pull) and len(status_found) > 0:
-                        break
+                state = search_sim_file(sim_file, checkpoints)
+                for found in replay_matches(
+                    state, status_found, stat_found, found_stats
+                ):
+                    pass
+            additional_stats = "\t".join(found_stats)
 
             if len(status_found) > 0:
                 status_string = ", ".join(status_found)
@@ -609,3 +707,6 @@ for logfile in parsed_logfiles:
             print("failed job log written to {0}".format(failed_job_filename))
 
     json.dump(node_details, open(node_details_file, "w+"))
+
+if checkpoints != None:
+    checkpoints.close()
@@ -58,6 +58,7 @@ def print_statsfile(options, this_directory):
         subprocess.call(
             [
                 os.path.join(this_directory, "get_stats.py"),
+                "-i",
                 "-R",
                 "-l",
                 options.logfile,
@@ -200,6 +201,7 @@ while True:
         subprocess.call(
             [
                 os.path.join(this_directory, "job_status.py"),
+                "-i",
                 "-l",
                 options.logfile,
                 "-N",
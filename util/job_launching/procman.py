@@ -52,10 +52,21 @@
 # ...
 # ./procman.py mybash26.sh
 # ./procman.py -S
-# And it will work, launching 2 procmans that loosely co-ordinate resource usage.
+# And it will work, launching 2 procmans that share the cores and memory of the node.
 # By default procman will attempt to launch as many jobs as there are cores on the machine
 # this can be changes with the "-c <numCores>" option.
 #
+# Jobs are also packed by memory, so that big simulations are not co-scheduled
+# into swap. Each job reserves the peak resident memory previous runs of the same
+# app/args/config reached on this node. Without history, it reserves what its
+# script asks for (#SBATCH --mem-per-cpu) or an estimate from the size of its
+# largest kernel trace, whichever is larger. The memory procman hands out is
+# the total memory of the node, which can be changed with "-m <size>".
+#
+# All the procmans of a node keep their jobs and the memory history in one
+# sqlite database, procman/procman.<hostname>.db. A tick only writes the jobs
+# that changed.
+#
 #   Some other useful commands:
 #   ./procman.py -s # launches a self-test to confirm that procman is working (takes 1-2 mins)
 #   ./procman.py -p # prints the state of all procmans and their jobs
@@ -70,7 +81,7 @@
 
 
 from optparse import OptionParser
-import pickle
+import sqlite3
 import subprocess
 from subprocess import Popen, PIPE
 import common
@@ -89,11 +100,116 @@ import copy
 this_directory = os.path.dirname(os.path.realpath(__file__)) + "/"
 procManStateFolder = os.path.join(this_directory, "procman")
 procManStateFile = os.path.join(
-    procManStateFolder, "procman.{0}.pickle".format(socket.gethostname().strip())
+    procManStateFolder, "procman.{0}.db".format(socket.gethostname().strip())
 )
 
+# Without history, a trace-driven job is assumed to need this much memory on
+# top of its largest kernel trace. xz compressed traces are assumed to expand
+# TRACE_XZ_RATIO times.
+TRACE_BASE_MEM = 1024 * 1024 * 1024
+TRACE_XZ_RATIO = 8
+# Margin over the peak resident memory of the previous runs
+HISTORY_MEM_MARGIN = 1.2
+# A queued job that does not fit can be overtaken by at most this many of the
+# jobs queued behind it, then nothing else starts before it. This counts jobs,
+# not ticks: several jobs may overtake it in a single tick.
+MAX_SKIPS = 20
+
+STATE_SCHEMA = """
+CREATE TABLE IF NOT EXISTS procmans (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    tickingProcess INTEGER,
+    jobLimit INTEGER,
+    memLimit INTEGER
+);
+CREATE TABLE IF NOT EXISTS jobs (
+    id INTEGER PRIMARY KEY AUTOINCREMENT,
+    procMan INTEGER,
+    name TEXT,
+    outF TEXT,
+    errF TEXT,
+    workingDir TEXT,
+    command TEXT,
+    historyKey TEXT,
+    cores INTEGER,
+    memEstimate INTEGER,
+    status TEXT,
+    procId INTEGER,
+    hostname TEXT,
+    maxVmSize INTEGER,
+    maxRss INTEGER,
+    runningTime TEXT,
+    skips INTEGER
+);
+CREATE TABLE IF NOT EXISTS memory_history (
+    historyKey TEXT PRIMARY KEY,
+    maxRss INTEGER,
+    runs INTEGER
+);
+"""
+
+
+def openState(stateFile):
+    db = sqlite3.connect(stateFile, timeout=600)
+    db.row_factory = sqlite3.Row
+    db.executescript(STATE_SCHEMA)
+    return db
+
+
+# "4G", "900M" or a plain number of megabytes, as slurm takes them
+def parseMemSize(size):
+    match = re.match(r"^\s*([0-9.]+)\s*([KMGT]?)B?\s*$", str(size).upper())
+    if match == None:
+        return 0
+    scale = {"K": 1, "M": 2, "": 2, "G": 3, "T": 4}[match.group(2)]
+    return int(float(match.group(1)) * 1024**scale)
+
+
+def formatMemSize(size):
+    for unit in ["", "K", "M", "G"]:
+        if size < 1024:
+            return "{0:.0f}{1}".format(size, unit)
+        size /= 1024.0
+    return "{0:.1f}T".format(size)
+
+
+# The trace directory run_simulations.py links into the run directory
+def getTraceMemEstimate(workingDir):
+    tracesDir = os.path.join(workingDir, "traces")
+    kernelslist = os.path.join(tracesDir, "kernelslist.g")
+    if not os.path.isfile(kernelslist):
+        return 0
+    largest = 0
+    for line in open(kernelslist):
+        traceFile = os.path.join(tracesDir, line.strip())
+        if not os.path.isfile(traceFile):
+            continue
+        if traceFile.endswith(".traceg"):
+            largest = max(largest, os.path.getsize(traceFile))
+        elif traceFile.endswith(".traceg.xz"):
+            largest = max(largest, os.path.getsize(traceFile) * TRACE_XZ_RATIO)
+    return TRACE_BASE_MEM + largest
+
 
 class Job:
+    FIELDS = [
+        "name",
+        "outF",
+        "errF",
+        "workingDir",
+        "command",
+        "historyKey",
+        "cores",
+        "memEstimate",
+        "status",
+        "procId",
+        "hostname",
+        "maxVmSize",
+        "maxRss",
+        "runningTime",
+        "skips",
+    ]
+
     def __init__(self, outF, errF, workingDir, command):
         self.outF = outF
         self.errF = errF
@@ -102,25 +218,33 @@ class Job:
         self.procId = None
         self.POpenObj = None
         self.maxVmSize = 0
+        self.maxRss = 0
         self.runningTime = 0
         self.status = "WAITING_TO_RUN"
         self.name = None
         self.id = None
         self.hostname = "UNKNOWN"
-
-    def __getstate__(self):
-        state = self.__dict__.copy()
-        del state["POpenObj"]
-        return state
-
-    def __setstate__(self, state):
-        self.__dict__.update(state)
-        self.POpenObj = None
+        # run directories are <run_dir>/<app>/<args>/<config>
+        self.historyKey = os.path.join(
+            *os.path.abspath(workingDir).split(os.sep)[-3:]
+        )
+        self.cores = 1
+        self.memEstimate = 0
+        self.skips = 0
+
+    @classmethod
+    def fromRow(cls, row):
+        job = cls(row["outF"], row["errF"], row["workingDir"], row["command"])
+        for field in Job.FIELDS:
+            setattr(job, field, row[field])
+        job.id = row["id"]
+        return job
 
     def string(self):
         return (
             "status={0}: [name={8},procId={1},maxVmSize={2},runningTime={3},outF={4},"
-            "errF={5},workingDir={6},command={7}]".format(
+            "errF={5},workingDir={6},command={7},cores={9},mem={10},"
+            "maxRss={11}]".format(
                 self.status,
                 self.procId,
                 self.maxVmSize,
@@ -130,6 +254,9 @@ class Job:
                 self.workingDir,
                 self.command,
                 self.name,
+                self.cores,
+                formatMemSize(self.memEstimate),
+                formatMemSize(self.maxRss),
             )
         )
 
@@ -141,48 +268,127 @@ class Job:
 
 
 class ProcMan:
-    def __init__(self, jobLimit, pickleFile):
-        self.initialize(jobLimit, pickleFile)
+    # Creates a new procman in stateFile, or loads procManId from it
+    def __init__(
+        self, jobLimit, memLimit=None, stateFile=procManStateFile, procManId=None
+    ):
+        self.stateFile = stateFile
+        self.db = openState(stateFile)
+        self.queuedJobs = []
+        self.activeJobs = {}
+        self.completeJobs = {}
+        if procManId == None:
+            if memLimit == None:
+                memLimit = psutil.virtual_memory().total
+            self.id = self.db.execute(
+                "INSERT INTO procmans (jobLimit, memLimit) VALUES (?, ?)",
+                (int(jobLimit), int(memLimit)),
+            ).lastrowid
+            self.db.commit()
+        else:
+            self.id = procManId
+            for row in self.db.execute(
+                "SELECT * FROM jobs WHERE procMan = ? ORDER BY id", (self.id,)
+            ):
+                job = Job.fromRow(row)
+                if job.status == "WAITING_TO_RUN":
+                    self.queuedJobs.append(job)
+                elif job.status == "RUNNING":
+                    self.activeJobs[job.id] = job
+                else:
+                    self.completeJobs[job.id] = job
+        row = self.db.execute(
+            "SELECT * FROM procmans WHERE id = ?", (self.id,)
+        ).fetchone()
+        self.jobLimit = row["jobLimit"]
+        self.memLimit = row["memLimit"]
+        self.tickingProcess = row["tickingProcess"]
+        self.mutable = self.tickingProcess == None
+
+    # The procman new jobs are queued to, the one not started yet
+    @classmethod
+    def forQueuing(cls, jobLimit, memLimit=None, stateFile=procManStateFile):
+        row = (
+            openState(stateFile)
+            .execute("SELECT id FROM procmans WHERE tickingProcess IS NULL")
+            .fetchone()
+        )
+        if row == None:
+            return cls(jobLimit, memLimit, stateFile)
+        return cls(jobLimit, memLimit, stateFile, row["id"])
+
+    def saveJob(self, job):
+        self.db.execute(
+            "UPDATE jobs SET "
+            + ", ".join(field + " = ?" for field in Job.FIELDS)
+            + " WHERE id = ?",
+            [getattr(job, field) for field in Job.FIELDS] + [job.id],
+        )
 
-    def __init__(self, jobLimit):
-        self.initialize(jobLimit, procManStateFile)
+    def setLimits(self, jobLimit, memLimit):
+        self.jobLimit = int(jobLimit)
+        if memLimit != None:
+            self.memLimit = int(memLimit)
+        self.db.execute(
+            "UPDATE procmans SET jobLimit = ?, memLimit = ? WHERE id = ?",
+            (self.jobLimit, self.memLimit, self.id),
+        )
+        self.db.commit()
 
-    def saveState(self):
-        pickle.dump(self, open(self.pickleFile, "wb+"))
+    def setTickingProcess(self, pid):
+        self.tickingProcess = pid
+        self.db.execute(
+            "UPDATE procmans SET tickingProcess = ? WHERE id = ?", (pid, self.id)
+        )
+        self.db.commit()
 
     def clear(self):
         if not self.mutable or len(self.activeJobs) > 0 or len(self.completeJobs) > 0:
             sys.exit("ProcMans that have been started should not be cleared")
+        self.db.execute("DELETE FROM jobs WHERE procMan = ?", (self.id,))
+        self.db.commit()
         del self.queuedJobs[:]
 
-    def initialize(self, jobLimit, pickleFile):
-        self.queuedJobs = []
-        self.activeJobs = {}
-        self.completeJobs = {}
-        self.jobLimit = int(jobLimit)
-        self.nextJobId = 1
-        self.tickingProcess = None
-        self.mutable = True
-        self.pickleFile = pickleFile
-
     def queueJob(self, job):
         if not self.mutable:
             sys.exit(
                 "This ProcMan has already been started. No new jobs can be queued."
             )
-        job.id = self.nextJobId
+        job.memEstimate = self.getMemEstimate(job)
+        job.id = self.db.execute(
+            "INSERT INTO jobs (procMan) VALUES (?)", (self.id,)
+        ).lastrowid
+        self.saveJob(job)
+        self.db.commit()
         self.queuedJobs.append(job)
-        self.nextJobId += 1
         return job.id
 
+    def getMemEstimate(self, job):
+        row = self.db.execute(
+            "SELECT maxRss FROM memory_history WHERE historyKey = ?",
+            (job.historyKey,),
+        ).fetchone()
+        if row != None:
+            return int(row["maxRss"] * HISTORY_MEM_MARGIN)
+        return max(job.memEstimate, getTraceMemEstimate(job.workingDir))
+
     def spawnProcMan(self, sleepTime):
         if not self.mutable:
             sys.exit(
                 "This ProcMan has already been started. No new spawning can occur."
             )
-        shutil.copy(self.pickleFile, self.pickleFile + ".tmp")
+        # new jobs go to a new procman from now on
+        self.setTickingProcess(0)
         p = Popen(
-            [__file__, "-f", self.pickleFile + ".tmp", "-t", str(sleepTime)],
+            [
+                __file__,
+                "-f",
+                self.stateFile,
+                "-r",
+                str(self.id),
+                "-t",
+                str(sleepTime),
+            ],
             cwd=this_directory,
         )
         print("ProcMan spawned [pid={0}]".format(p.pid))
@@ -197,12 +403,11 @@ class ProcMan:
                 continue
             for child in p.children(recursive=True):
                 os.kill(child.pid, 9)
-        os.kill(activeJob.procId, 9)
+            os.kill(activeJob.procId, 9)
 
     def tick(self):
-        if self.tickingProcess == None:
-            self.tickingProcess = os.getpid()
-            self.pickleFile = self.pickleFile + ".{0}".format(self.tickingProcess)
+        if self.tickingProcess == None or self.tickingProcess == 0:
+            self.setTickingProcess(os.getpid())
         elif self.tickingProcess != os.getpid():
             sys.exit(
                 "To support concurrent ProcMans in different processes, each procman can only be ticked by one process"
@@ -227,10 +432,15 @@ class ProcMan:
             if jobActive:
                 try:
                     p = psutil.Process(activeJob.procId)
-                    mem = p.memory_info().vms
+                    mem = p.memory_info()
+                    vms = mem.vms
+                    rss = mem.rss
                     for child in p.children(recursive=True):
-                        mem += child.memory_info().vms
-                    activeJob.maxVmSize = max(mem, activeJob.maxVmSize)
+                        mem = child.memory_info()
+                        vms += mem.vms
+                        rss += mem.rss
+                    activeJob.maxVmSize = max(vms, activeJob.maxVmSize)
+                    activeJob.maxRss = max(rss, activeJob.maxRss)
                     activeJob.runningTime = (
                         datetime.datetime.now()
                         - datetime.datetime.fromtimestamp(p.create_time())
@@ -242,17 +452,43 @@ class ProcMan:
                 activeJob.status = "COMPLETE_NO_OTHER_INFO"
                 self.completeJobs[activeJob.id] = activeJob
                 jobsMoved.add(activeJob.id)
+                self.recordMemory(activeJob)
+            self.saveJob(activeJob)
+            if not jobActive:
+                # the cache is shared, possibly over NFS, and a full disk or
+                # a stale handle there must not take the queued jobs down
+                try:
+                    common.store_finished_run(activeJob.workingDir, str(activeJob.id))
+                except (OSError, IOError, ValueError, KeyError) as e:
+                    print(
+                        "Failed to store job {0} in the result cache: {1}".format(
+                            activeJob.id, e
+                        )
+                    )
 
         for jobId in jobsMoved:
             del self.activeJobs[jobId]
 
-        othersCores = self.getCPUCountFromOtherProcMans()
-
-        # launch new jobs when old ones complete
-        while (len(self.activeJobs) + othersCores) < self.jobLimit and len(
-            self.queuedJobs
-        ) > 0:
-            newJob = self.queuedJobs.pop(0)
+        # launch new jobs when old ones complete, first the ones that fit
+        usedCores, usedMem = self.getResourcesInUse()
+        waiting = []
+        for newJob in list(self.queuedJobs):
+            # a job bigger than the node runs on its own
+            mem = min(newJob.memEstimate, self.memLimit)
+            if usedCores > 0 and (
+                usedCores + newJob.cores > self.jobLimit
+                or usedMem + mem > self.memLimit
+            ):
+                if newJob.skips >= MAX_SKIPS:
+                    break
+                waiting.append(newJob)
+                continue
+            # every job that starts ahead of a waiting one counts as a skip
+            for waitingJob in waiting:
+                waitingJob.skips += 1
+                self.saveJob(waitingJob)
+            waiting = []
+            self.queuedJobs.remove(newJob)
             newJob.POpenObj = Popen(
                 newJob.command,
                 stdout=open(newJob.outF, "w+"),
@@ -263,16 +499,38 @@ class ProcMan:
             newJob.hostname = socket.gethostname().strip()
             newJob.status = "RUNNING"
             self.activeJobs[newJob.id] = newJob
-
-    def getCPUCountFromOtherProcMans(self):
-        othersCores = 0
-        for pickleFile in glob.glob(
-            os.path.join(os.path.dirname(self.pickleFile), "*pickle*")
+            self.saveJob(newJob)
+            usedCores += newJob.cores
+            usedMem += mem
+        self.db.commit()
+
+    # Cores and memory held by the running jobs of every procman on the node.
+    # A job reserves its estimate until it uses more.
+    def getResourcesInUse(self):
+        usedCores = 0
+        usedMem = 0
+        for row in self.db.execute(
+            "SELECT procId, cores, memEstimate, maxRss FROM jobs "
+            + "WHERE status = 'RUNNING'"
         ):
-            if pickleFile != self.pickleFile:
-                otherProcMan = pickle.load(open(pickleFile, "rb"))
-                othersCores += len(otherProcMan.activeJobs)
-        return othersCores
+            # jobs of a procman that was killed may be long gone
+            try:
+                os.kill(row["procId"], 0)
+            except OSError:
+                continue
+            usedCores += row["cores"]
+            usedMem += min(max(row["memEstimate"], row["maxRss"]), self.memLimit)
+        return usedCores, usedMem
+
+    def recordMemory(self, job):
+        if job.maxRss == 0:
+            return
+        self.db.execute(
+            "INSERT INTO memory_history VALUES (?, ?, 1) "
+            + "ON CONFLICT(historyKey) DO UPDATE SET "
+            + "maxRss = max(maxRss, excluded.maxRss), runs = runs + 1",
+            (job.historyKey, job.maxRss),
+        )
 
     def getState(self):
         string = "queuedJobs={0}, activeJobs={1}, completeJobs={2}\n".format(
@@ -306,6 +564,28 @@ class ProcMan:
         return len(self.queuedJobs) == 0 and len(self.activeJobs) == 0
 
 
+# The procmans of stateFile with jobs still queued or running
+def getActiveProcMans(stateFile=procManStateFile):
+    procMans = []
+    for row in openState(stateFile).execute(
+        "SELECT DISTINCT procMan FROM jobs WHERE status IN "
+        + "('WAITING_TO_RUN', 'RUNNING') ORDER BY procMan"
+    ):
+        procMans.append(ProcMan(0, stateFile=stateFile, procManId=row["procMan"]))
+    return procMans
+
+
+def getJob(jobId, stateFile=procManStateFile):
+    if not os.path.exists(stateFile):
+        return None
+    row = (
+        openState(stateFile).execute("SELECT * FROM jobs WHERE id = ?", (jobId,))
+    ).fetchone()
+    if row == None:
+        return None
+    return Job.fromRow(row)
+
+
 def selfTest():
     testPath = os.path.join(this_directory, "test")
     if not os.path.isdir(testPath):
@@ -317,7 +597,7 @@ def selfTest():
     os.chmod(jobScript, st.st_mode | stat.S_IEXEC)
 
     print("Starting synchronous selfTest")
-    procMan = ProcMan(4)
+    procMan = ProcMan(4, stateFile=os.path.join(testPath, "procman.db"))
     for i in range(5):
         procMan.queueJob(
             Job(
@@ -335,6 +615,27 @@ def selfTest():
         time.sleep(3)
     print("Passed synchronous selfTest")
 
+    print("Starting memory packing selfTest")
+    procMan = ProcMan(
+        4, memLimit=3 * 1024**3, stateFile=os.path.join(testPath, "procman-mem.db")
+    )
+    for i in range(3):
+        job = Job(
+            outF=os.path.join(testPath, "out.{0}.txt".format(i)),
+            errF=os.path.join(testPath, "err.{0}.txt".format(i)),
+            workingDir=testPath,
+            command=jobScript,
+        )
+        job.memEstimate = 2 * 1024**3
+        procMan.queueJob(job)
+    while not procMan.complete():
+        procMan.tick()
+        print(procMan.getState())
+        if len(procMan.activeJobs) > 1:
+            sys.exit("Two 2G jobs were co-scheduled in 3G")
+        time.sleep(3)
+    print("Passed memory packing selfTest")
+
     print("Starting asynchronous selfTest")
     for i in range(int(psutil.cpu_count() * 1.2)):
         jobScript = os.path.join(testPath, "testSlurm.{0}.sh".format(i))
@@ -438,7 +739,7 @@ def main():
         "-f",
         "--file",
         dest="file",
-        help="File with the processes to manage.",
+        help="The sqlite database holding the procmans of this node.",
         default=procManStateFile,
     )
     parser.add_option(
@@ -457,6 +758,14 @@ def main():
         type=int,
         default=psutil.cpu_count(),
     )
+    parser.add_option(
+        "-m",
+        "--mem",
+        dest="mem",
+        help="how much memory the jobs can use, i.e. 64G. "
+        + "By default, all the memory of the node",
+        default=None,
+    )
     parser.add_option(
         "-S",
         "--start",
@@ -484,34 +793,42 @@ def main():
         dest="procManForJob",
         default=None,
         type=int,
-        help="Return the path of the pickle file for the ProcMan managing this job.",
+        help="Print the state of this job.",
+    )
+    parser.add_option(
+        "-r",
+        "--run",
+        dest="run",
+        default=None,
+        type=int,
+        help="Manage the jobs of this procman until they are done. Used by -S.",
     )
     (options, args) = parser.parse_args()
+    memLimit = None
+    if options.mem != None:
+        memLimit = parseMemSize(options.mem)
 
     if options.selfTest:
         selfTest()
     elif options.kill:
-        procmanfiles = glob.glob(options.file + ".*")
-        for f in procmanfiles:
-            print("Killing active jobs in Procman: {0}".format(os.path.basename(f)))
-            procMan = pickle.load(open(f, "rb"))
+        for procMan in getActiveProcMans(options.file):
+            print("Killing active jobs in Procman: {0}".format(procMan.id))
             procMan.killJobs()
     elif options.printState:
         numProcMans = 0
         numQueued = 0
         numActive = 0
         numComplete = 0
-        procmanfiles = glob.glob(options.file + ".*")
-        if len(procmanfiles) == 0:
+        procMans = getActiveProcMans(options.file)
+        if len(procMans) == 0:
             print("Nothing Active")
         else:
-            for f in procmanfiles:
+            for procMan in procMans:
                 numProcMans += 1
-                procMan = pickle.load(open(f, "rb"))
                 numQueued += len(procMan.queuedJobs)
                 numActive += len(procMan.activeJobs)
                 numComplete += len(procMan.completeJobs)
-                print("Procman: {0}".format(os.path.basename(f)))
+                print("Procman: {0}".format(procMan.id))
                 print(procMan.getState())
             print(
                 "Total Procmans={0}, Total Queued={1}, Total Running={2}, Total Complete={3}".format(
@@ -519,41 +836,28 @@ def main():
                 )
             )
     elif options.start:
-        if not os.path.exists(options.file):
-            sys.exit("Nothing to start {0} does not exist".format(options.file))
-        procMan = pickle.load(open(options.file, "rb"))
-        if procMan.jobLimit != int(options.cores):
-            procMan.jobLimit = int(options.cores)
-            procMan.saveState()
+        procMan = ProcMan.forQueuing(options.cores, memLimit, options.file)
+        if len(procMan.queuedJobs) == 0:
+            sys.exit("Nothing to start in {0}".format(options.file))
+        procMan.setLimits(options.cores, memLimit)
         procMan.spawnProcMan(options.sleepTime)
-        procMan.clear()
-        procMan.saveState()
     elif options.procManForJob != None:
-        procmanfiles = glob.glob(options.file + ".*")
-        for f in procmanfiles:
-            procMan = pickle.load(open(f, "rb"))
-            j = procMan.getJob(options.procManForJob)
-            if j != None:
-                print(procMan.pickleFile)
-                break
+        job = getJob(options.procManForJob, options.file)
+        if job != None:
+            print(job)
     elif len(args) == 1:
         # To make this work the same as torque and slurm - if you just give it one argument,
         # we assume it's a pointer to a job file you want to submit.
-        if os.path.exists(options.file):
-            procMan = pickle.load(open(options.file, "rb"))
-            if not procMan.mutable:
-                sys.exit("Error - this procman has already started")
-        else:
-            procMan = ProcMan(options.cores)
+        procMan = ProcMan.forQueuing(options.cores, memLimit, options.file)
         exec_file = args[0]
         st = os.stat(exec_file)
         os.chmod(exec_file, st.st_mode | stat.S_IEXEC)
 
         # slurmToJob
-        job = Job("", "", os.getcwd(), exec_file)
-        job.id = procMan.queueJob(job)
-        contents = ""
-        for line in open(exec_file).readlines():
+        job = Job("", "", os.getcwd(), os.path.abspath(exec_file))
+        memPerCore = False
+        lines = open(exec_file).readlines()
+        for line in lines:
             if line.startswith("#SBATCH"):
                 nameMatch = re.match(r"#SBATCH -J (.*)", line.strip())
                 if nameMatch:
@@ -564,6 +868,19 @@ def main():
                 errFMatch = re.match(r"#SBATCH --error=(.*)", line.strip())
                 if errFMatch:
                     job.errF = errFMatch.group(1)
+                coresMatch = re.match(r"#SBATCH --cpus-per-task=(\d+)", line.strip())
+                if coresMatch:
+                    job.cores = int(coresMatch.group(1))
+                memMatch = re.match(r"#SBATCH --mem(-per-cpu)?=(.*)", line.strip())
+                if memMatch:
+                    job.memEstimate = parseMemSize(memMatch.group(2))
+                    memPerCore = memMatch.group(1) != None
+        if memPerCore:
+            job.memEstimate *= job.cores
+        job.id = procMan.queueJob(job)
+
+        contents = ""
+        for line in lines:
             line = re.sub(r"\$SLURM_JOB_ID", str(job.id), line)
             contents += line
         with open(exec_file, "w+") as f:
@@ -571,29 +888,18 @@ def main():
 
         job.outF = re.sub("\%j", str(job.id), job.outF)
         job.errF = re.sub("\%j", str(job.id), job.errF)
-        procMan.saveState()
+        procMan.saveJob(job)
+        procMan.db.commit()
         print(job.id)
+    elif options.run != None:
+        procMan = ProcMan(0, stateFile=options.file, procManId=options.run)
+        if procMan.tickingProcess != 0:
+            sys.exit("This procman is already running {0}".format(procMan.id))
+        while not procMan.complete():
+            procMan.tick()
+            time.sleep(options.sleepTime)
     else:
-        options.file = common.file_option_test(options.file, "", this_directory)
-        if options.file == "":
-            sys.exit(
-                "Please specify the file containing the processes to manage with -f."
-            )
-        procMan = pickle.load(open(options.file, "rb"))
-        if procMan.tickingProcess != None:
-            sys.exit(
-                "This procman is already running {0}".format(
-                    os.path.basename(options.file)
-                )
-            )
-        procMan.pickleFile = options.file
-        os.remove(options.file)
-        if len(procMan.queuedJobs) > 0:
-            while not procMan.complete():
-                procMan.tick()
-                procMan.saveState()
-                time.sleep(options.sleepTime)
-            os.remove(procMan.pickleFile)
+        parser.print_help()
 
 
 if __name__ == "__main__":
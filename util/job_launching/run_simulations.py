@@ -41,6 +41,9 @@ import shutil
 import glob
 import datetime
 import yaml
+import json
+import getpass
+import heapq
 import common
 
 this_directory = os.path.dirname(os.path.realpath(__file__)) + "/"
@@ -83,7 +86,9 @@ class ConfigurationSpec:
         print("Parameters = " + self.params)
         print("Base config file = " + self.config_file)
 
-    def run(self, build_handle, benchmarks, run_directory, cuda_version, simdir):
+    def run(
+        self, build_handle, benchmarks, run_directory, cuda_version, simdir, jobs
+    ):
         for dir_bench in benchmarks:
             exec_dir, data_dir, benchmark, self.command_line_args_list = dir_bench
             full_exec_dir = ""  # For traces it is not necessary to have the apps built
@@ -121,7 +126,7 @@ class ConfigurationSpec:
                     full_data_dir, this_run_dir, data_dir, appargs_run_subdir
                 )
 
-                self.text_replace_torque_sim(
+                sim_name = self.text_replace_torque_sim(
                     full_data_dir,
                     this_run_dir,
                     benchmark,
@@ -132,36 +137,45 @@ class ConfigurationSpec:
                     build_handle,
                     mem_usage,
                 )
-                self.append_gpgpusim_config(
+                config_text = self.append_gpgpusim_config(
                     benchmark, this_run_dir, appargs_run_subdir, self.config_file
                 )
 
-                # Submit the job to torque and dump the output to a file
-                if not options.no_launch:
-                    torque_out_filename = this_directory + "torque_out.{0}.txt".format(
-                        os.getpid()
+                runtime_history.record_outputs(
+                    this_run_dir,
+                    benchmark,
+                    self.benchmark_args_subdirs[args],
+                    self.run_subdir,
+                )
+
+                job = {
+                    "run_dir": this_run_dir,
+                    "sim_name": sim_name,
+                    "cache_key": None,
+                    "benchmark": benchmark,
+                    "args": self.benchmark_args_subdirs[args],
+                    "config": self.run_subdir,
+                    "build_handle": build_handle,
+                }
+                if result_cache != None:
+                    self.store_last_run(this_run_dir)
+                    job["cache_key"] = result_cache.key(
+                        common.ResultCache.build_id(build_handle),
+                        options.benchmark_exec_prefix,
+                        config_text,
+                        self.get_config_files(),
+                        os.path.join(this_run_dir, "traces"),
                     )
-                    torque_out_file = open(torque_out_filename, "w+")
-                    saved_dir = os.getcwd()
-                    os.chdir(this_run_dir)
-                    if (
-                        subprocess.call(
-                            [job_submit_call, os.path.join(this_run_dir, job_template)],
-                            stdout=torque_out_file,
-                        )
-                        < 0
-                    ):
-                        exit("Error Launching Job")
-                    else:
-                        # Parse the torque output for just the numeric ID
-                        torque_out_file.seek(0)
-                        torque_out = re.sub(
-                            r"[^\d]*(\d*).*", r"\1", torque_out_file.read().strip()
-                        )
+
+                if not options.no_launch and job["cache_key"] != None:
+                    job_id = self.fetch_cached_run(
+                        job["cache_key"], this_run_dir, sim_name
+                    )
+                    if job_id != None:
                         print(
                             "Job "
-                            + torque_out
-                            + " queued ("
+                            + job_id
+                            + " taken from the result cache ("
                             + benchmark
                             + "-"
                             + self.benchmark_args_subdirs[args]
@@ -169,50 +183,45 @@ class ConfigurationSpec:
                             + self.run_subdir
                             + ")"
                         )
-                    torque_out_file.close()
-                    os.remove(torque_out_filename)
-                    os.chdir(saved_dir)
-
-                    if len(torque_out) > 0:
-                        # Dump the benchmark description to the logfile
-                        if not os.path.exists(this_directory + "logfiles/"):
-                            # In the very rare case that concurrent builds try to make the directory at the same time
-                            # (after the test to os.path.exists -- this has actually happened...)
-                            try:
-                                os.makedirs(this_directory + "logfiles/")
-                            except:
-                                pass
-                        now_time = datetime.datetime.now()
-                        day_string = now_time.strftime("%y.%m.%d-%A")
-                        time_string = now_time.strftime("%H:%M:%S")
-                        log_name = "sim_log.{0}".format(options.launch_name)
-                        logfile = open(
-                            this_directory
-                            + "logfiles/"
-                            + log_name
-                            + "."
-                            + day_string
-                            + ".txt",
-                            "a",
-                        )
-                        print(
-                            "%s %6s %-22s %-100s %-25s %s"
-                            % (
-                                time_string,
-                                torque_out,
-                                benchmark,
-                                self.benchmark_args_subdirs[args],
-                                self.run_subdir,
-                                build_handle,
-                            ),
-                            file=logfile,
-                        )
-                        logfile.close()
+                        log_job(job, job_id)
+                        continue
+                jobs.append(job)
             self.benchmark_args_subdirs.clear()
 
     #########################################################################################
     # Internal utility methods
     #########################################################################################
+    # the files next to the config that the simulator reads from the run directory
+    def get_config_files(self):
+        return (
+            glob.glob(os.path.dirname(self.config_file) + "/*.icnt")
+            + glob.glob(os.path.dirname(self.config_file) + "/*.csv")
+            + glob.glob(os.path.dirname(self.config_file) + "/*.xml")
+        )
+
+    # Launched runs are stored in the cache when they complete, by procman or
+    # job_status.py. A run that neither of them saw finish is stored when its
+    # run directory is visited again.
+    def store_last_run(self, this_run_dir):
+        if common.store_finished_run(this_run_dir, result_cache=result_cache):
+            print(
+                "Stored the last run of {0} in the result cache".format(this_run_dir)
+            )
+
+    # Copies the cached output to the run directory, named as if it came
+    # from a job with the id returned. None if the key is not cached.
+    def fetch_cached_run(self, cache_key, this_run_dir, sim_name):
+        job_id = common.RESULT_CACHE_JOB_ID
+        output_base = os.path.join(this_run_dir, sim_name)
+        if not result_cache.fetch(
+            cache_key, output_base + ".o" + job_id, output_base + ".e" + job_id
+        ):
+            return None
+        record_file = os.path.join(this_run_dir, "result_cache.json")
+        if os.path.isfile(record_file):
+            os.remove(record_file)
+        return job_id
+
     # copies and links the necessary files to the run directory
     def setup_run_directory(
         self, full_data_dir, this_run_dir, data_dir, appargs_subdir
@@ -224,9 +233,7 @@ class ConfigurationSpec:
             glob.glob(os.path.join(full_data_dir, "*.ptx"))
             + glob.glob(os.path.join(full_data_dir, "*.cl"))
             + glob.glob(os.path.join(full_data_dir, "*.h"))
-            + glob.glob(os.path.dirname(self.config_file) + "/*.icnt")
-            + glob.glob(os.path.dirname(self.config_file) + "/*.csv")
-            + glob.glob(os.path.dirname(self.config_file) + "/*.xml")
+            + self.get_config_files()
         )
 
         for file_to_cp in files_to_copy_to_run_dir:
@@ -380,6 +387,7 @@ class ConfigurationSpec:
         justrunfile = os.path.join(this_run_dir, "justrun.sh")
         open(justrunfile, "w").write(exec_name + " " + txt_args + "\n")
         os.chmod(justrunfile, 0o744)
+        return sim_name
 
     # replaces all the "REPLACE_*" strings in the gpgpusim.config file
     def append_gpgpusim_config(
@@ -418,6 +426,103 @@ class ConfigurationSpec:
             config_text += open(accelsim_cfg).read()
 
         open(os.path.join(this_run_dir, "gpgpusim.config"), "w").write(config_text)
+        return config_text
+
+
+def record_cached_run(job, job_id):
+    record = {
+        "key": job["cache_key"],
+        "cache_dir": result_cache.cache_dir,
+        "sim_name": job["sim_name"],
+        "job_id": job_id,
+        "info": {
+            "build": job["build_handle"],
+            "benchmark": job["benchmark"],
+            "args": job["args"],
+            "config": job["config"],
+            "user": getpass.getuser(),
+            "launched": datetime.datetime.now().isoformat(),
+        },
+    }
+    with open(os.path.join(job["run_dir"], "result_cache.json"), "w") as f:
+        json.dump(record, f)
+
+
+# Submit the job to torque and dump the output to a file
+def submit_job(job):
+    torque_out_filename = this_directory + "torque_out.{0}.txt".format(os.getpid())
+    torque_out_file = open(torque_out_filename, "w+")
+    saved_dir = os.getcwd()
+    os.chdir(job["run_dir"])
+    if (
+        subprocess.call(
+            [job_submit_call, os.path.join(job["run_dir"], job_template)],
+            stdout=torque_out_file,
+        )
+        < 0
+    ):
+        exit("Error Launching Job")
+    else:
+        # Parse the torque output for just the numeric ID
+        torque_out_file.seek(0)
+        torque_out = re.sub(r"[^\d]*(\d*).*", r"\1", torque_out_file.read().strip())
+        print(
+            "Job "
+            + torque_out
+            + " queued ("
+            + job["benchmark"]
+            + "-"
+            + job["args"]
+            + " "
+            + job["config"]
+            + ")"
+        )
+    torque_out_file.close()
+    os.remove(torque_out_filename)
+    os.chdir(saved_dir)
+
+    if job["cache_key"] != None and len(torque_out) > 0:
+        record_cached_run(job, torque_out)
+    return torque_out
+
+
+# Dump the benchmark description to the logfile
+def log_job(job, job_id):
+    if len(job_id) == 0:
+        return
+    now_time = datetime.datetime.now()
+    day_string = now_time.strftime("%y.%m.%d-%A")
+    time_string = now_time.strftime("%H:%M:%S")
+    log_name = "sim_log.{0}".format(options.launch_name)
+    logfile = open(
+        this_directory + "logfiles/" + log_name + "." + day_string + ".txt", "a"
+    )
+    print(
+        "%s %6s %-22s %-100s %-25s %s"
+        % (
+            time_string,
+            job_id,
+            job["benchmark"],
+            job["args"],
+            job["config"],
+            job["build_handle"],
+        ),
+        file=logfile,
+    )
+    logfile.close()
+
+
+# Simulates handing the jobs, in order, to the first of slots free slots
+def estimate_makespan(predicted_times, slots):
+    slot_free = [0.0] * slots
+    for predicted in predicted_times:
+        start = heapq.heappop(slot_free)
+        heapq.heappush(slot_free, start + predicted)
+    return max(slot_free)
+
+
+def format_duration(seconds):
+    return str(datetime.timedelta(seconds=int(seconds)))
 
 
 # -----------------------------------------------------------
@@ -481,6 +586,29 @@ options.simulator_dir = running_sim_dir
 
 common.load_defined_yamls()
 
+if not os.path.exists(this_directory + "logfiles/"):
+    # In the very rare case that concurrent builds try to make the directory at the same time
+    # (after the test to os.path.exists -- this has actually happened...)
+    try:
+        os.makedirs(this_directory + "logfiles/")
+    except:
+        pass
+runtime_history = common.RuntimeHistory(
+    os.path.join(this_directory, "logfiles", "runtime_history.db")
+)
+
+result_cache = None
+if options.result_cache != "":
+    if options.trace_dir == "":
+        print("The result cache is only used in trace-driven mode, ignoring it.")
+    elif common.ResultCache.build_id(version_string) == None:
+        print(
+            "The simulator was built with uncommitted changes, "
+            + "not using the result cache."
+        )
+    else:
+        result_cache = common.ResultCache(options.result_cache)
+
 # Test for the existance of a cluster management system
 job_submit_call = None
 job_template = None
@@ -541,6 +669,7 @@ print(
     + options.benchmark_list
 )
 
+jobs = []
 for config in configurations:
     config.my_print()
     config.run(
@@ -549,7 +678,55 @@ for config in configurations:
         options.run_directory,
         cuda_version,
         options.simulator_dir,
+        jobs,
+    )
+
+# Launch the longest jobs first, so that none of them starts at the end and
+# holds up the whole sweep. Jobs without a prediction are assumed average.
+for job in jobs:
+    job["predicted"] = runtime_history.predict(
+        job["run_dir"], job["benchmark"], job["args"], job["config"]
+    )
+known = [job["predicted"] for job in jobs if job["predicted"] != None]
+for job in jobs:
+    if job["predicted"] == None:
+        job["predicted"] = sum(known) / len(known) if len(known) > 0 else 0
+jobs.sort(key=lambda job: job["predicted"], reverse=True)
+runtime_history.close()
+
+if len(known) == 0:
+    print("No runtime history for these jobs yet, launching them in order.")
+elif len(jobs) > 0:
+    print(
+        "Predicted run time for {0} of the {1} jobs: ".format(len(known), len(jobs))
+        + "{0} in total, {1} for the longest.".format(
+            format_duration(sum([job["predicted"] for job in jobs])),
+            format_duration(jobs[0]["predicted"]),
+        )
     )
+    slots = None
+    if options.cores != None:
+        slots = int(options.cores)
+    elif "procman" in job_submit_call:
+        slots = os.cpu_count()
+    if slots != None:
+        print(
+            "Expected makespan on {0} cores: {1}".format(
+                slots,
+                format_duration(
+                    estimate_makespan([job["predicted"] for job in jobs], slots)
+                ),
+            )
+        )
+    else:
+        print(
+            "Expected makespan with enough free nodes: {0}, pass -c to estimate it "
+            "for a number of cores.".format(format_duration(jobs[0]["predicted"]))
+        )
+
+if not options.no_launch:
+    for job in jobs:
+        log_job(job, submit_job(job))
 
 if "procman" in job_submit_call and not options.no_launch:
     if options.cores == None:
@@ -0,0 +1,729 @@
+// Native backend of get_stats.py.
+//
+// Scans simulator output files for the stats listed in a stats yml and prints
+// what get_stats.py would have put in its stat map for each file, see
+// print_usage(). The files are mapped in memory and scanned by one thread
+// each. Instead of trying every regex on every line, an Aho-Corasick automaton
+// built from the literal text each regex requires finds the candidate lines in
+// a single pass, and the regexes only run on those.
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// the same windows as get_stats.py
+const size_t BYTES_TO_READ = 250 * 1024 * 1024;
+const unsigned BUILD_LINES = 100;
+const unsigned EXIT_LINES = 10000;
+
+const char SIM_EXIT_STRING[] = "GPGPU-Sim: *** exit detected ***";
+const char MAX_BREAK_STRING[] = "GPGPU-Sim: ** break due to reaching the "
+                                "maximum cycles (or instructions) **";
+
+enum stat_type { STAT_AGG, STAT_ABS, STAT_RATE };
+
+struct stat_pattern {
+  string text;
+  stat_type type;
+  regex re;
+  // literal text every match contains, empty when there is none
+  string literal;
+};
+
+struct options_t {
+  bool per_kernel = false;
+  bool kernel_instance = false;
+  bool ignore_failures = false;
+};
+
+/// @brief Longest piece of literal text that any match of a regex has to
+/// contain. Groups, classes and optional atoms end a piece, alternation or
+/// inline flags at the top level leave nothing to require.
+string required_literal(const string &pattern) {
+  if (pattern.find("(?") != string::npos)
+    return "";
+  string best, run;
+  auto end_run = [&]() {
+    if (run.size() > best.size())
+      best = run;
+    run.clear();
+  };
+
+  size_t i = 0;
+  while (i < pattern.size()) {
+    char c = pattern[i];
+    bool literal = false;
+    char ch = 0;
+    if (c == '\\') {
+      if (i + 1 == pattern.size())
+        return "";
+      // \s, \d, \b, back-references... are not literal text
+      literal = !isalnum((unsigned char)pattern[i + 1]);
+      ch = pattern[i + 1];
+      i += 2;
+    } else if (c == '[') {
+      size_t j = i + 1;
+      if (j < pattern.size() && pattern[j] == '^')
+        j++;
+      if (j < pattern.size() && pattern[j] == ']')
+        j++;
+      while (j < pattern.size() && pattern[j] != ']')
+        j += pattern[j] == '\\' ? 2 : 1;
+      if (j >= pattern.size())
+        return "";
+      i = j + 1;
+    } else if (c == '(') {
+      int depth = 0;
+      size_t j = i;
+      for (; j < pattern.size(); ++j) {
+        if (pattern[j] == '\\')
+          j++;
+        else if (pattern[j] == '(')
+          depth++;
+        else if (pattern[j] == ')' && --depth == 0)
+          break;
+      }
+      if (j >= pattern.size())
+        return "";
+      i = j + 1;
+    } else if (c == '|' || c == ')' || c == '*' || c == '+' || c == '?' ||
+               c == '{') {
+      return "";
+    } else {
+      literal = c != '.' && c != '^' && c != '$';
+      ch = c;
+      i++;
+    }
+
+    // a quantifier applies to the atom just read
+    bool optional = false, repeated = false;
+    if (i < pattern.size()) {
+      char q = pattern[i];
+      if (q == '*' || q == '?') {
+        optional = true;
+        i++;
+      } else if (q == '+') {
+        repeated = true;
+        i++;
+      } else if (q == '{') {
+        size_t close = pattern.find('}', i);
+        if (close == string::npos)
+          return "";
+        optional = atoi(pattern.c_str() + i + 1) == 0;
+        repeated = true;
+        i = close + 1;
+      }
+      if ((optional || repeated) && i < pattern.size() &&
+          (pattern[i] == '?' || pattern[i] == '+'))
+        i++;
+    }
+
+    if (!literal || optional) {
+      end_run();
+      continue;
+    }
+    run += ch;
+    if (repeated)
+      end_run();
+  }
+  end_run();
+  return best;
+}
+
+/// @brief Multi-pattern matcher, the automaton is fully resolved into a
+/// transition table so that each byte of input costs one lookup.
+class aho_corasick {
+public:
+  void add(const string &literal, unsigned id) {
+    if (m_next.empty())
+      new_state();
+    unsigned state = 0;
+    for (unsigned char c : literal) {
+      if (m_next[state * 256 + c] == 0) {
+        // new_state() grows the table, index it again afterwards
+        unsigned next = new_state();
+        m_next[state * 256 + c] = next;
+      }
+      state = m_next[state * 256 + c];
+    }
+    m_outputs[state].push_back(id);
+  }
+
+  void build() {
+    if (m_next.empty())
+      new_state();
+    vector<unsigned> fail(m_outputs.size(), 0);
+    vector<unsigned> queue;
+    for (unsigned c = 0; c < 256; ++c)
+      if (m_next[c])
+        queue.push_back(m_next[c]);
+    for (size_t head = 0; head < queue.size(); ++head) {
+      unsigned state = queue[head];
+      const vector<unsigned> &inherited = m_outputs[fail[state]];
+      m_outputs[state].insert(m_outputs[state].end(), inherited.begin(),
+                              inherited.end());
+      for (unsigned c = 0; c < 256; ++c) {
+        unsigned &next = m_next[state * 256 + c];
+        if (next) {
+          fail[next] = m_next[fail[state] * 256 + c];
+          queue.push_back(next);
+        } else {
+          next = m_next[fail[state] * 256 + c];
+        }
+      }
+    }
+  }
+
+  unsigned step(unsigned state, unsigned char c) const {
+    return m_next[state * 256 + c];
+  }
+  const vector<unsigned> &outputs(unsigned state) const {
+    return m_outputs[state];
+  }
+
+private:
+  unsigned new_state() {
+    m_next.resize(m_next.size() + 256, 0);
+    m_outputs.emplace_back();
+    return m_outputs.size() - 1;
+  }
+
+  vector<unsigned> m_next;
+  vector<vector<unsigned>> m_outputs;
+};
+
+struct mapped_file {
+  const char *data = NULL;
+  size_t size = 0;
+  bool ok = false;
+
+  explicit mapped_file(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+      size = st.st_size;
+      ok = true;
+      if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+          ok = false;
+        } else {
+          madvise(map, size, MADV_SEQUENTIAL);
+          data = (const char *)map;
+        }
+      }
+    }
+    close(fd);
+  }
+  ~mapped_file() {
+    if (data)
+      munmap((void *)data, size);
+  }
+};
+
+struct line_t {
+  const char *begin;
+  // one past the end, including the '\n' if there is one
+  const char *end;
+
+  bool starts_with(const char *prefix, size_t length) const {
+    return (size_t)(end - begin) >= length &&
+           memcmp(begin, prefix, length) == 0;
+  }
+  // the line with trailing whitespace stripped, as line.rstrip()
+  line_t rstrip() const {
+    const char *e = end;
+    while (e > begin && isspace((unsigned char)e[-1]))
+      e--;
+    return {begin, e};
+  }
+};
+
+string strip(const string &s) {
+  size_t b = s.find_first_not_of(" \t\n\r\f\v");
+  if (b == string::npos)
+    return "";
+  size_t e = s.find_last_not_of(" \t\n\r\f\v");
+  return s.substr(b, e - b + 1);
+}
+
+string format_double(double value) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.17g", value);
+  return buffer;
+}
+
+class stats_extractor {
+public:
+  stats_extractor(vector<stat_pattern> &patterns, const options_t &options)
+      : m_patterns(patterns), m_options(options),
+        m_kernel_re("kernel_name\\s+=\\s+(.*)"),
+        m_gpgpu_build_re(".*GPGPU-Sim.*\\[build\\s+(.*)\\].*"),
+        m_accelsim_build_re("Accel-Sim.*\\[build\\s+(.*)\\].*") {
+    for (unsigned i = 0; i < m_patterns.size(); ++i) {
+      if (m_patterns[i].literal.empty())
+        m_always.push_back(i);
+      else
+        m_matcher.add(m_patterns[i].literal, i);
+    }
+    m_kernel_id = m_patterns.size();
+    m_matcher.add("kernel_name", m_kernel_id);
+    m_matcher.build();
+  }
+
+  // Returns the records of one file, see print_usage()
+  string extract(const string &path) const;
+
+private:
+  // the stats whose literal appears in the line, in the order of the yml
+  void candidates(line_t line, vector<unsigned> &found,
+                  vector<char> &seen) const;
+  bool search(unsigned stat, line_t line, string &number) const;
+
+  void find_builds(const mapped_file &file, string &out) const;
+  bool find_exit(const mapped_file &file, size_t window_start) const;
+  void final_kernel(const mapped_file &file, size_t window_start,
+                    string &out) const;
+  void per_kernel(const mapped_file &file, string &out) const;
+
+  const vector<stat_pattern> &m_patterns;
+  const options_t &m_options;
+  aho_corasick m_matcher;
+  vector<unsigned> m_always;
+  unsigned m_kernel_id;
+  regex m_kernel_re;
+  regex m_gpgpu_build_re;
+  regex m_accelsim_build_re;
+};
+
+void stats_extractor::candidates(line_t line, vector<unsigned> &found,
+                                 vector<char> &seen) const {
+  found.clear();
+  unsigned state = 0;
+  for (const char *c = line.begin; c < line.end; ++c) {
+    state = m_matcher.step(state, *c);
+    for (unsigned id : m_matcher.outputs(state))
+      if (!seen[id]) {
+        seen[id] = 1;
+        found.push_back(id);
+      }
+  }
+  for (unsigned id : found)
+    seen[id] = 0;
+  found.insert(found.end(), m_always.begin(), m_always.end());
+  sort(found.begin(), found.end());
+}
+
+bool stats_extractor::search(unsigned stat, line_t line,
+                             string &number) const {
+  cmatch match;
+  if (!regex_search(line.begin, line.end, match, m_patterns[stat].re))
+    return false;
+  number = strip(match.size() > 1 ? match[1].str() : "");
+  return true;
+}
+
+void stats_extractor::find_builds(const mapped_file &file, string &out) const {
+  const char *p = file.data, *end = file.data + file.size;
+  for (unsigned count = 1; p < end && count < BUILD_LINES; ++count) {
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    const char *line_end = nl ? nl + 1 : end;
+    cmatch match;
+    if (regex_search(p, line_end, match, m_gpgpu_build_re,
+                     regex_constants::match_continuous)) {
+      out += "B\tGPGPU-Sim-build\t" + match[1].str() + "\n";
+      break;
+    }
+    if (regex_search(p, line_end, match, m_accelsim_build_re,
+                     regex_constants::match_continuous))
+      out += "B\tAccel-Sim-build\t" + match[1].str() + "\n";
+    p = line_end;
+  }
+}
+
+// Calls visit on the lines of [begin, end) from the last one up, until it
+// returns false
+template <typename visitor>
+void reverse_lines(const char *begin, const char *end, visitor visit) {
+  const char *hi = end;
+  while (hi > begin) {
+    const char *nl = (const char *)memrchr(begin, '\n', hi - 1 - begin);
+    const char *lo = nl ? nl + 1 : begin;
+    if (!visit(line_t{lo, hi}))
+      return;
+    hi = lo;
+  }
+}
+
+bool stats_extractor::find_exit(const mapped_file &file,
+                                size_t window_start) const {
+  bool found = false;
+  unsigned count = 0;
+  reverse_lines(file.data + window_start, file.data + file.size,
+                [&](line_t line) {
+                  if (++count >= EXIT_LINES)
+                    return false;
+                  found = line.starts_with(SIM_EXIT_STRING,
+                                           sizeof(SIM_EXIT_STRING) - 1);
+                  return !found;
+                });
+  return found;
+}
+
+// The last value of each stat in the window, as strings
+void stats_extractor::final_kernel(const mapped_file &file,
+                                   size_t window_start, string &out) const {
+  vector<char> found(m_patterns.size(), 0);
+  vector<string> values(m_patterns.size());
+  size_t remaining = m_patterns.size();
+  vector<unsigned> stats;
+  vector<char> seen(m_patterns.size() + 1, 0);
+  string number;
+  reverse_lines(file.data + window_start, file.data + file.size,
+                [&](line_t line) {
+                  line_t stripped = line.rstrip();
+                  candidates(stripped, stats, seen);
+                  for (unsigned stat : stats) {
+                    if (stat == m_kernel_id || found[stat] ||
+                        !search(stat, stripped, number))
+                      continue;
+                    found[stat] = 1;
+                    values[stat] = number;
+                    remaining--;
+                  }
+                  return remaining > 0;
+                });
+
+  out += "N\tfinal_kernel\n";
+  for (unsigned stat = 0; stat < m_patterns.size(); ++stat)
+    if (found[stat])
+      out += "S\tfinal_kernel\t" + m_patterns[stat].text + "\ts\t" +
+             values[stat] + "\n";
+}
+
+// Mirrors the kernel-by-kernel loop of get_stats.py, including the order in
+// which it looks up and updates its stat map
+void stats_extractor::per_kernel(const mapped_file &file, string &out) const {
+  struct value_t {
+    bool present = false;
+    bool is_number = false;
+    double number = 0;
+    string text;
+  };
+  struct kernel_t {
+    vector<value_t> stats;
+    unsigned long long count = 0;
+    bool counted = false;
+  };
+  unordered_map<string, kernel_t> kernels;
+  vector<string> kernel_order;
+  auto kernel_stats = [&](const string &name) -> kernel_t & {
+    kernel_t &kernel = kernels[name];
+    if (kernel.stats.empty())
+      kernel.stats.resize(m_patterns.size());
+    return kernel;
+  };
+  auto has = [&](const string &name, unsigned stat) {
+    auto it = kernels.find(name);
+    return it != kernels.end() && !it->second.stats.empty() &&
+           it->second.stats[stat].present;
+  };
+
+  string current_kernel, last_kernel;
+  vector<char> has_raw_last(m_patterns.size(), 0);
+  vector<double> raw_last(m_patterns.size(), 0);
+  unordered_map<string, unsigned long long> running_kcount;
+  vector<unsigned> stats;
+  vector<char> seen(m_patterns.size() + 1, 0);
+  string number;
+
+  const char *p = file.data, *end = file.data + file.size;
+  while (p < end) {
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    line_t line{p, nl ? nl + 1 : end};
+    p = line.end;
+
+    if (line.starts_with(MAX_BREAK_STRING, sizeof(MAX_BREAK_STRING) - 1)) {
+      out += "M\n";
+      auto it = kernels.find(current_kernel);
+      if (it != kernels.end())
+        for (value_t &value : it->second.stats)
+          value.present = false;
+    }
+
+    line_t stripped = line.rstrip();
+    candidates(stripped, stats, seen);
+    if (stats.empty())
+      continue;
+
+    if (stats.back() == m_kernel_id) {
+      cmatch match;
+      if (regex_search(line.begin, line.end, match, m_kernel_re,
+                       regex_constants::match_continuous)) {
+        last_kernel = current_kernel;
+        current_kernel = strip(match[1].str());
+        if (m_options.kernel_instance) {
+          auto count = running_kcount.find(current_kernel);
+          if (count == running_kcount.end())
+            count = running_kcount.emplace(current_kernel, 0).first;
+          else
+            count->second++;
+          current_kernel += "--" + to_string(count->second);
+        }
+        kernel_t &kernel = kernel_stats(current_kernel);
+        if (!kernel.counted) {
+          kernel.counted = true;
+          kernel_order.push_back(current_kernel);
+        }
+        kernel.count++;
+        continue;
+      }
+    }
+
+    for (unsigned stat : stats) {
+      if (stat == m_kernel_id || !search(stat, stripped, number))
+        continue;
+      if (m_patterns[stat].type != STAT_AGG) {
+        value_t &value = kernel_stats(current_kernel).stats[stat];
+        value.present = true;
+        value.is_number = false;
+        value.text = number;
+        continue;
+      }
+
+      char *number_end;
+      double parsed = strtod(number.c_str(), &number_end);
+      if (number.empty() || *number_end) {
+        out += "E\tcould not convert string to float: '" + number + "' (" +
+               m_patterns[stat].text + ")\n";
+        return;
+      }
+      double stat_last_kernel = 0.0;
+      bool accumulate = has(current_kernel, stat);
+      if (accumulate) {
+        if (has_raw_last[stat])
+          stat_last_kernel = raw_last[stat];
+      } else if (has(last_kernel, stat)) {
+        stat_last_kernel = raw_last[stat];
+      }
+      has_raw_last[stat] = 1;
+      raw_last[stat] = parsed;
+
+      value_t &value = kernel_stats(current_kernel).stats[stat];
+      if (accumulate && value.is_number) {
+        value.number += (parsed - stat_last_kernel);
+      } else {
+        value.number = parsed - stat_last_kernel;
+      }
+      value.present = true;
+      value.is_number = true;
+    }
+  }
+
+  for (const string &name : kernel_order)
+    out += "N\t" + name + "\n";
+  for (auto &kernel : kernels) {
+    if (kernel.second.counted)
+      out += "S\t" + kernel.first + "\tk-count\ti\t" +
+             to_string(kernel.second.count) + "\n";
+    for (unsigned stat = 0; stat < kernel.second.stats.size(); ++stat) {
+      const value_t &value = kernel.second.stats[stat];
+      if (!value.present)
+        continue;
+      out += "S\t" + kernel.first + "\t" + m_patterns[stat].text +
+             (value.is_number ? "\tf\t" + format_double(value.number)
+                              : "\ts\t" + value.text) +
+             "\n";
+    }
+  }
+}
+
+string stats_extractor::extract(const string &path) const {
+  string out;
+  mapped_file file(path);
+  if (!file.ok) {
+    out += "E\tcannot open " + path + "\n";
+    return out;
+  }
+
+  find_builds(file, out);
+  size_t window_start = file.size > BYTES_TO_READ ? file.size - BYTES_TO_READ
+                                                  : 0;
+  bool exit_found = find_exit(file, window_start);
+  out += exit_found ? "X\t1\n" : "X\t0\n";
+  if (!exit_found && !m_options.ignore_failures)
+    return out;
+
+  if (m_options.per_kernel) {
+    out += "P\t" + to_string(file.size) + "\n";
+    per_kernel(file, out);
+  } else {
+    out += "P\t" + to_string(file.size - window_start) + "\n";
+    final_kernel(file, window_start, out);
+  }
+  return out;
+}
+
+void print_usage(const char *prog) {
+  cerr << "Usage: " << prog
+       << " -p <patterns> [-k] [-K] [-I] [-j jobs] < <output file list>\n"
+       << "  -p, --patterns         the stats to collect, one "
+          "\"agg|abs|rate<TAB>regex\" per line\n"
+       << "  -k, --per_kernel       aggregate the stats per named kernel\n"
+       << "  -K, --kernel_instance  with -k, keep each kernel launch apart\n"
+       << "  -I, --ignore_failures  also parse outputs without the exit "
+          "string\n"
+       << "  -j, --jobs             files scanned in parallel (default: one "
+          "per core)\n"
+       << "\n"
+       << "The output files are read from stdin, one per line. For each of "
+          "them, in order,\n"
+       << "a block of tab separated records is printed to stdout:\n"
+       << "  F <index>                       start of the block of the "
+          "index-th file\n"
+       << "  B <name> <build>                Accel-Sim-build or "
+          "GPGPU-Sim-build\n"
+       << "  X <0|1>                         whether the exit string was "
+          "found\n"
+       << "  P <bytes>                       the stats were parsed from "
+          "that many bytes\n"
+       << "  M                               a maximum cycle/insn break, the "
+          "current\n"
+       << "                                  kernel's stats are dropped\n"
+       << "  N <kernel>                      a kernel name, in order of first "
+          "appearance\n"
+       << "  S <kernel> <regex> <f|i|s> <value>\n"
+       << "                                  a float, integer or string stat "
+          "value\n"
+       << "  E <message>                     the file could not be parsed\n";
+}
+
+int main(int argc, char **argv) {
+  options_t options;
+  string patterns_path;
+  unsigned jobs = 0;
+
+  static struct option long_options[] = {
+      {"patterns", required_argument, NULL, 'p'},
+      {"per_kernel", no_argument, NULL, 'k'},
+      {"kernel_instance", no_argument, NULL, 'K'},
+      {"ignore_failures", no_argument, NULL, 'I'},
+      {"jobs", required_argument, NULL, 'j'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:kKIj:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'p':
+      patterns_path = optarg;
+      break;
+    case 'k':
+      options.per_kernel = true;
+      break;
+    case 'K':
+      options.kernel_instance = true;
+      break;
+    case 'I':
+      options.ignore_failures = true;
+      break;
+    case 'j':
+      jobs = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (patterns_path.empty()) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  FILE *patterns_file = fopen(patterns_path.c_str(), "r");
+  if (patterns_file == NULL) {
+    cerr << "Unable to open file: " << patterns_path << endl;
+    return 1;
+  }
+  vector<stat_pattern> patterns;
+  char *buffer = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+  while ((length = getline(&buffer, &capacity, patterns_file)) > 0) {
+    string line(buffer, length);
+    if (line.back() == '\n')
+      line.pop_back();
+    if (line.empty())
+      continue;
+    size_t tab = line.find('\t');
+    string type = line.substr(0, tab);
+    stat_pattern pattern;
+    pattern.text = tab == string::npos ? "" : line.substr(tab + 1);
+    if (type == "agg")
+      pattern.type = STAT_AGG;
+    else if (type == "abs")
+      pattern.type = STAT_ABS;
+    else if (type == "rate")
+      pattern.type = STAT_RATE;
+    else {
+      cerr << "Unknown stat type in " << patterns_path << ": " << line << endl;
+      return 1;
+    }
+    try {
+      pattern.re = regex(pattern.text);
+    } catch (const regex_error &e) {
+      cerr << "Unsupported regex " << pattern.text << ": " << e.what() << endl;
+      return 1;
+    }
+    pattern.literal = required_literal(pattern.text);
+    patterns.push_back(pattern);
+  }
+  free(buffer);
+  fclose(patterns_file);
+
+  vector<string> files;
+  string path;
+  while (getline(cin, path))
+    if (!path.empty())
+      files.push_back(path);
+
+  stats_extractor extractor(patterns, options);
+  vector<string> results(files.size());
+  atomic<size_t> next(0);
+  if (jobs == 0)
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  jobs = max(1u, min(jobs, (unsigned)files.size()));
+  vector<thread> workers;
+  for (unsigned j = 0; j < jobs; ++j)
+    workers.emplace_back([&]() {
+      for (size_t i = next++; i < files.size(); i = next++)
+        results[i] = extractor.extract(files[i]);
+    });
+  for (thread &worker : workers)
+    worker.join();
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    cout << "F\t" << i << "\n" << results[i];
+  }
+  cout.flush();
+  return 0;
+}
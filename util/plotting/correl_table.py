@@ -0,0 +1,382 @@
+# Columnar stats for plot-correlation.py and merge-stats.py
+#
+# The simulator stats of a get_stats.py csv are kept as one numpy array per
+# config and stat, with a row per kernel. The hardware stats are kept as one
+# array per device and metric, with a row per kernel and a column per
+# profiled run. The correl_mappings.py expressions are then evaluated once
+# over whole columns, rather than once per kernel.
+#
+# Parsed files are cached under their name, size and modification time, so
+# that when a few new runs arrive only the new or rewritten files are parsed
+# again.
+
+import csv
+import glob
+import hashlib
+import os
+import pickle
+import sys
+import warnings
+
+import numpy as np
+
+NAN = float("nan")
+
+
+# Converts csv fields to floats, NaN for the ones that are not numbers
+def to_floats(values):
+    try:
+        return np.array(values, dtype=float)
+    except ValueError:
+        floats = np.empty(len(values))
+        for i, value in enumerate(values):
+            try:
+                floats[i] = float(value)
+            except ValueError:
+                floats[i] = NAN
+        return floats
+
+
+# Yields each stat of a get_stats.py csv as (stat, header row, data rows)
+def read_stat_blocks(filepath):
+    with open(filepath, "r") as data_file:
+        reader = csv.reader(data_file)
+        state = "start"
+        for row in reader:
+            if len(row) != 0 and row[0].startswith("----"):
+                state = "find-stat"
+                continue
+            if state == "find-stat":
+                stat = row[0]
+                state = "find-header"
+                continue
+            if state == "find-header":
+                header = row
+                rows = []
+                state = "process-rows"
+                continue
+            if state == "process-rows":
+                if len(row) == 0:
+                    yield stat, header, rows
+                    state = "start"
+                else:
+                    rows.append(row)
+        if state == "process-rows":
+            yield stat, header, rows
+
+
+# Calls parse(path) unless the result for this version of path is cached in
+# cache_dir. Cached results of files that changed are replaced.
+def cached_parse(path, parse, cache_dir, tag):
+    st = os.stat(path)
+    signature = (os.path.abspath(path), st.st_size, st.st_mtime_ns, tag)
+    cache_file = os.path.join(
+        cache_dir, hashlib.md5(repr(signature[::3]).encode()).hexdigest() + ".pickle"
+    )
+    if os.path.isfile(cache_file):
+        try:
+            with open(cache_file, "rb") as f:
+                cached_signature, result = pickle.load(f)
+            if cached_signature == signature:
+                return result
+        except Exception:
+            pass
+    result = parse(path)
+    write_pickle(cache_file, (signature, result))
+    return result
+
+
+def write_pickle(path, obj):
+    if not os.path.isdir(os.path.dirname(path)):
+        os.makedirs(os.path.dirname(path))
+    tmp_path = "{0}.tmp.{1}".format(path, os.getpid())
+    with open(tmp_path, "wb") as f:
+        pickle.dump(obj, f, pickle.HIGHEST_PROTOCOL)
+    os.rename(tmp_path, path)
+
+
+# The per-kernel simulator stats of a get_stats.py -R -K -k csv
+class SimTable:
+    def __init__(self):
+        # (appargs, kernel name, number of the kernel in the app), one per row
+        self.kernels = []
+        # appargs -> the rows of its kernels, in launch order
+        self.app_rows = {}
+        # config -> stat -> array with a value per row, NaN if missing
+        self.columns = {}
+
+    @classmethod
+    def from_csv(cls, filepath, logger=None):
+        table = cls()
+        missing = {}
+        for stat, header, rows in read_stat_blocks(filepath):
+            if logger != None:
+                logger.log("Processing Stat {0}".format(stat))
+            if len(table.kernels) == 0:
+                table.set_kernels(header[1:], logger)
+                # stats like the builds only have an all_kernels column
+                if len(table.kernels) == 0:
+                    continue
+            nkernels = len(table.kernels)
+            for row in rows:
+                cfg = row[0]
+                if logger != None:
+                    logger.log("Processing config: {0}".format(cfg))
+                values = row[1:]
+                if len(values) > nkernels:
+                    print(
+                        "More row entries than kernels processed. Likely because of an average column",
+                        file=sys.stderr,
+                    )
+                    values = values[:nkernels]
+                column = np.full(nkernels, NAN)
+                column[: len(values)] = to_floats(values)
+                if cfg not in table.columns:
+                    table.columns[cfg] = {}
+                table.columns[cfg][stat] = column
+                if stat not in missing:
+                    missing[stat] = np.zeros(nkernels, dtype=bool)
+                missing[stat][: len(values)] |= np.isnan(column[: len(values)])
+
+        # a stat missing for a kernel in any config is dropped for all of them
+        for cfg in table.columns:
+            for stat, column in table.columns[cfg].items():
+                column[missing[stat]] = NAN
+        return table
+
+    def set_kernels(self, names, logger):
+        last_appargs = ""
+        for item in names:
+            split = item.split("--")
+            if len(split) <= 1:
+                continue
+            appargs = split[0]
+            kname = split[1]
+            if len(split) > 2:
+                kname += "--" + split[2]
+            if kname == "all_kernels":
+                continue
+            if appargs == last_appargs:
+                num += 1
+            else:
+                last_appargs = appargs
+                num = 0
+            if logger != None:
+                logger.log("Found appargs {0}. Kernel {1}".format(appargs, kname))
+            if appargs not in self.app_rows:
+                self.app_rows[appargs] = []
+            self.app_rows[appargs].append(len(self.kernels))
+            self.kernels.append((appargs, kname, num))
+
+    # The stats of one kernel, as a dict like the per-kernel evaluation expects
+    def kernel_stats(self, cfg, row):
+        stats = {"Kernel": self.kernels[row][1]}
+        for stat, column in self.columns[cfg].items():
+            if not np.isnan(column[row]):
+                stats[stat] = column[row]
+        return stats
+
+
+# The hardware stats, per device: appargs -> list of per-kernel dicts mapping
+# each metric to the values of every profiled run, as plot-correlation.py
+# parses them. Metrics are turned into arrays on first use.
+class HwTable:
+    def __init__(self, hw_data):
+        self.hw_data = hw_data
+        self.app_offsets = {}
+        self.kdata = {}
+        self.metrics = {}
+        for device, appargslist in hw_data.items():
+            self.app_offsets[device] = {}
+            self.kdata[device] = []
+            for appargs, kdata in appargslist.items():
+                self.app_offsets[device][appargs] = len(self.kdata[device])
+                self.kdata[device] += kdata
+            self.metrics[device] = {}
+
+    # kernels x runs, NaN padded. Kernels with no value or values that are
+    # not numbers are all NaN.
+    def metric(self, device, name):
+        if name not in self.metrics[device]:
+            kdata = self.kdata[device]
+            runs = [kernel.get(name, []) for kernel in kdata]
+            found = any(name in kernel for kernel in kdata)
+            if not found:
+                self.metrics[device][name] = None
+            else:
+                width = max([len(values) for values in runs] + [1])
+                matrix = np.full((len(kdata), width), NAN)
+                for i, values in enumerate(runs):
+                    try:
+                        matrix[i, : len(values)] = values
+                    except (ValueError, TypeError):
+                        pass
+                self.metrics[device][name] = matrix
+        if self.metrics[device][name] is None:
+            raise KeyError(name)
+        return self.metrics[device][name]
+
+
+# What hw[...] returns when evaluating a whole column: the runs of each
+# kernel, which the expression has to reduce with np.average, np.max, ...
+class RunColumn:
+    def __init__(self, runs):
+        self.runs = runs
+
+
+class ColumnView:
+    def __init__(self, lookup):
+        self.lookup = lookup
+
+    def __getitem__(self, name):
+        return self.lookup(name)
+
+
+# Stands in for numpy in the expressions, reducing over the runs of each kernel
+class ColumnNumpy:
+    def __getattr__(self, name):
+        return getattr(np, name)
+
+    def reduce(self, function, column):
+        if not isinstance(column, RunColumn):
+            raise TypeError("not a hardware metric")
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore", category=RuntimeWarning)
+            return function(column.runs, axis=1)
+
+    def average(self, column):
+        return self.reduce(np.nanmean, column)
+
+    def mean(self, column):
+        return self.reduce(np.nanmean, column)
+
+    def max(self, column):
+        return self.reduce(np.nanmax, column)
+
+    def min(self, column):
+        return self.reduce(np.nanmin, column)
+
+    def sum(self, column):
+        return self.reduce(np.nansum, column)
+
+
+def column_float(value):
+    if isinstance(value, np.ndarray):
+        return value.astype(float)
+    return float(value)
+
+
+# Evaluates the correl_mappings.py expressions for a set of kernels: the rows
+# sim_rows of the config in sim_table, next to the rows hw_rows of the device
+# in hw_table. Each expression is tried over whole columns first. Those that
+# do more than reduce the hardware runs and combine the results, like
+# indexing into the runs, fall back to an evaluation per kernel.
+class CorrelEvaluator:
+    def __init__(self, sim_table, cfg, hw_table, device, sim_rows, hw_rows, globals):
+        self.sim_table = sim_table
+        self.cfg = cfg
+        self.hw_table = hw_table
+        self.device = device
+        self.sim_rows = np.array(sim_rows, dtype=int)
+        self.hw_rows = np.array(hw_rows, dtype=int)
+        self.globals = globals
+        self.namespace = {
+            "np": ColumnNumpy(),
+            "numpy": ColumnNumpy(),
+            "float": column_float,
+            "hw": ColumnView(self.hw_column),
+            "sim": ColumnView(self.sim_column),
+        }
+
+    def hw_column(self, name):
+        return RunColumn(self.hw_table.metric(self.device, name)[self.hw_rows])
+
+    def sim_column(self, name):
+        if name not in self.sim_table.columns[self.cfg]:
+            raise KeyError(name)
+        return self.sim_table.columns[self.cfg][name][self.sim_rows]
+
+    def as_column(self, value):
+        column = np.empty(len(self.sim_rows))
+        column[:] = value
+        return column
+
+    # Returns a list of arrays, one per comma separated expression, with NaN
+    # for the kernels it cannot be computed for
+    def evaluate(self, code, width=1):
+        try:
+            with np.errstate(all="ignore"):
+                values = eval(code, self.globals, self.namespace)
+            if width == 1:
+                values = (values,)
+            return [self.as_column(value) for value in values]
+        except KeyError:
+            # a stat or metric nobody collected
+            return [self.as_column(NAN) for i in range(width)]
+        except Exception:
+            return self.evaluate_per_kernel(code, width)
+
+    def evaluate_per_kernel(self, code, width):
+        columns = [self.as_column(NAN) for i in range(width)]
+        kdata = self.hw_table.kdata[self.device]
+        for i in range(len(self.sim_rows)):
+            local = {
+                "hw": kdata[self.hw_rows[i]],
+                "sim": self.sim_table.kernel_stats(self.cfg, self.sim_rows[i]),
+            }
+            try:
+                with np.errstate(all="ignore"):
+                    values = eval(code, self.globals, local)
+            except Exception:
+                continue
+            if width == 1:
+                values = (values,)
+            for j in range(width):
+                columns[j][i] = values[j]
+        return columns
+
+
+# Incremental parse of a hardware stats directory tree: each directory of
+# csvs is parsed by parse_dir(root, dir, csvs) into {device: {appargs: kdata}},
+# and only parsed again when its csvs change. An empty cache_dir parses all.
+def load_hw_dir(hardware_dir, parse_dir, cache_dir):
+    cached = {}
+    if cache_dir != "":
+        cache_file = os.path.join(
+            cache_dir,
+            "hw." + hashlib.md5(os.path.abspath(hardware_dir).encode()).hexdigest(),
+        )
+        if os.path.isfile(cache_file):
+            try:
+                with open(cache_file, "rb") as f:
+                    cached = pickle.load(f)
+            except Exception:
+                cached = {}
+
+    hw_data = {}
+    parsed = {}
+    changed = False
+    for root, dirs, files in os.walk(hardware_dir):
+        for d in dirs:
+            csvs = sorted(glob.glob(os.path.join(root, d, "*.csv*")))
+            if len(csvs) == 0:
+                continue
+            signature = []
+            for csvf in csvs:
+                st = os.stat(csvf)
+                signature.append((csvf, st.st_size, st.st_mtime_ns))
+            key = (root, d)
+            if key in cached and cached[key][0] == signature:
+                dir_data = cached[key][1]
+            else:
+                dir_data = parse_dir(root, d, csvs)
+                changed = True
+            parsed[key] = (signature, dir_data)
+            for device, appargslist in dir_data.items():
+                if device not in hw_data:
+                    hw_data[device] = {}
+                hw_data[device].update(appargslist)
+
+    if cache_dir != "" and (changed or parsed.keys() != cached.keys()):
+        write_pickle(cache_file, parsed)
+    return hw_data
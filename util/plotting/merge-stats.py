@@ -13,87 +13,54 @@ import sys
 
 sys.path.insert(0, os.path.join(this_directory, "..", "job_launching"))
 import common
-
-import numpy as np  # (*) numpy for math functions and arrays
-import csv
+import correl_table
 
 
 def get_csv_data_for_merge(filepath):
     all_named_kernels = {}
     stat_map = {}
-    apps = []
     cached_apps = []
-    configs = []
     cached_configs = []
     stats = []
     gpgpu_build_num = None
     gpgpu_build_nums = set()
     accel_build_num = None
     accel_build_nums = set()
-    data = {}
-    with open(filepath, "r") as data_file:
-        reader = csv.reader(data_file)  # define reader object
-        state = "start"
-        for row in reader:  # loop through rows in csv file
-            if len(row) != 0 and row[0].startswith("----"):
-                state = "find-stat"
-                continue
-            if state == "find-stat":
-                current_stat = row[0]
-                stats.append(current_stat)
-                state = "find-apps"
-                continue
-            if state == "find-apps":
-                apps = row[1:]
-                state = "process-cfgs"
-                continue
-            if state == "process-cfgs":
-                if len(row) == 0:
-                    if any_data:
-                        cached_apps = apps
-                        cached_configs = configs
-                        for config in configs:
-                            count = 0
-                            for appargs_kname in apps:
-                                first_delimiter = appargs_kname.find("--")
-                                appargs = appargs_kname[:first_delimiter]
-                                kname = appargs_kname[first_delimiter + 2 :]
-                                if (
-                                    current_stat == "GPGPU-Sim-build"
-                                    and data[config][count] != "NA"
-                                ):
-                                    gpgpu_build_num = data[config][count][21:28]
-                                    gpgpu_build_nums.add(gpgpu_build_num)
-                                if (
-                                    current_stat == "Accel-Sim-build"
-                                    and data[config][count] != "NA"
-                                ):
-                                    accel_build_num = data[config][count][16:23]
-                                    accel_build_nums.add(accel_build_num)
-                                stat_map[
-                                    kname + appargs + config + current_stat
-                                ] = data[config][count]
-                                count += 1
-                    apps = []
-                    configs = []
-                    data = {}
-                    state = "start"
-                    any_data = False
-                    continue
-                else:
-                    any_data = True
-                    if accel_build_num != None and gpgpu_build_num != None:
-                        full_config = (
-                            row[0]
-                            + "-accel-"
-                            + str(accel_build_num)
-                            + "-gpgpu-"
-                            + str(gpgpu_build_num)
-                        )
-                    else:
-                        full_config = row[0]
-                    configs.append(full_config)
-                    data[full_config] = row[1:]
+    for current_stat, header, rows in correl_table.read_stat_blocks(filepath):
+        stats.append(current_stat)
+        if len(rows) == 0:
+            continue
+        apps = header[1:]
+        configs = []
+        for row in rows:
+            if accel_build_num != None and gpgpu_build_num != None:
+                full_config = (
+                    row[0]
+                    + "-accel-"
+                    + str(accel_build_num)
+                    + "-gpgpu-"
+                    + str(gpgpu_build_num)
+                )
+            else:
+                full_config = row[0]
+            configs.append(full_config)
+        for config, row in zip(configs, rows):
+            data = row[1:]
+            count = 0
+            for appargs_kname in apps:
+                first_delimiter = appargs_kname.find("--")
+                appargs = appargs_kname[:first_delimiter]
+                kname = appargs_kname[first_delimiter + 2 :]
+                if current_stat == "GPGPU-Sim-build" and data[count] != "NA":
+                    gpgpu_build_num = data[count][21:28]
+                    gpgpu_build_nums.add(gpgpu_build_num)
+                if current_stat == "Accel-Sim-build" and data[count] != "NA":
+                    accel_build_num = data[count][16:23]
+                    accel_build_nums.add(accel_build_num)
+                stat_map[kname + appargs + config + current_stat] = data[count]
+                count += 1
+        cached_apps = apps
+        cached_configs = configs
 
     app_and_args = []
     for appargs_kname in cached_apps:
@@ -133,6 +100,14 @@ parser.add_option(
     help="When printing merged files, are configs as rows?",
     action="store_true",
 )
+parser.add_option(
+    "-k",
+    "--cache_dir",
+    dest="cache_dir",
+    default=os.path.join(this_directory, "correl_cache"),
+    help="Where the parsed csvs are cached, so that merging again after a few new"
+    + " csvs arrive only parses those. Empty to disable.",
+)
 (options, args) = parser.parse_args()
 
 csv_files = []
@@ -144,7 +119,12 @@ for csvf in options.csv_files.split(","):
 
 stats_per_file = {}
 for csvf in csv_files:
-    stats_per_file[csvf] = get_csv_data_for_merge(csvf)
+    if options.cache_dir != "":
+        stats_per_file[csvf] = correl_table.cached_parse(
+            csvf, get_csv_data_for_merge, options.cache_dir, "merge"
+        )
+    else:
+        stats_per_file[csvf] = get_csv_data_for_merge(csvf)
 
 new_stats = {}
 new_configs = []
@@ -161,7 +141,7 @@ for csvf in csv_files:
         gpgpu_build_nums,
     ) = stats_per_file[csvf]
     print("Processing {0}".format(csvf), file=sys.stderr)
-    new_stats = dict(new_stats, **stat_map)
+    new_stats.update(stat_map)
     for config in configs:
         if config not in union_configs:
             union_configs.add(config)
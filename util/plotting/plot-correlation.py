@@ -20,6 +20,7 @@ import sys
 
 sys.path.insert(0, os.path.join(this_directory, "..", "job_launching"))
 import common
+import correl_table
 
 import numpy as np  # (*) numpy for math functions and arrays
 import csv
@@ -34,78 +35,51 @@ import math
 
 
 def getAppData(kernels, x, y, xaxis_title, correlmap):
-    count = 0
-    appmax = 0
-    appmin = 99999999999999999999.9
-    app_map = {}
-    apps = []
-    newx = []
-    newy = []
-    total_err = 0.0
-    num_over = 0
-    num_under = 0
-    num_less_than_one_percent = 0
-    num_less_than_ten_percent = 0
-    for kernel in kernels:
-        app_name = kernel.split("--")[0]
-        if app_name in app_map:
-            tx, ty, oldk = app_map[app_name]
-            app_map[app_name] = (tx + x[count], ty + y[count], oldk + 1)
-        else:
-            app_map[app_name] = (x[count], y[count], 1)
-        count += 1
-    tot_err_num = 0
-    tot_x = 0
-    rpds = []
-    mse_num = 0
+    # Group the kernels by app, in the order each app first appears
+    app_names = [kernel.split("--")[0] for kernel in kernels]
+    names, first, inverse = np.unique(
+        app_names, return_index=True, return_inverse=True
+    )
+    order = np.argsort(first)
+    rank = np.empty(len(order), dtype=int)
+    rank[order] = np.arange(len(order))
+    inverse = rank[inverse.reshape(-1)]
+    apps = [str(name) for name in names[order]]
+
+    numk = np.bincount(inverse)
+    newx = np.bincount(inverse, weights=x)
+    newy = np.bincount(inverse, weights=y)
 
     # For rates, take the average across all the kernels in the app
     if correlmap.stattype == "rate":
-        new_map = {}
-        for k, v in app_map.items():
-            x1, y1, numk = v
-            new_map[k] = (x1 / numk, y1 / numk, numk)
-        app_map = new_map
-
-    for k, v in app_map.items():
-        apps.append(k)
-        x1, y1, numk = v
-        newx.append(x1)
-        newy.append(y1)
-        tot_err_num += abs(y1 - x1)
-        tot_x += x1
-        if y1 > x1:
-            num_over += 1
-        elif y1 < x1:
-            num_under += 1
-        err = abs(y1 - x1) / (x1 + 0.0000001) * 100
-        mse_num += (y1 - x1) ** 2
-        total_err += err
-        if x1 + y1 == 0:
-            rpds.append(0)
-        else:
-            rpds.append(abs(y1 - x1) / (x1 + y1) * 2)
-        if err < 1.0:
-            num_less_than_one_percent += 1
-        if err < 10.0:
-            num_less_than_ten_percent += 1
-
-    total_err = total_err / len(newx)
+        newx = newx / numk
+        newy = newy / numk
+
+    diff = newy - newx
+    tot_err_num = sum(np.abs(diff).tolist())
+    tot_x = sum(newx.tolist())
+    mse_num = sum((diff**2).tolist())
+    num_over = int(np.sum(newy > newx))
+    num_under = int(np.sum(newy < newx))
+    errs = np.abs(diff) / (newx + 0.0000001) * 100
+    num_less_than_one_percent = int(np.sum(errs < 1.0))
+    num_less_than_ten_percent = int(np.sum(errs < 10.0))
+    with np.errstate(all="ignore"):
+        rpds = np.where(newx + newy == 0, 0, np.abs(diff) / (newx + newy) * 2)
+
+    total_err = sum(errs.tolist()) / len(newx)
     if tot_x > 0:
         aggregate_err = tot_err_num / tot_x * 100
     else:
         aggregate_err = 0
     correl_co = numpy.corrcoef(newx, newy)[0][1]
-    tot_rpd = 0
-    for num in rpds:
-        tot_rpd += num
     rmse = (math.sqrt(mse_num / (len(newx)))) / ((tot_x + 0.000001) / len(newx))
-    ret_rpd = (tot_rpd / len(rpds)) * 100
+    ret_rpd = (sum(rpds.tolist()) / len(rpds)) * 100
 
     return (
         apps,
-        newx,
-        newy,
+        newx.tolist(),
+        newy.tolist(),
         total_err,
         correl_co,
         num_over,
@@ -491,88 +465,10 @@ class Logger:
         open(os.path.join(log_dir, logfile), "w").write(self.correl_log)
 
 
-def get_sim_csv_data(filepath, logger):
-    all_kerns = {}
-    all_kern_cfg = {}
-    stats_missing = set()
-    klist = []
-    with open(filepath, "r") as data_file:
-        reader = csv.reader(data_file)  # define reader object
-        state = "start"
-        first_stat = True
-        for row in reader:  # loop through rows in csv file
-            if len(row) != 0 and row[0].startswith("----"):
-                state = "find-stat"
-                continue
-            if state == "find-stat":
-                current_stat = row[0]
-                logger.log("Processing Stat {0}".format(current_stat))
-                state = "find-apps"
-                continue
-            if state == "find-apps":
-                if first_stat:
-                    last_appargs = ""
-                    for item in row[1:]:
-                        split = item.split("--")
-                        if len(split) > 1:
-                            appargs = split[0]
-                            kname = split[1]
-                            if len(split) > 2:
-                                kname += "--" + split[2]
-                            if kname == "all_kernels":
-                                continue
-                            if appargs == last_appargs:
-                                num += 1
-                            else:
-                                last_appargs = appargs
-                                num = 0
-                            logger.log(
-                                "Found appargs {0}. Kernel {1}".format(appargs, kname)
-                            )
-                            klist.append((appargs, kname, num))
-                            if appargs not in all_kern_cfg:
-                                all_kern_cfg[appargs] = []
-                            all_kern_cfg[appargs].append({})
-                            all_kern_cfg[appargs][-1]["Kernel"] = kname
-                if not kname == "all_kernels":
-                    state = "process-cfgs"
-                continue
-            if state == "process-cfgs":
-                if len(row) == 0:
-                    first_stat = False
-                    state = "start"
-                    continue
-                count = 0
-                cfg = row[0]
-                logger.log("Processing config: {0}".format(cfg))
-                if cfg not in all_kerns:
-                    all_kerns[cfg] = copy.deepcopy(all_kern_cfg)
-                for x in row[1:]:
-                    if count < len(klist):
-                        appargs, kname, num = klist[count]
-                    else:
-                        print(
-                            "More row entries than kernels processed. Likely because of an average column",
-                            file=sys.stderr,
-                        )
-                        break
-                    try:
-                        all_kerns[cfg][appargs][num][current_stat] = float(x)
-                    except ValueError:
-                        all_kerns[cfg][appargs][num][current_stat] = None
-                        stats_missing.add((appargs, num, current_stat))
-                    count += 1
-    for stat in stats_missing:
-        appargs, num, current_stat = stat
-        for cfg in all_kerns.keys():
-            del all_kerns[cfg][appargs][num][current_stat]
-    return all_kerns
-
-
 def parse_hw_csv_2(csv_file, hw_data, appargs, kdata, logger):
     cfg = None
 
-    with open(csv_file, "rU") as data_file:
+    with open(csv_file, "r") as data_file:
         logger.log("Parsing HW csv file {0}".format(csv_file))
         reader = csv.reader(data_file)  # define reader object
         state = "start"
@@ -622,7 +518,7 @@ def parse_hw_csv(csv_file, hw_data, appargs, kdata, logger):
     cfg = ""
     cfg_col = None
 
-    with open(csv_file, "rU") as data_file:
+    with open(csv_file, "r") as data_file:
         logger.log("Parsing HW csv file {0}".format(csv_file))
         reader = csv.reader(data_file)  # define reader object
         state = "start"
@@ -899,6 +795,14 @@ parser.add_option(
     default="",
     help='Turn on minimal logging. Right now "hwsummary" supported.',
 )
+parser.add_option(
+    "-k",
+    "--cache_dir",
+    dest="cache_dir",
+    default=os.path.join(this_directory, "correl_cache"),
+    help="Where the parsed hardware and simulator stats are cached, so that only the"
+    + " csvs that changed since the last call are parsed again. Empty to disable.",
+)
 
 
 (options, args) = parser.parse_args()
@@ -923,53 +827,72 @@ logger = Logger(options.verbose, options.logchannel)
 
 # Get the hardware Data
 logger.log("Getting HW data\n")
+
+
+def parse_hw_dir(root, d, csvs):
+    dir_data = {}
+    kdata = []
+    for csvf in csvs:
+        if "gpc__cycles_elapsed" in csvf:
+            parse_hw_csv_2(
+                csvf,
+                dir_data,
+                os.path.join(os.path.basename(root), d),
+                kdata,
+                logger,
+            )
+        else:
+            parse_hw_csv(
+                csvf,
+                dir_data,
+                os.path.join(os.path.basename(root), d),
+                kdata,
+                logger,
+            )
+    return dir_data
+
+
 hw_data = {}
 if options.hardware_dict == None:
-    for root, dirs, files in os.walk(options.hardware_dir):
-        for d in dirs:
-            csv_dir = os.path.join(root, d)
-            csvs = sorted(glob.glob(os.path.join(csv_dir, "*.csv*")))
-            if len(csvs) == 0:
-                continue
-            #        latest_date = re.search("(.*).csv*",os.path.basename(csvs[-1])).group(1)
-            #        csvs = glob.glob(os.path.join(csv_dir,"{0}.csv*".format(latest_date)))
-            #        logger.log("For {0}: Using Date: [{1}]. Containd {2} files\n".format(csv_dir, latest_date, len(csvs)))
-            kdata = []
-            for csvf in csvs:
-                if "gpc__cycles_elapsed" in csvf:
-                    parse_hw_csv_2(
-                        csvf,
-                        hw_data,
-                        os.path.join(os.path.basename(root), d),
-                        kdata,
-                        logger,
-                    )
-                else:
-                    parse_hw_csv(
-                        csvf,
-                        hw_data,
-                        os.path.join(os.path.basename(root), d),
-                        kdata,
-                        logger,
-                    )
+    hw_data = correl_table.load_hw_dir(
+        options.hardware_dir, parse_hw_dir, options.cache_dir
+    )
 else:
     print("Begin pickle.load")
     with open(options.hardware_dict, "rb") as hw_dictionary_file:
         hw_data = pickle.load(hw_dictionary_file)
     print("End pickle.load")
 summarize_hw_data(hw_data, logger)
+hw_table = correl_table.HwTable(hw_data)
 # with open('hwdata.{0}.dictionary'.format(options.hardware_dir).replace('/','_'),
 #            'wb') as hw_dictionary_file:
 #     pickle.dump(hw_data, hw_dictionary_file)
 
 # Get the simulator data
 logger.log("Processing simulator data\n")
-sim_data = get_sim_csv_data(options.csv_file, logger)
+if options.cache_dir != "":
+    sim_table = correl_table.cached_parse(
+        options.csv_file,
+        lambda csvf: correl_table.SimTable.from_csv(csvf, logger),
+        options.cache_dir,
+        "SimTable",
+    )
+else:
+    sim_table = correl_table.SimTable.from_csv(options.csv_file, logger)
 
 exec(open(options.data_mappings, "r").read())
 
+compiled_evals = {}
+
+
+def compile_eval(expression):
+    if expression not in compiled_evals:
+        compiled_evals[expression] = compile(expression, expression, "eval")
+    return compiled_evals[expression]
+
+
 fig_data = {}  # map of HW config to a list of scatters
-for cfg, sim_for_cfg in sim_data.items():
+for cfg in sim_table.columns.keys():
     if cfg.split("-")[0] not in config_maps:
         logger.log("cfg {0} not in config_maps:{1}.".format(cfg, config_maps))
         continue
@@ -991,6 +914,39 @@ for cfg, sim_for_cfg in sim_data.items():
         logger.log("Cannot find HW data for {0} skipping plots.".format(hw_cfg))
         continue
 
+    # Pair the simulated kernels with the hardware ones. This is the same for
+    # every correl, only the values differ.
+    sim_rows = []
+    hw_rows = []
+    sim_appargs_leftover = set(sim_table.app_rows.keys())
+    hw_appargs_leftover = set(hw_data[hw_cfg].keys())
+    for appargs, app_rows in sim_table.app_rows.items():
+        if appargs in hw_data[hw_cfg]:
+            if isAppBanned(appargs, blacklist):
+                continue
+
+            hw_klist = hw_data[hw_cfg][appargs]
+            if len(app_rows) <= len(hw_klist):
+                logger.log(
+                    "Found hw/sim match for {0}. Sim={1}. HW={2}".format(
+                        appargs, len(app_rows), len(hw_klist)
+                    )
+                )
+                sim_appargs_leftover.remove(appargs)
+                hw_appargs_leftover.remove(appargs)
+                hw_offset = hw_table.app_offsets[hw_cfg][appargs]
+                sim_rows += app_rows
+                hw_rows += range(hw_offset, hw_offset + len(app_rows))
+            else:
+                logger.log(
+                    "For appargs={0}, HW/SW kernels do not match HW={1}, SIM={2} and software has more than hardware\n".format(
+                        appargs, len(hw_klist), len(app_rows)
+                    )
+                )
+    evaluator = correl_table.CorrelEvaluator(
+        sim_table, cfg, hw_table, hw_cfg, sim_rows, hw_rows, globals()
+    )
+
     for correl in correl_list:
         if correl.hw_name != "all" and correl.hw_name not in hw_cfg:
             logger.log(
@@ -1000,177 +956,81 @@ for cfg, sim_for_cfg in sim_data.items():
             )
             continue
 
-        hw_array = []
-        hw_error = []
-        hw_error_min = []
-        sim_array = []
-        label_array = []
-        color_array = []
-
-        appcount = 0
-        kernelcount = 0
-        num_less_than_one_percent = 0
-        num_less_than_ten_percent = 0
-        num_under = 0
-        num_over = 0
-        errs = []
-        sim_appargs_leftover = set(copy.deepcopy(list(sim_for_cfg.keys())))
-        hw_appargs_leftover = set(copy.deepcopy(list(hw_data[hw_cfg].keys())))
-        max_axis_val = 0.0
-        min_axis_val = 99999999999999999999999999999.9
         err_dropped_stats = 0
-        hw_low_drop_stats = 0
-        apps_included = {}
-        for appargs, sim_klist in sim_for_cfg.items():
-            if appargs in hw_data[hw_cfg]:
-                if isAppBanned(appargs, blacklist):
-                    continue
-
-                hw_klist = hw_data[hw_cfg][appargs]
-                processAnyKernels = False
-                if len(sim_klist) <= len(hw_klist):
-                    logger.log(
-                        "Found hw/sim match for {0}. Sim={1}. HW={2}".format(
-                            appargs, len(sim_klist), len(hw_klist)
-                        )
-                    )
-                    sim_appargs_leftover.remove(appargs)
-                    hw_appargs_leftover.remove(appargs)
-                    count = 0
-                    for sim in sim_klist:
-                        hw = hw_klist[count]
-                        try:
-                            logger.log("Evaluating HW: {0}".format(correl.hw_eval))
-                            hw_array.append(eval(correl.hw_eval))
-                        except:
-                            e = sys.exc_info()[0]
-                            logger.log(
-                                "Potentially uncollected stat in {0}.Error: {1}".format(
-                                    correl.hw_eval, e
-                                )
-                            )
-                            #                            print hw
-                            #                            exit(1)
-                            count += 1
-                            continue
-
-                        if hw_array[-1] < correl.drophwnumbelow:
-                            hw_low_drop_stats += 1
-                            hw_array = hw_array[:-1]
-                            count += 1
-                            continue
-
-                        try:
-                            sim_array.append(eval(correl.sim_eval))
-                        except KeyError as e:
-                            logger.log(
-                                "Potentially uncollected stat in {0}.Error: {1}".format(
-                                    correl.sim_eval, e
-                                )
-                            )
-                            hw_array = hw_array[:-1]
-                            count += 1
-                            continue
-                        except ZeroDivisionError as e:
-                            logger.log(
-                                "Division by zerofor  stat in {0}.Error: {1}".format(
-                                    correl.sim_eval, e
-                                )
-                            )
-                            count += 1
-                            hw_array = hw_array[:-1]
-                            continue
-
-                        if correl.hw_error != None:
-                            maxe, mine = eval(correl.hw_error)
-                            hw_error.append(maxe)
-                            hw_error_min.append(mine)
-                        else:
-                            hw_error.append(0)
-                            hw_error_min.append(0)
-
-                        if appargs not in apps_included:
-                            apps_included[appargs] = []
-
-                        processAnyKernels = True
-                        err = 99999
-                        hw_high = 0
-                        hw_low = 999999999999
-
-                        kernelcount += 1
-                        err = sim_array[-1] - hw_array[-1]
-
-                        if hw_array[-1] != 0:
-                            hw_high = (hw_error[-1] / hw_array[-1]) * 100
-                            hw_low = (hw_error_min[-1] / hw_array[-1]) * 100
-                            err = (err / hw_array[-1]) * 100
-                        else:
-                            hw_high = 0
-                            hw_low = 0
-                            err = 0
-
-                        if abs(err) < 10.0:
-                            num_less_than_ten_percent += 1
-
-                        if abs(err) < 1.0:
-                            num_less_than_one_percent += 1
-
-                        elif err > 0:
-                            num_over += 1
-                        else:
-                            num_under += 1
-
-                        errs.append(abs(err))
-                        apps_included[appargs].append((err, sim_klist[count]["Kernel"]))
-
-                        label_array.append(
-                            (appargs + "--" + sim_klist[count]["Kernel"])
-                            + " (Err={0:.2f}%,HW-Range=+{1:.2f}%/-{2:.2f}%)".format(
-                                err, hw_high, hw_low
-                            )
-                        )
-                        count += 1
-                        if hw_array[-1] > max_axis_val:
-                            max_axis_val = hw_array[-1]
-                        if sim_array[-1] > max_axis_val:
-                            max_axis_val = sim_array[-1]
-
-                        if hw_array[-1] < min_axis_val:
-                            min_axis_val = hw_array[-1]
-                        if sim_array[-1] < min_axis_val:
-                            min_axis_val = sim_array[-1]
-
-                else:
-                    logger.log(
-                        "For appargs={0}, HW/SW kernels do not match HW={1}, SIM={2} and software has more than hardware\n".format(
-                            appargs, len(hw_klist), len(sim_klist)
-                        )
-                    )
-                if processAnyKernels:
-                    appcount += 1
         logger.log(
             "Sim apps no HW:\n{0}\nHW apps no sim data:\n{1}".format(
                 sim_appargs_leftover, hw_appargs_leftover
             )
         )
 
-        if len(errs) == 0:
+        # Kernels whose hardware or simulator value cannot be computed are left out
+        logger.log("Evaluating HW: {0}".format(correl.hw_eval))
+        (hw_all,) = evaluator.evaluate(compile_eval(correl.hw_eval))
+        hw_found = np.isfinite(hw_all)
+        hw_too_low = hw_found & (hw_all < correl.drophwnumbelow)
+        hw_low_drop_stats = int(np.sum(hw_too_low))
+        (sim_all,) = evaluator.evaluate(compile_eval(correl.sim_eval))
+        included = hw_found & ~hw_too_low & np.isfinite(sim_all)
+        logger.log(
+            "Potentially uncollected stat in {0} or {1} for {2} kernels".format(
+                correl.hw_eval,
+                correl.sim_eval,
+                int(np.sum(~hw_found | (~hw_too_low & ~np.isfinite(sim_all)))),
+            )
+        )
+
+        kernelcount = int(np.sum(included))
+        if kernelcount == 0:
             continue
 
-        for i in range(len(hw_array)):
-            if hw_array[i] != 0:
-                hw_high = (hw_error[i] / hw_array[i]) * 100
-                hw_low = (hw_error_min[i] / hw_array[i]) * 100
-            else:
-                hw_high = 0
-                hw_low = 0
+        hw_array = hw_all[included]
+        sim_array = sim_all[included]
+        if correl.hw_error != None:
+            hw_error, hw_error_min = evaluator.evaluate(
+                compile_eval(correl.hw_error), 2
+            )
+            hw_error = hw_error[included]
+            hw_error_min = hw_error_min[included]
+        else:
+            hw_error = np.zeros(kernelcount)
+            hw_error_min = np.zeros(kernelcount)
+
+        with np.errstate(all="ignore"):
+            hw_nonzero = hw_array != 0
+            err = np.where(hw_nonzero, (sim_array - hw_array) / hw_array * 100, 0)
+            hw_high = np.where(hw_nonzero, hw_error / hw_array * 100, 0)
+            hw_low = np.where(hw_nonzero, hw_error_min / hw_array * 100, 0)
+        abs_err = np.abs(err)
+        num_less_than_ten_percent = int(np.sum(abs_err < 10.0))
+        num_less_than_one_percent = int(np.sum(abs_err < 1.0))
+        num_over = int(np.sum((abs_err >= 1.0) & (err > 0)))
+        num_under = int(np.sum((abs_err >= 1.0) & ~(err > 0)))
+
+        apps_included = {}
+        label_array = []
+        for i, row in enumerate(np.array(sim_rows)[included]):
+            appargs, kname, num = sim_table.kernels[row]
+            if appargs not in apps_included:
+                apps_included[appargs] = []
+            apps_included[appargs].append((err[i], kname))
+            label_array.append(
+                (appargs + "--" + kname)
+                + " (Err={0:.2f}%,HW-Range=+{1:.2f}%/-{2:.2f}%)".format(
+                    err[i], hw_high[i], hw_low[i]
+                )
+            )
+        appcount = len(apps_included)
+
+        max_axis_val = max(0.0, np.max(hw_array), np.max(sim_array))
+        min_axis_val = min(
+            99999999999999999999999999999.9, np.min(hw_array), np.min(sim_array)
+        )
 
         correl_co = numpy.corrcoef(hw_array, sim_array)[0][1]
-        avg_err = 0
-        for err in errs:
-            avg_err += err
-        avg_err = avg_err / len(errs)
+        avg_err = sum(abs_err.tolist()) / kernelcount
 
+        hw_array = hw_array.tolist()
+        sim_array = sim_array.tolist()
         trace = go.Scatter(
             x=hw_array,
             y=sim_array,
@@ -1179,8 +1039,8 @@ for cfg, sim_for_cfg in sim_data.items():
             error_x=dict(
                 type="data",
                 symmetric=False,
-                array=hw_error,
-                arrayminus=hw_error_min,
+                array=hw_error.tolist(),
+                arrayminus=hw_error_min.tolist(),
                 visible=True,
             ),
             name=cfg,
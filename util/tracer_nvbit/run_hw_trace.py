@@ -132,7 +132,8 @@ for bench in benchmarks:
             if options.kernel_number > 0:
                 os.environ["DYNAMIC_KERNEL_LIMIT_END"] = str(options.kernel_number)
 
-        # first we generate the traces (.trace and kernelslist files)
+        # the tracer writes thread block grouped traces (.traceg and kernelslist.g files) directly.
+        # with TRACE_GROUP_PER_BLOCK=0 it generates raw traces (.trace and kernelslist files) instead,
         # then, we do post-processing for the traces and generate (.traceg and kernelslist.g files)
         # then, we delete the intermediate files ((.trace and kernelslist files files)
         sh_contents += (
@@ -152,13 +153,15 @@ for bench in benchmarks:
             + exec_path
             + " "
             + str(args)
-            + " ; "
+            + " ; if [ -f "
+            + os.path.join(this_trace_folder, "kernelslist")
+            + " ]; then "
             + os.path.join(
                 nvbit_tracer_path, "traces-processing", "post-traces-processing"
             )
             + " "
             + os.path.join(this_trace_folder, "kernelslist")
-            + " ; rm -f "
+            + " ; fi ; rm -f "
             + this_trace_folder
             + "/*.trace ; rm -f "
             + this_trace_folder
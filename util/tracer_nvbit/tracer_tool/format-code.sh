@@ -3,3 +3,4 @@ THIS_DIR="$( cd "$( dirname "$BASH_SOURCE" )" && pwd )"
 clang-format -i ${THIS_DIR}/*.cu
 clang-format -i ${THIS_DIR}/*.h
 clang-format -i ${THIS_DIR}/traces-processing/*.cpp
+clang-format -i ${THIS_DIR}/traces-processing/*.h
@@ -29,6 +29,9 @@
 /* contains definition of the inst_trace_t structure */
 #include "common.h"
 
+/* groups the instruction stream per thread block while tracing */
+#include "traces-processing/tb_trace_grouper.h"
+
 #define TRACER_VERSION "5"
 
 /* Channel used to communicate from GPU to CPU receiving thread */
@@ -64,6 +67,13 @@ int user_defined_folders = 0;
 /* Use xz to compress the *.trace file */
 int xz_compress_trace = 0;
 
+/* Write thread block grouped traces (*.traceg and kernelslist.g) directly,
+ * so that post-traces-processing is not needed anymore */
+int group_per_block = 1;
+/* Memory budget of the per thread block buffers before they spill to disk */
+uint64_t group_mem_limit_mb = 2048;
+ThreadBlockTraceGrouper *tb_grouper = NULL;
+
 /* opcode to id map and reverse map  */
 std::map<std::string, int> opcode_to_id_map;
 std::map<int, std::string> id_to_opcode_map;
@@ -116,6 +126,14 @@ void nvbit_at_init() {
   GET_VAR_INT(xz_compress_trace, "TRACE_FILE_COMPRESS", 0,
               "Create xz-compressed trace"
               "file");
+  GET_VAR_INT(group_per_block, "TRACE_GROUP_PER_BLOCK", 1,
+              "Write traces grouped per thread block (kernel-N.traceg and "
+              "kernelslist.g). If set to 0, write the raw warp-interleaved "
+              "traces that need post-traces-processing");
+  GET_VAR_INT(group_mem_limit_mb, "TRACE_GROUP_MEM_LIMIT_MB", 2048,
+              "Memory budget in MB for buffering running thread blocks when "
+              "TRACE_GROUP_PER_BLOCK=1; beyond it they spill to temporary "
+              "files in the traces folder");
   std::string pad(100, '-');
   printf("%s\n", pad.c_str());
 
@@ -341,6 +359,12 @@ void nvbit_at_cuda_event(CUcontext ctx, int is_exit, nvbit_api_cuda_t cbid,
       printf("Stats location is %s \n", stats_location.c_str());
     }
 
+    if (group_per_block) {
+      kernelslist_location += ".g";
+      tb_grouper = new ThreadBlockTraceGrouper(group_mem_limit_mb << 20,
+                                               traces_location);
+    }
+
     kernelsFile = fopen(kernelslist_location.c_str(), "w");
     statsFile = fopen(stats_location.c_str(), "w");
     fprintf(statsFile,
@@ -399,8 +423,9 @@ void nvbit_at_cuda_event(CUcontext ctx, int is_exit, nvbit_api_cuda_t cbid,
       }
 
       char buffer[1024];
-      sprintf(buffer, std::string(traces_location + "/kernel-%d.trace").c_str(),
-              kernelid);
+      sprintf(buffer,
+              std::string(traces_location + "/kernel-%d.trace%s").c_str(),
+              kernelid, group_per_block ? "g" : "");
 
       if (!stop_report) {
         if (!xz_compress_trace) {
@@ -440,12 +465,17 @@ void nvbit_at_cuda_event(CUcontext ctx, int is_exit, nvbit_api_cuda_t cbid,
                 "[reg_srcs] mem_width [adrrescompress?] [mem_addresses] "
                 "immediate\n");
         fprintf(resultsFile, "\n");
+
+        if (group_per_block)
+          tb_grouper->begin_kernel(resultsFile, p->gridDimX, p->gridDimY,
+                                   p->gridDimZ, p->blockDimX, p->blockDimY,
+                                   p->blockDimZ);
       }
 
       kernelsFile = fopen(kernelslist_location.c_str(), "a");
       // This will be a relative path to the traces file
-      sprintf(buffer, "kernel-%d.trace%s", kernelid,
-              xz_compress_trace ? ".xz" : "");
+      sprintf(buffer, "kernel-%d.trace%s%s", kernelid,
+              group_per_block ? "g" : "", xz_compress_trace ? ".xz" : "");
       if (!stop_report) {
         fprintf(kernelsFile, buffer);
         fprintf(kernelsFile, "\n");
@@ -505,6 +535,8 @@ void nvbit_at_cuda_event(CUcontext ctx, int is_exit, nvbit_api_cuda_t cbid,
       fclose(statsFile);
 
       if (!stop_report) {
+        if (group_per_block)
+          tb_grouper->end_kernel();
         if (!xz_compress_trace) {
           fclose(resultsFile);
         } else {
@@ -613,8 +645,12 @@ void base_delta_compress(const uint64_t *addrs, const std::bitset<32> &mask,
   }
 }
 
+/* large enough for a fully divergent list of 32 addresses */
+#define MAX_TRACE_LINE_SIZE 4096
+
 void *recv_thread_fun(void *) {
   char *recv_buffer = (char *)malloc(CHANNEL_SIZE);
+  char line[MAX_TRACE_LINE_SIZE];
   while (recv_thread_started) {
     uint32_t num_recv_bytes = 0;
     if (recv_thread_receiving &&
@@ -630,48 +666,49 @@ void *recv_thread_fun(void *) {
           break;
         }
 
-        fprintf(resultsFile, "%d ", ma->cta_id_x);
-        fprintf(resultsFile, "%d ", ma->cta_id_y);
-        fprintf(resultsFile, "%d ", ma->cta_id_z);
-        fprintf(resultsFile, "%d ", ma->warpid_tb);
+        // Everything after the thread block and warp ids. The grouped output
+        // drops the ids, as they are recorded in the #BEGIN_TB header.
+        std::bitset<32> mask(ma->active_mask & ma->predicate_mask);
+        const std::string &opcode = id_to_opcode_map[ma->opcode_id];
+        int pos = 0;
         if (print_core_id) {
-          fprintf(resultsFile, "%d ", ma->sm_id);
-          fprintf(resultsFile, "%d ", ma->warpid_sm);
+          pos += sprintf(line + pos, "%d ", ma->sm_id);
+          pos += sprintf(line + pos, "%d ", ma->warpid_sm);
         }
         if (lineinfo) {
-          fprintf(resultsFile, "%d ", ma->line_num);
+          pos += sprintf(line + pos, "%d ", ma->line_num);
         }
-        fprintf(resultsFile, "%04x ", ma->vpc); // Print the virtual PC
-        fprintf(resultsFile, "%08x ", ma->active_mask & ma->predicate_mask);
+        pos += sprintf(line + pos, "%04x ", ma->vpc); // Print the virtual PC
+        pos += sprintf(line + pos, "%08x ",
+                       ma->active_mask & ma->predicate_mask);
         if (ma->GPRDst >= 0) {
-          fprintf(resultsFile, "1 ");
-          fprintf(resultsFile, "R%d ", ma->GPRDst);
+          pos += sprintf(line + pos, "1 ");
+          pos += sprintf(line + pos, "R%d ", ma->GPRDst);
         } else
-          fprintf(resultsFile, "0 ");
+          pos += sprintf(line + pos, "0 ");
 
         // Print the opcode.
-        fprintf(resultsFile, "%s ", id_to_opcode_map[ma->opcode_id].c_str());
+        pos += sprintf(line + pos, "%s ", opcode.c_str());
         unsigned src_count = 0;
         for (int s = 0; s < MAX_SRC; s++) // GPR srcs count.
           if (ma->GPRSrcs[s] >= 0)
             src_count++;
-        fprintf(resultsFile, "%d ", src_count);
+        pos += sprintf(line + pos, "%d ", src_count);
 
         for (int s = 0; s < MAX_SRC; s++) // GPR srcs.
           if (ma->GPRSrcs[s] >= 0)
-            fprintf(resultsFile, "R%d ", ma->GPRSrcs[s]);
+            pos += sprintf(line + pos, "R%d ", ma->GPRSrcs[s]);
 
         // print addresses
-        std::bitset<32> mask(ma->active_mask & ma->predicate_mask);
         if (ma->is_mem) {
-          std::istringstream iss(id_to_opcode_map[ma->opcode_id]);
+          std::istringstream iss(opcode);
           std::vector<std::string> tokens;
           std::string token;
           while (std::getline(iss, token, '.')) {
             if (!token.empty())
               tokens.push_back(token);
           }
-          fprintf(resultsFile, "%d ", get_datawidth_from_opcode(tokens));
+          pos += sprintf(line + pos, "%d ", get_datawidth_from_opcode(tokens));
 
           bool base_stride_success = false;
           uint64_t base_addr = 0;
@@ -690,31 +727,41 @@ void *recv_thread_fun(void *) {
 
           if (base_stride_success && enable_compress) {
             // base + stride format
-            fprintf(resultsFile, "%u 0x%llx %d ", address_format::base_stride,
-                    base_addr, stride);
+            pos += sprintf(line + pos, "%u 0x%llx %d ",
+                           address_format::base_stride, base_addr, stride);
           } else if (!base_stride_success && enable_compress) {
             // base + delta format
-            fprintf(resultsFile, "%u 0x%llx ", address_format::base_delta,
-                    base_addr);
+            pos += sprintf(line + pos, "%u 0x%llx ", address_format::base_delta,
+                           base_addr);
             for (int s = 0; s < deltas.size(); s++) {
-              fprintf(resultsFile, "%lld ", deltas[s]);
+              pos += sprintf(line + pos, "%lld ", deltas[s]);
             }
           } else {
             // list all the addresses
-            fprintf(resultsFile, "%u ", address_format::list_all);
+            pos += sprintf(line + pos, "%u ", address_format::list_all);
             for (int s = 0; s < 32; s++) {
               if (mask.test(s))
-                fprintf(resultsFile, "0x%016lx ", ma->addrs[s]);
+                pos += sprintf(line + pos, "0x%016lx ", ma->addrs[s]);
             }
           }
         } else {
-          fprintf(resultsFile, "0 ");
+          pos += sprintf(line + pos, "0 ");
         }
 
         // Print the immediate
-        fprintf(resultsFile, "%d ", ma->imm);
-
-        fprintf(resultsFile, "\n");
+        pos += sprintf(line + pos, "%d ", ma->imm);
+
+        if (group_per_block) {
+          uint32_t exit_mask =
+              opcode.compare(0, 4, "EXIT") == 0 ? mask.to_ulong() : 0;
+          tb_grouper->add_inst(ma->cta_id_x, ma->cta_id_y, ma->cta_id_z,
+                               ma->warpid_tb, line, pos,
+                               opcode.find("LDGSTS") != std::string::npos,
+                               exit_mask);
+        } else {
+          fprintf(resultsFile, "%d %d %d %d %s\n", ma->cta_id_x, ma->cta_id_y,
+                  ma->cta_id_z, ma->warpid_tb, line);
+        }
 
         num_processed_bytes += sizeof(inst_trace_t);
       }
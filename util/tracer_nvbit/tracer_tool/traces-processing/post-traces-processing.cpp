@@ -1,3 +1,5 @@
+#include <chrono>
+#include <cstring>
 #include <deque>
 #include <fstream>
 #include <iostream>
@@ -6,11 +8,13 @@
 #include <sstream>
 #include <stdio.h>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 #include <errno.h>
+#include <getopt.h>
 #include <signal.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 using namespace std;
@@ -18,66 +22,150 @@ using namespace std;
 struct threadblock_info {
   bool initialized;
   unsigned tb_id_x, tb_id_y, tb_id_z;
-  vector<deque<const string *>> warp_insts_array;
+  vector<deque<const string_view *>> warp_insts_array;
   threadblock_info() {
     initialized = false;
     tb_id_x = tb_id_y = tb_id_z = 0;
   }
 };
 
+/// @brief Bump allocator for the interned instruction strings. Strings are
+/// copied back to back into large chunks and are only released all at once,
+/// when the arena is destroyed.
+struct StringArena {
+  static const size_t chunk_size = 1 << 20;
+  vector<unique_ptr<char[]>> chunks;
+  size_t chunk_used = 0;
+  size_t chunk_capacity = 0;
+  size_t allocated = 0;
+
+  string_view store(string_view s) {
+    if (chunk_used + s.size() > chunk_capacity) {
+      // oversized strings get a chunk of their own
+      chunk_capacity = max(chunk_size, s.size());
+      chunks.emplace_back(new char[chunk_capacity]);
+      chunk_used = 0;
+      allocated += chunk_capacity;
+    }
+    char *dst = chunks.back().get() + chunk_used;
+    memcpy(dst, s.data(), s.size());
+    chunk_used += s.size();
+    return string_view(dst, s.size());
+  }
+};
+
 /// @brief There exist significant repetition in the trace. The WarpInstLUT
-/// registers recurrent trace fragments in a hash map. Strings (trace fragments)
-/// are mapped to a pointer to a unique copy of that string, which is guaranteed
-/// to live throughout the scope of the lifetime of this WarpInstLUT.
+/// interns recurrent trace fragments: every distinct string is copied once
+/// into an arena, and all the lookups of an equal string return the same
+/// pointer, which is guaranteed to live throughout the scope of the lifetime
+/// of this WarpInstLUT.
+///
+/// The table uses open addressing with linear probing. Each slot keeps the
+/// full hash next to the entry index, so a line is hashed exactly once,
+/// mismatching slots are mostly rejected without touching the string, and
+/// growing the table does not rehash any string.
 struct WarpInstLUT {
-  // A mapping from "raw instruction string" to "a pointer to a global copy of
-  // that string". For any element (x->y) of this map, *y==x holds.
-  unordered_map<string, unique_ptr<string>> registration_table;
-
-  /// @brief Is a string already registered?
-  /// @param s The probing string.
-  /// @return nullptr if the probing string does not exist in the look up table.
-  /// Otherwise, a const pointer to a unique copy of that string.
-  const string *lookup_entry(const string s) const {
-    const auto it = registration_table.find(s);
-
-    // not registered
-    if (it == registration_table.end()) {
-      return nullptr;
-    } else {
-      return it->second.get();
+  struct slot {
+    size_t hash;
+    uint32_t entry; // index + 1 into entries, 0 means empty
+  };
+
+  StringArena arena;
+  // stable addresses: a deque never moves its elements when it grows
+  deque<string_view> entries;
+  vector<slot> slots = vector<slot>(1024);
+
+  /// @brief Look up a string and add it to the table if it is not there yet.
+  /// @param s The probing string; it is copied only when it is new.
+  /// @return A const pointer to the unique copy of that string.
+  const string_view *intern(string_view s) {
+    size_t hash = std::hash<string_view>()(s);
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      slot &sl = slots[i];
+      if (sl.entry == 0) {
+        entries.push_back(arena.store(s));
+        sl.hash = hash;
+        sl.entry = entries.size();
+        // keep the load factor under 1/2
+        if (2 * entries.size() > slots.size())
+          grow();
+        return &entries.back();
+      }
+      if (sl.hash == hash && entries[sl.entry - 1] == s)
+        return &entries[sl.entry - 1];
+    }
+  }
+
+  /// @brief Approximate number of bytes held by the table.
+  size_t memory_footprint() const {
+    return arena.allocated + entries.size() * sizeof(string_view) +
+           slots.size() * sizeof(slot);
+  }
+
+private:
+  void grow() {
+    vector<slot> old(slots.size() * 2);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const slot &sl : old) {
+      if (sl.entry == 0)
+        continue;
+      size_t i = sl.hash & mask;
+      while (slots[i].entry != 0)
+        i = (i + 1) & mask;
+      slots[i] = sl;
     }
   }
+};
+
+void group_per_block(const char *filepath, size_t mem_limit);
+void group_per_core(const char *filepath);
 
-  /// @brief Add a string to the look up table.
-  /// @param s The string to be added.
-  /// @return A const pointer to the unique copy of the string.
-  const string *register_new_entry(const string s) {
-    // Check if the string is already in the LUT.
-    const string *entry_ptr = lookup_entry(s);
-    if (entry_ptr) {
-      // just in case a rare hash collision happens, we panic
-      if (s != *entry_ptr) {
-        cerr << "FATAL: new string insertion " << s
-             << "collides with the hash of a different string in the "
-                "registration table "
-             << *entry_ptr << "\n";
-        abort();
+/// @brief Out-of-core storage used when the grouped instructions of a kernel
+/// do not fit in the memory budget. Thread blocks are partitioned into
+/// contiguous id ranges with one temporary file each. Instructions are
+/// appended as "tb_id warpid_tb rest_of_line" after the LDGSTS filtering, and
+/// each bucket is grouped in memory on its own in a final sequential pass, so
+/// the output order is the same as the in-memory path.
+struct tb_spill_buckets {
+  vector<FILE *> files;
+  unsigned tbs_per_bucket = 0;
+
+  bool active() const { return !files.empty(); }
+
+  void open(const string &dir, unsigned num_tbs, unsigned num_buckets) {
+    tbs_per_bucket = (num_tbs + num_buckets - 1) / num_buckets;
+    num_buckets = (num_tbs + tbs_per_bucket - 1) / tbs_per_bucket;
+    for (unsigned b = 0; b < num_buckets; ++b) {
+      string path = dir + "/.post_traces_bucket_XXXXXX";
+      vector<char> tmpl(path.begin(), path.end());
+      tmpl.push_back('\0');
+      int fd = mkstemp(tmpl.data());
+      if (fd < 0) {
+        cerr << "Failed to create bucket file " << path << "\n";
+        perror("mkstemp");
+        exit(1);
       }
-      return entry_ptr;
+      // the file is removed as soon as it is closed
+      unlink(tmpl.data());
+      files.push_back(fdopen(fd, "w+"));
     }
+  }
 
-    // Create a new string
-    auto new_string_ptr = std::make_unique<string>(s);
-    entry_ptr = new_string_ptr.get();
-    registration_table.insert({s, std::move(new_string_ptr)});
+  void append(unsigned tb_id, unsigned warpid_tb, string_view inst) {
+    fprintf(files[tb_id / tbs_per_bucket], "%u %u %.*s\n", tb_id, warpid_tb,
+            (int)inst.size(), inst.data());
+  }
 
-    return entry_ptr;
+  void close_all() {
+    for (FILE *f : files)
+      fclose(f);
+    files.clear();
   }
 };
 
-void group_per_block(const char *filepath);
-void group_per_core(const char *filepath);
+void print_threadblock(const threadblock_info &tb);
 
 // This program works by redirecting the stdin/stdout to child processes. The
 // stdin is piped to a process that reads from disk the input trace file. The
@@ -87,30 +175,102 @@ void group_per_core(const char *filepath);
 int preserved_stdin_fileno;
 int preserved_stdout_fileno;
 
+void print_usage(const char *prog) {
+  cerr << "Usage: " << prog << " [-j jobs] [-m mem_limit_mb] <kernelslist>\n"
+       << "  -j, --jobs       number of kernels processed in parallel "
+          "(default 1)\n"
+       << "  -m, --mem-limit  memory budget in MB per job; kernels that do "
+          "not fit are\n"
+       << "                   grouped out of core through temporary files "
+          "(default 0, unlimited)\n";
+}
+
+// Each kernel is processed in its own forked process, since
+// group_per_block() redirects the stdin/stdout of the process it runs in.
+// Returns the number of kernels that failed.
+unsigned run_kernel_jobs(const vector<string> &kernels, unsigned jobs,
+                         size_t mem_limit) {
+  unsigned next = 0, done = 0, failed = 0, running = 0;
+  auto start = chrono::steady_clock::now();
+  while (done < kernels.size()) {
+    while (running < jobs && next < kernels.size()) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        group_per_block(kernels[next].c_str(), mem_limit);
+        fflush(stdout);
+        _exit(0);
+      } else if (pid < 0) {
+        cerr << "Failed to fork a job for " << kernels[next] << "\n";
+        perror("fork");
+        exit(1);
+      }
+      running++;
+      next++;
+    }
+
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+      perror("wait");
+      exit(1);
+    }
+    running--;
+    done++;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      failed++;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() -
+                                              start)
+                         .count();
+    cerr << "[" << done << "/" << kernels.size() << "] kernels processed, "
+         << elapsed << " s elapsed" << (failed ? ", some failed" : "")
+         << endl;
+  }
+  return failed;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char **argv) {
   string kernellist_filepath;
-  bool is_per_core;
-  if (argc == 1) {
+  unsigned jobs = 1;
+  size_t mem_limit_mb = 0;
+
+  static struct option long_options[] = {
+      {"jobs", required_argument, NULL, 'j'},
+      {"mem-limit", required_argument, NULL, 'm'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "j:m:h", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'j':
+      jobs = strtoul(optarg, NULL, 10);
+      if (jobs == 0)
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+      break;
+    case 'm':
+      mem_limit_mb = strtoull(optarg, NULL, 10);
+      break;
+    default:
+      print_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  // the legacy second argument (is_per_core) is accepted and ignored
+  if (optind == argc) {
     cerr << "File path is missing\n";
+    print_usage(argv[0]);
     return 0;
-  } else if (argc == 2) {
-    kernellist_filepath = argv[1];
-    is_per_core = true;
-
-  } else if (argc == 3) {
-    kernellist_filepath = argv[1];
-    is_per_core = bool(argv[2]);
-  } else {
+  } else if (argc - optind > 2) {
     cerr << "Too Many Arguemnts!\n";
     return 0;
   }
+  kernellist_filepath = argv[optind];
 
   ifstream ifs;
   ofstream ofs;
 
   ifs.open(kernellist_filepath.c_str());
-  ofs.open((string(kernellist_filepath) + ".g").c_str());
 
   if (!ifs.is_open()) {
     cerr << "Unable to open file: " << kernellist_filepath << endl;
@@ -123,32 +283,48 @@ int main(int argc, char **argv) {
     directory = directory.substr(0, last_slash_idx);
   }
 
+  // kernelslist.g is only written once the whole list parsed, so that a
+  // malformed list never leaves a partial one behind for the simulator
   string line;
   string filepath;
+  vector<string> kernels;
+  stringstream commands;
   while (!ifs.eof()) {
     getline(ifs, line);
     if (line.empty())
       continue;
     else if (line.substr(0, 6) == "Memcpy") {
-      ofs << line << endl;
+      commands << line << endl;
     } else if (line.substr(0, 6) == "kernel") {
       filepath = directory + "/" + line;
-      group_per_block(filepath.c_str());
+      kernels.push_back(filepath);
 
       int _l = line.length();
       if (_l > 3 && line.substr(_l - 3, 3) == ".xz") {
-        ofs << line.substr(0, _l - 3) << "g.xz" << endl;
+        commands << line.substr(0, _l - 3) << "g.xz" << endl;
       } else {
-        ofs << line + "g" << endl;
+        commands << line + "g" << endl;
       }
     } else {
       cerr << "Undefined command: " << line << endl;
-      return 0;
+      return 1;
     }
   }
 
   ifs.close();
+  ofs.open((string(kernellist_filepath) + ".g").c_str());
+  ofs << commands.str();
   ofs.close();
+  if (!ofs) {
+    cerr << "Unable to write " << kernellist_filepath << ".g" << endl;
+    return 1;
+  }
+
+  unsigned failed = run_kernel_jobs(kernels, jobs, mem_limit_mb << 20);
+  if (failed) {
+    cerr << failed << " kernel(s) failed to process\n";
+    return 1;
+  }
   return 0;
 }
 
@@ -156,7 +332,7 @@ int main(int argc, char **argv) {
 // For error/warning/info message to print to the terminal, always use the
 // stderr stream. The io redirection will be restored by the time the function
 // returns.
-void group_per_block(const char *filepath) {
+void group_per_block(const char *filepath, size_t mem_limit) {
   preserved_stdin_fileno = dup(STDIN_FILENO);
   preserved_stdout_fileno = dup(STDOUT_FILENO);
 
@@ -258,6 +434,19 @@ void group_per_block(const char *filepath) {
   }
 
   cerr << "Processing file " << filepath << endl;
+  auto start_time = chrono::steady_clock::now();
+  size_t bytes_read = 0, insts_read = 0;
+
+  // Approximate footprint of the in-memory grouping, checked against
+  // mem_limit to switch to the out-of-core path
+  size_t mem_bytes = 0, insts_bytes = 0;
+  unsigned tbs_seen = 0;
+  tb_spill_buckets buckets;
+  string directory(filepath_str);
+  const size_t last_slash_idx = directory.rfind('/');
+  directory = std::string::npos != last_slash_idx
+                  ? directory.substr(0, last_slash_idx)
+                  : ".";
 
   vector<threadblock_info> insts;
   unsigned grid_dim_x, grid_dim_y, grid_dim_z, tb_dim_x, tb_dim_y, tb_dim_z;
@@ -277,6 +466,7 @@ void group_per_block(const char *filepath) {
   clearerr(stdin);
   while (!cin.eof()) {
     getline(cin, line);
+    bytes_read += line.length() + 1;
 
     if (line.length() == 0 || line[0] == '#') {
       cout << line << endl;
@@ -330,11 +520,11 @@ void group_per_block(const char *filepath) {
         insts[tb_id].tb_id_y = tb_id_y;
         insts[tb_id].tb_id_z = tb_id_z;
         insts[tb_id].initialized = true;
+        tbs_seen++;
       }
-      // ss.ignore(); //remove the space
-      // rest_of_line.clear();
-      // getline(ss, rest_of_line); //get rest of the string!
-      string rest_of_line(ss.str().substr(ss.tellg() + 1));
+      insts_read++;
+      // view the rest of the line (after the space) without copying it
+      string_view rest_of_line = string_view(line).substr((size_t)ss.tellg() + 1);
 
       // Ni: ignore the shmem LDGSTS instruction
       stringstream opcode_ss;
@@ -350,61 +540,96 @@ void group_per_block(const char *filepath) {
       }
       opcode_ss >> opcode;
 
-      // Look up the warp inst table to see if this instruction has been
-      // registered. If yes, we just copy the pointer to that string.
-      const string *inst_ptr = warp_inst_lut.lookup_entry(rest_of_line);
-      if (!inst_ptr)
-        inst_ptr = warp_inst_lut.register_new_entry(rest_of_line);
-
       // One actual LDGSTS instruction includes 2 LDGSTS instructions in the
       // trace, because it has two memory references. This is trying to remove
       // the one with the shared memory address.
-
       if (opcode.find("LDGSTS") != string::npos) {
-        if (!ldgsts_flags[tb_id][warpid_tb]) {
-          insts[tb_id].warp_insts_array[warpid_tb].push_back(inst_ptr);
-        }
+        bool drop = ldgsts_flags[tb_id][warpid_tb];
         ldgsts_flags[tb_id][warpid_tb] = !ldgsts_flags[tb_id][warpid_tb];
-      } else {
-        insts[tb_id].warp_insts_array[warpid_tb].push_back(inst_ptr);
+        if (drop)
+          continue;
+      }
+
+      if (buckets.active()) {
+        buckets.append(tb_id, warpid_tb, rest_of_line);
+        continue;
+      }
+
+      // Look up the warp inst table to see if this instruction has been
+      // registered. If yes, we just copy the pointer to that string.
+      const string_view *inst_ptr = warp_inst_lut.intern(rest_of_line);
+      insts[tb_id].warp_insts_array[warpid_tb].push_back(inst_ptr);
+      insts_bytes += sizeof(inst_ptr);
+      mem_bytes = insts_bytes + warp_inst_lut.memory_footprint();
+
+      if (mem_limit && mem_bytes > mem_limit) {
+        // Size the buckets so that each is expected to take half the budget
+        size_t projected = mem_bytes / tbs_seen * insts.size();
+        unsigned num_buckets = 2 * projected / mem_limit + 1;
+        num_buckets = max(2u, min(num_buckets, 512u));
+        num_buckets = min(num_buckets, (unsigned)insts.size());
+        cerr << "Kernel " << filepath << " exceeds the memory limit, grouping "
+             << "it out of core with " << num_buckets << " buckets" << endl;
+        buckets.open(directory, insts.size(), num_buckets);
+
+        // move everything grouped so far to the buckets
+        for (unsigned i = 0; i < insts.size(); ++i) {
+          for (unsigned j = 0; j < insts[i].warp_insts_array.size(); ++j) {
+            for (const string_view *inst : insts[i].warp_insts_array[j])
+              buckets.append(i, j, *inst);
+            deque<const string_view *>().swap(insts[i].warp_insts_array[j]);
+          }
+        }
+        warp_inst_lut = WarpInstLUT();
+        mem_bytes = insts_bytes = 0;
       }
     }
   }
 
-  for (unsigned i = 0; i < insts.size(); ++i) {
-    // ofs<<string<<"\n";
-    if (insts[i].initialized && insts[i].warp_insts_array.size() > 0) {
-      cout << "\n"
-           << "#BEGIN_TB"
-           << "\n";
-      cout << "\n"
-           << "thread block = " << insts[i].tb_id_x << "," << insts[i].tb_id_y
-           << "," << insts[i].tb_id_z << "\n";
-    } else {
-      cerr << "Warning: Thread block " << insts[i].tb_id_x << ","
-           << insts[i].tb_id_y << "," << insts[i].tb_id_z << " is empty"
-           << "\n";
-      continue;
-    }
-    for (unsigned j = 0; j < insts[i].warp_insts_array.size(); ++j) {
-      cout << "\n"
-           << "warp = " << j << "\n";
-      cout << "insts = " << insts[i].warp_insts_array[j].size() << "\n";
-      if (insts[i].warp_insts_array[j].size() == 0) {
-        cerr << "Warning: Warp " << j << " in thread block" << insts[i].tb_id_x
-             << "," << insts[i].tb_id_y << "," << insts[i].tb_id_z
-             << " is empty"
-             << "\n";
+  if (!buckets.active()) {
+    for (unsigned i = 0; i < insts.size(); ++i)
+      print_threadblock(insts[i]);
+  } else {
+    // group one bucket at a time, in thread block id order
+    for (unsigned b = 0; b < buckets.files.size(); ++b) {
+      WarpInstLUT bucket_lut;
+      FILE *f = buckets.files[b];
+      rewind(f);
+      char *buf = NULL;
+      size_t buf_size = 0;
+      ssize_t len;
+      while ((len = getline(&buf, &buf_size, f)) != -1) {
+        if (len > 0 && buf[len - 1] == '\n')
+          buf[--len] = '\0';
+        int prefix_len = 0;
+        sscanf(buf, "%u %u %n", &tb_id, &warpid_tb, &prefix_len);
+        const string_view *inst_ptr =
+            bucket_lut.intern(string_view(buf + prefix_len, len - prefix_len));
+        insts[tb_id].warp_insts_array[warpid_tb].push_back(inst_ptr);
       }
-      for (auto it = insts[i].warp_insts_array[j].cbegin();
-           it != insts[i].warp_insts_array[j].cend(); ++it) {
-        // dereference once: const string*
-        // dereference twice: const string
-        cout << **it << "\n";
+      free(buf);
+
+      unsigned first = b * buckets.tbs_per_bucket;
+      unsigned last =
+          min((unsigned)insts.size(), first + buckets.tbs_per_bucket);
+      for (unsigned i = first; i < last; ++i) {
+        print_threadblock(insts[i]);
+        for (auto &warp_insts : insts[i].warp_insts_array)
+          deque<const string_view *>().swap(warp_insts);
       }
     }
-    cout << endl << "#END_TB" << endl;
   }
+  cout.flush();
+
+  double secs =
+      chrono::duration<double>(chrono::steady_clock::now() - start_time)
+          .count();
+  cerr << "Finished " << filepath << ": " << insts_read << " insts, "
+       << bytes_read / 1e6 << " MB in " << secs << " s ("
+       << bytes_read / 1e6 / secs << " MB/s, " << insts_read / 1e6 / secs
+       << " Minsts/s)" << (buckets.active() ? ", grouped out of core" : "")
+       << endl;
+  buckets.close_all();
 
   close(source_pipe_fd[0]);
   close(source_pipe_fd[1]);
@@ -416,6 +641,43 @@ void group_per_block(const char *filepath) {
   dup2(preserved_stdout_fileno, STDOUT_FILENO);
   close(preserved_stdin_fileno);
   close(preserved_stdout_fileno);
+
+  // the job is only done once the sink has written the whole output file
+  waitpid(sink_process_pid, NULL, 0);
+  waitpid(source_process_pid, NULL, 0);
+}
+
+void print_threadblock(const threadblock_info &tb) {
+  if (tb.initialized && tb.warp_insts_array.size() > 0) {
+    cout << "\n"
+         << "#BEGIN_TB"
+         << "\n";
+    cout << "\n"
+         << "thread block = " << tb.tb_id_x << "," << tb.tb_id_y << ","
+         << tb.tb_id_z << "\n";
+  } else {
+    cerr << "Warning: Thread block " << tb.tb_id_x << "," << tb.tb_id_y << ","
+         << tb.tb_id_z << " is empty"
+         << "\n";
+    return;
+  }
+  for (unsigned j = 0; j < tb.warp_insts_array.size(); ++j) {
+    cout << "\n"
+         << "warp = " << j << "\n";
+    cout << "insts = " << tb.warp_insts_array[j].size() << "\n";
+    if (tb.warp_insts_array[j].size() == 0) {
+      cerr << "Warning: Warp " << j << " in thread block" << tb.tb_id_x << ","
+           << tb.tb_id_y << "," << tb.tb_id_z << " is empty"
+           << "\n";
+    }
+    for (auto it = tb.warp_insts_array[j].cbegin();
+         it != tb.warp_insts_array[j].cend(); ++it) {
+      // dereference once: const string_view*
+      // dereference twice: const string_view
+      cout << **it << "\n";
+    }
+  }
+  cout << endl << "#END_TB" << endl;
 }
 
 void group_per_core(const char *filepath) {
@@ -0,0 +1,108 @@
+// Replays a raw, warp-interleaved kernel trace (kernel-N.trace[.xz]) through
+// the same ThreadBlockTraceGrouper the tracer uses to emit grouped traces, so
+// the grouping can be exercised and diffed offline against the output of
+// post-traces-processing.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "tb_trace_grouper.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 4) {
+    cerr << "Usage: " << argv[0]
+         << " <kernel-N.trace[.xz]> [output file] [memory limit in MB]\n"
+         << "By default the output is written next to the input as "
+            "kernel-N.traceg[.xz]\n";
+    return 1;
+  }
+
+  string input_filepath(argv[1]);
+  string output_filepath;
+  string source_cmd, sink_cmd;
+  int _l = input_filepath.length();
+  bool is_xz = _l > 3 && input_filepath.substr(_l - 3, 3) == ".xz";
+  if (is_xz) {
+    source_cmd = "xz -dc " + input_filepath;
+    output_filepath = input_filepath.substr(0, _l - 3) + "g.xz";
+  } else {
+    source_cmd = "cat " + input_filepath;
+    output_filepath = input_filepath + "g";
+  }
+  if (argc > 2)
+    output_filepath = argv[2];
+  size_t mem_limit_mb = argc > 3 ? strtoull(argv[3], NULL, 10) : 2048;
+
+  _l = output_filepath.length();
+  if (_l > 3 && output_filepath.substr(_l - 3, 3) == ".xz")
+    sink_cmd = "xz -1 -T0 > " + output_filepath;
+  else
+    sink_cmd = "cat > " + output_filepath;
+
+  FILE *in = popen(source_cmd.c_str(), "r");
+  FILE *out = popen(sink_cmd.c_str(), "w");
+  if (!in || !out) {
+    cerr << "Unable to open " << input_filepath << " or " << output_filepath
+         << "\n";
+    return 1;
+  }
+
+  string directory(output_filepath);
+  const size_t last_slash_idx = directory.rfind('/');
+  directory = std::string::npos != last_slash_idx
+                  ? directory.substr(0, last_slash_idx)
+                  : ".";
+  ThreadBlockTraceGrouper grouper(mem_limit_mb << 20, directory);
+
+  unsigned grid_dim_x = 0, grid_dim_y = 0, grid_dim_z = 0;
+  unsigned tb_dim_x = 0, tb_dim_y = 0, tb_dim_z = 0;
+  unsigned lineinfo = 0;
+  bool in_header = true;
+  char *buf = NULL;
+  size_t buf_size = 0;
+  ssize_t len;
+  while ((len = getline(&buf, &buf_size, in)) != -1) {
+    while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r'))
+      buf[--len] = '\0';
+
+    if (len == 0 || buf[0] == '#' || buf[0] == '-') {
+      // header lines are copied as is, the instruction stream starts after
+      if (buf[0] == '-') {
+        sscanf(buf, "-grid dim = (%u,%u,%u)", &grid_dim_x, &grid_dim_y,
+               &grid_dim_z);
+        sscanf(buf, "-block dim = (%u,%u,%u)", &tb_dim_x, &tb_dim_y,
+               &tb_dim_z);
+        sscanf(buf, "-enable lineinfo = %u", &lineinfo);
+      }
+      if (in_header)
+        fprintf(out, "%s\n", buf);
+      continue;
+    }
+
+    if (in_header) {
+      in_header = false;
+      grouper.begin_kernel(out, grid_dim_x, grid_dim_y, grid_dim_z, tb_dim_x,
+                           tb_dim_y, tb_dim_z);
+    }
+    grouper.add_raw_line(string(buf, len), lineinfo);
+  }
+  free(buf);
+
+  if (in_header)
+    grouper.begin_kernel(out, grid_dim_x, grid_dim_y, grid_dim_z, tb_dim_x,
+                         tb_dim_y, tb_dim_z);
+  grouper.end_kernel();
+
+  cerr << "Grouped " << input_filepath << " into " << output_filepath
+       << " (peak buffered " << (grouper.peak_mem_bytes() >> 20)
+       << " MB, spilled " << (grouper.spilled_bytes() >> 20) << " MB)\n";
+
+  pclose(in);
+  return pclose(out) == 0 ? 0 : 1;
+}
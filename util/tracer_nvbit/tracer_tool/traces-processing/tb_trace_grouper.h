@@ -0,0 +1,367 @@
+/* Groups warp-interleaved trace lines into per thread block streams */
+
+#ifndef TB_TRACE_GROUPER_H
+#define TB_TRACE_GROUPER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// @brief Buffered instructions of one warp of an active thread block. Lines
+/// are kept '\n' terminated in `mem`; once the grouper runs over its memory
+/// budget, `mem` is appended to the spill file and its (offset, length) is
+/// remembered in `spilled`, in arrival order.
+struct tb_grouper_warp {
+  std::string mem;
+  std::vector<std::pair<uint64_t, uint64_t>> spilled;
+  unsigned insts;
+  uint32_t exited_mask;
+  bool drop_next_ldgsts;
+  tb_grouper_warp() {
+    insts = 0;
+    exited_mask = 0;
+    drop_next_ldgsts = true;
+  }
+};
+
+struct tb_grouper_cta {
+  unsigned tb_id_x, tb_id_y, tb_id_z;
+  std::vector<tb_grouper_warp> warps;
+  unsigned warps_done;
+  bool done;
+  size_t mem_bytes;
+  tb_grouper_cta() {
+    tb_id_x = tb_id_y = tb_id_z = 0;
+    warps_done = 0;
+    done = false;
+    mem_bytes = 0;
+  }
+};
+
+/// @brief Turns the warp-interleaved instruction stream of one kernel into
+/// the thread-block-grouped format consumed by the simulator (#BEGIN_TB ...
+/// #END_TB blocks). Only thread blocks that are still running are buffered. A
+/// thread block is finished once every thread of every one of its warps has
+/// executed EXIT; finished blocks are written out in linear block id order, so
+/// the output matches what post-traces-processing produces from the raw
+/// trace. When the buffered instructions exceed the memory limit, the largest
+/// thread blocks are spilled to an unlinked temporary file under spill_dir.
+///
+/// The tracer feeds it directly from the receiving thread, and
+/// replay-trace-grouping feeds it from a raw .trace file, so both paths share
+/// exactly the same grouping logic.
+class ThreadBlockTraceGrouper {
+public:
+  ThreadBlockTraceGrouper(size_t mem_limit_bytes, const std::string &spill_dir)
+      : m_mem_limit(mem_limit_bytes), m_spill_dir(spill_dir) {
+    m_out = NULL;
+    m_spill_fd = -1;
+    m_spill_size = 0;
+    m_mem_bytes = 0;
+    m_peak_mem_bytes = 0;
+    m_spilled_bytes = 0;
+    m_grid_dim_x = m_grid_dim_y = m_grid_dim_z = 0;
+    m_threads_per_block = 0;
+    m_warps_per_block = 0;
+    m_num_blocks = 0;
+    m_next_flush = 0;
+  }
+
+  ~ThreadBlockTraceGrouper() { close_spill_file(); }
+
+  /// @brief Start a new kernel. Header lines must already be written to out.
+  void begin_kernel(FILE *out, unsigned grid_dim_x, unsigned grid_dim_y,
+                    unsigned grid_dim_z, unsigned tb_dim_x, unsigned tb_dim_y,
+                    unsigned tb_dim_z) {
+    m_out = out;
+    // post-traces-processing echoes the empty line it reads at the end of
+    // the raw trace right after the header, before any thread block
+    fputs("\n", m_out);
+    m_grid_dim_x = grid_dim_x;
+    m_grid_dim_y = grid_dim_y;
+    m_grid_dim_z = grid_dim_z;
+    m_threads_per_block = tb_dim_x * tb_dim_y * tb_dim_z;
+    m_warps_per_block = (m_threads_per_block + 31) / 32;
+    m_num_blocks = (uint64_t)grid_dim_x * grid_dim_y * grid_dim_z;
+    m_next_flush = 0;
+    m_active.clear();
+    m_mem_bytes = 0;
+    m_peak_mem_bytes = 0;
+    m_spilled_bytes = 0;
+  }
+
+  /// @brief Buffer one instruction of a warp.
+  /// @param line The trace line without the leading thread block and warp
+  /// ids, i.e. "[line_num] PC mask dest_num ...". No trailing newline.
+  /// @param is_ldgsts The opcode is an LDGSTS. The tracer reports it twice
+  /// (one per memory reference); only the global memory one is kept.
+  /// @param exit_mask The lanes that execute this instruction if it is an
+  /// EXIT, 0 otherwise.
+  void add_inst(unsigned tb_id_x, unsigned tb_id_y, unsigned tb_id_z,
+                unsigned warpid_tb, const char *line, size_t len,
+                bool is_ldgsts, uint32_t exit_mask) {
+    uint64_t tb_id = (uint64_t)tb_id_z * m_grid_dim_y * m_grid_dim_x +
+                     (uint64_t)tb_id_y * m_grid_dim_x + tb_id_x;
+    if (tb_id < m_next_flush || tb_id >= m_num_blocks ||
+        warpid_tb >= m_warps_per_block) {
+      std::cerr << "Warning: dropping instruction of thread block " << tb_id_x
+                << "," << tb_id_y << "," << tb_id_z << " warp " << warpid_tb
+                << ": out of the grid or the block was already written out\n";
+      return;
+    }
+
+    tb_grouper_cta &cta = get_cta(tb_id, tb_id_x, tb_id_y, tb_id_z);
+    tb_grouper_warp &warp = cta.warps[warpid_tb];
+
+    bool keep = true;
+    if (is_ldgsts) {
+      keep = !warp.drop_next_ldgsts;
+      warp.drop_next_ldgsts = !warp.drop_next_ldgsts;
+    }
+    if (keep) {
+      warp.mem.append(line, len);
+      warp.mem.push_back('\n');
+      warp.insts++;
+      cta.mem_bytes += len + 1;
+      m_mem_bytes += len + 1;
+      if (m_mem_bytes > m_peak_mem_bytes)
+        m_peak_mem_bytes = m_mem_bytes;
+    }
+
+    if (exit_mask) {
+      uint32_t full_mask = warp_full_mask(warpid_tb);
+      bool was_done = (warp.exited_mask & full_mask) == full_mask;
+      warp.exited_mask |= exit_mask;
+      if (!was_done && (warp.exited_mask & full_mask) == full_mask &&
+          ++cta.warps_done == m_warps_per_block) {
+        cta.done = true;
+        flush_finished();
+      }
+    }
+
+    if (m_mem_bytes > m_mem_limit)
+      spill();
+  }
+
+  /// @brief Parse and buffer a raw tracer line
+  /// "tb_x tb_y tb_z warpid_tb [line_num] PC mask dest_num ...".
+  void add_raw_line(const std::string &raw, unsigned enable_lineinfo) {
+    unsigned tb_id_x, tb_id_y, tb_id_z, warpid_tb;
+    int prefix_len = 0;
+    if (sscanf(raw.c_str(), "%u %u %u %u %n", &tb_id_x, &tb_id_y, &tb_id_z,
+               &warpid_tb, &prefix_len) != 4) {
+      std::cerr << "Warning: malformed trace line: " << raw << "\n";
+      return;
+    }
+    const char *line = raw.c_str() + prefix_len;
+    size_t len = raw.length() - prefix_len;
+
+    // [line_num] PC mask dest_num [reg_dests] opcode
+    std::istringstream ss(std::string(line, len));
+    std::string temp, mask_str, opcode;
+    unsigned dest_num = 0;
+    if (enable_lineinfo)
+      ss >> temp;
+    ss >> temp >> mask_str >> dest_num;
+    for (unsigned i = 0; i < dest_num; i++)
+      ss >> temp;
+    ss >> opcode;
+
+    uint32_t exit_mask = 0;
+    if (opcode.compare(0, 4, "EXIT") == 0)
+      exit_mask = (uint32_t)strtoul(mask_str.c_str(), NULL, 16);
+    add_inst(tb_id_x, tb_id_y, tb_id_z, warpid_tb, line, len,
+             opcode.find("LDGSTS") != std::string::npos, exit_mask);
+  }
+
+  /// @brief Write out every buffered thread block and finish the kernel.
+  void end_kernel() {
+    for (; m_next_flush < m_num_blocks; m_next_flush++) {
+      std::unordered_map<uint64_t, tb_grouper_cta>::iterator it =
+          m_active.find(m_next_flush);
+      if (it == m_active.end()) {
+        unsigned x = m_next_flush % m_grid_dim_x;
+        unsigned y = (m_next_flush / m_grid_dim_x) % m_grid_dim_y;
+        unsigned z = m_next_flush / ((uint64_t)m_grid_dim_x * m_grid_dim_y);
+        std::cerr << "Warning: Thread block " << x << "," << y << "," << z
+                  << " is empty"
+                  << "\n";
+        continue;
+      }
+      write_cta(it->second);
+      m_active.erase(it);
+    }
+    fflush(m_out);
+    m_out = NULL;
+    close_spill_file();
+  }
+
+  size_t peak_mem_bytes() const { return m_peak_mem_bytes; }
+  uint64_t spilled_bytes() const { return m_spilled_bytes; }
+
+private:
+  uint32_t warp_full_mask(unsigned warpid_tb) const {
+    unsigned threads = m_threads_per_block - warpid_tb * 32;
+    return threads >= 32 ? 0xffffffffu : ((1u << threads) - 1);
+  }
+
+  tb_grouper_cta &get_cta(uint64_t tb_id, unsigned x, unsigned y, unsigned z) {
+    std::unordered_map<uint64_t, tb_grouper_cta>::iterator it =
+        m_active.find(tb_id);
+    if (it != m_active.end())
+      return it->second;
+    tb_grouper_cta &cta = m_active[tb_id];
+    cta.tb_id_x = x;
+    cta.tb_id_y = y;
+    cta.tb_id_z = z;
+    cta.warps.resize(m_warps_per_block);
+    return cta;
+  }
+
+  // write out finished blocks as long as there is no gap in the block ids
+  void flush_finished() {
+    while (m_next_flush < m_num_blocks) {
+      std::unordered_map<uint64_t, tb_grouper_cta>::iterator it =
+          m_active.find(m_next_flush);
+      if (it == m_active.end() || !it->second.done)
+        break;
+      write_cta(it->second);
+      m_active.erase(it);
+      m_next_flush++;
+    }
+  }
+
+  void write_cta(tb_grouper_cta &cta) {
+    fprintf(m_out, "\n#BEGIN_TB\n\nthread block = %u,%u,%u\n", cta.tb_id_x,
+            cta.tb_id_y, cta.tb_id_z);
+    std::vector<char> buf;
+    for (unsigned j = 0; j < cta.warps.size(); ++j) {
+      tb_grouper_warp &warp = cta.warps[j];
+      fprintf(m_out, "\nwarp = %u\ninsts = %u\n", j, warp.insts);
+      if (warp.insts == 0) {
+        std::cerr << "Warning: Warp " << j << " in thread block"
+                  << cta.tb_id_x << "," << cta.tb_id_y << "," << cta.tb_id_z
+                  << " is empty"
+                  << "\n";
+      }
+      for (size_t s = 0; s < warp.spilled.size(); ++s) {
+        buf.resize(warp.spilled[s].second);
+        read_spill(warp.spilled[s].first, buf.data(), buf.size());
+        fwrite(buf.data(), 1, buf.size(), m_out);
+      }
+      fwrite(warp.mem.data(), 1, warp.mem.size(), m_out);
+    }
+    fprintf(m_out, "\n#END_TB\n");
+    m_mem_bytes -= cta.mem_bytes;
+  }
+
+  // move the biggest buffered thread blocks to disk until we are back to
+  // half of the budget, so that we do not spill again right away
+  void spill() {
+    if (m_spill_fd < 0)
+      open_spill_file();
+
+    std::vector<std::pair<size_t, uint64_t>> by_size;
+    by_size.reserve(m_active.size());
+    for (std::unordered_map<uint64_t, tb_grouper_cta>::iterator it =
+             m_active.begin();
+         it != m_active.end(); ++it)
+      by_size.push_back(std::make_pair(it->second.mem_bytes, it->first));
+    std::sort(by_size.rbegin(), by_size.rend());
+
+    for (size_t i = 0; i < by_size.size() && m_mem_bytes > m_mem_limit / 2;
+         ++i) {
+      tb_grouper_cta &cta = m_active[by_size[i].second];
+      for (unsigned j = 0; j < cta.warps.size(); ++j) {
+        tb_grouper_warp &warp = cta.warps[j];
+        if (warp.mem.empty())
+          continue;
+        write_spill(warp.mem.data(), warp.mem.size());
+        warp.spilled.push_back(
+            std::make_pair(m_spill_size - warp.mem.size(), warp.mem.size()));
+        m_spilled_bytes += warp.mem.size();
+        std::string().swap(warp.mem);
+      }
+      m_mem_bytes -= cta.mem_bytes;
+      cta.mem_bytes = 0;
+    }
+  }
+
+  void open_spill_file() {
+    std::string path = m_spill_dir + "/.tb_grouper_spill_XXXXXX";
+    std::vector<char> tmpl(path.begin(), path.end());
+    tmpl.push_back('\0');
+    m_spill_fd = mkstemp(tmpl.data());
+    if (m_spill_fd < 0) {
+      std::cerr << "Failed to create trace spill file " << path << "\n";
+      perror("mkstemp");
+      exit(1);
+    }
+    // the file lives as long as the descriptor is open
+    unlink(tmpl.data());
+    m_spill_size = 0;
+  }
+
+  void close_spill_file() {
+    if (m_spill_fd >= 0)
+      close(m_spill_fd);
+    m_spill_fd = -1;
+    m_spill_size = 0;
+  }
+
+  void write_spill(const char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+      ssize_t r = pwrite(m_spill_fd, data + done, len - done,
+                         m_spill_size + done);
+      if (r <= 0) {
+        perror("trace spill write");
+        exit(1);
+      }
+      done += r;
+    }
+    m_spill_size += len;
+  }
+
+  void read_spill(uint64_t offset, char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+      ssize_t r = pread(m_spill_fd, data + done, len - done, offset + done);
+      if (r <= 0) {
+        perror("trace spill read");
+        exit(1);
+      }
+      done += r;
+    }
+  }
+
+  FILE *m_out;
+  size_t m_mem_limit;
+  std::string m_spill_dir;
+  int m_spill_fd;
+  uint64_t m_spill_size;
+
+  size_t m_mem_bytes;
+  size_t m_peak_mem_bytes;
+  uint64_t m_spilled_bytes;
+
+  unsigned m_grid_dim_x, m_grid_dim_y, m_grid_dim_z;
+  unsigned m_threads_per_block;
+  unsigned m_warps_per_block;
+  uint64_t m_num_blocks;
+  // lowest linear block id that was not written out yet
+  uint64_t m_next_flush;
+  std::unordered_map<uint64_t, tb_grouper_cta> m_active;
+};
+
+#endif
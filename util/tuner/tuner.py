@@ -12,6 +12,8 @@ import shutil
 import glob
 import datetime
 import string
+import concurrent.futures
+import yaml
 
 parser = OptionParser()
 parser.add_option(
@@ -21,13 +23,85 @@ parser.add_option(
     help="the path to the stats output generated from the GPU_Microbenchmark suite",
     default="./output.txt",
 )
+parser.add_option(
+    "-m",
+    "--mode",
+    dest="mode",
+    help="generate: write the config folder from the ubench stats. "
+    + "search: simulate the traced ubenchs and tune the config until the "
+    + "simulated numbers match the recorded hardware ones",
+    default="generate",
+)
+parser.add_option(
+    "-T",
+    "--trace_dir",
+    dest="trace_dir",
+    help="search mode: the directory holding the GPU_Microbenchmark traces",
+    default="",
+)
+parser.add_option(
+    "-c",
+    "--config_dir",
+    dest="config_dir",
+    help="search mode: the config folder to start from and update. "
+    + "Defaults to the folder generate mode writes for the device",
+    default="",
+)
+parser.add_option(
+    "-e",
+    "--simulator",
+    dest="simulator",
+    help="search mode: the accel-sim.out to run. "
+    + "Defaults to $ACCELSIM_ROOT/bin/$ACCELSIM_CONFIG/accel-sim.out",
+    default="",
+)
+parser.add_option(
+    "-y",
+    "--search_metrics",
+    dest="search_metrics",
+    help="search mode: the yml file listing the metrics to match",
+    default=os.path.join(this_directory, "search_metrics.yml"),
+)
+parser.add_option(
+    "-r",
+    "--run_dir",
+    dest="run_dir",
+    help="search mode: where the simulations are run",
+    default="./tuner_search",
+)
+parser.add_option(
+    "-j",
+    "--jobs",
+    dest="jobs",
+    type="int",
+    help="search mode: number of simulations to run in parallel",
+    default=os.cpu_count(),
+)
+parser.add_option(
+    "-t",
+    "--tolerance",
+    dest="tolerance",
+    type="float",
+    help="search mode: relative error below which a metric is matched",
+    default=0.05,
+)
+parser.add_option(
+    "-i",
+    "--max_iterations",
+    dest="max_iterations",
+    type="int",
+    help="search mode: give up after this many rounds of simulations",
+    default=8,
+)
 
 (options, args) = parser.parse_args()
 
 # parse stats output
 stats = {}
+ubench_output = {}
 device_name_key = "Device Name"
 device_name = "undefined"
+ubench_name = ""
 stats_file = open(options.stats_output, "r")
 lines = stats_file.readlines()
 for line in lines:
@@ -37,37 +111,282 @@ for line in lines:
     elif device_name_key in line:
         cols = line.split(" = ")
         device_name = cols[1].replace(" ", "_").strip("\n")
-print("parsing", device_name, "stats is done")
 
-# create a config folder for the device name
-config = []
-new_config_dir = os.path.join(this_directory, device_name)
-print("creating", device_name, "folder")
-if not os.path.exists(new_config_dir):
-    os.makedirs(new_config_dir)
+    # keep each ubench output apart, search mode matches them one by one
+    match = re.match(r"running \./(\S+) microbenchmark", line)
+    if match:
+        ubench_name = match.group(1)
+        ubench_output[ubench_name] = ""
+    elif ubench_name != "":
+        ubench_output[ubench_name] += line
+print("parsing", device_name, "stats is done")
 
 files = ["gpgpusim.config", "trace.config"]
-for config_file in files:
-    config_temp = os.path.join(this_directory, "config_template")
-    gpgpusim_file = os.path.join(config_temp, config_file)
-
-    # copy config tempalte to the new device folder
-    shutil.copy(gpgpusim_file, new_config_dir)
-    with open(gpgpusim_file) as my_file:
-        config = my_file.readlines()
-
-    # for each config param, replace it with the one from the output ubench stats
-    for idx, item in enumerate(config):
-        if item[0] == "-":
-            cols = item.split()
-            if cols[0] in stats.keys():
-                config[idx] = stats[cols[0]]
-
-    # write the new config param in the config files
-    new_gpgpusim_file = os.path.join(new_config_dir, config_file)
-    print("writing new stats file to", config_file)
-    with open(new_gpgpusim_file, "w") as f:
-        for item in config:
-            f.write("%s" % item)
+
+
+def generate():
+    # create a config folder for the device name
+    config = []
+    new_config_dir = os.path.join(this_directory, device_name)
+    print("creating", device_name, "folder")
+    if not os.path.exists(new_config_dir):
+        os.makedirs(new_config_dir)
+
+    for config_file in files:
+        config_temp = os.path.join(this_directory, "config_template")
+        gpgpusim_file = os.path.join(config_temp, config_file)
+
+        # copy config tempalte to the new device folder
+        shutil.copy(gpgpusim_file, new_config_dir)
+        with open(gpgpusim_file) as my_file:
+            config = my_file.readlines()
+
+        # for each config param, replace it with the one from the output ubench stats
+        for idx, item in enumerate(config):
+            if item[0] == "-":
+                cols = item.split()
+                if cols[0] in stats.keys():
+                    config[idx] = stats[cols[0]]
+
+        # write the new config param in the config files
+        new_gpgpusim_file = os.path.join(new_config_dir, config_file)
+        print("writing new stats file to", config_file)
+        with open(new_gpgpusim_file, "w") as f:
+            for item in config:
+                f.write("%s" % item)
+
+
+# -----------------------------------------------------------
+# search mode
+# -----------------------------------------------------------
+
+# "-option value" or "-option = value" as printed by the ubenchs
+config_option_re = re.compile(r"^(-\S+)\s+(?:=\s*)?(.*?)\s*$")
+
+
+def get_config_option(config, option):
+    value = None
+    for line in config:
+        match = config_option_re.match(line)
+        if match and match.group(1) == option:
+            value = match.group(2)
+    return value
+
+
+def set_config_option(config, option, value):
+    for idx, line in enumerate(config):
+        match = config_option_re.match(line)
+        if match and match.group(1) == option:
+            config[idx] = option + " " + value + "\n"
+
+
+def get_knob(config, metric):
+    value = get_config_option(config, metric["knob"])
+    if value == None:
+        sys.exit("ERROR - " + metric["knob"] + " is not set in gpgpusim.config")
+    if "field" in metric:
+        value = value.split(":")[metric["field"]]
+    return float(value)
+
+
+def set_knob(config, metric, value):
+    if metric["integer"]:
+        text = str(int(value))
+    else:
+        text = "%.1f" % value
+    if "field" in metric:
+        fields = get_config_option(config, metric["knob"]).split(":")
+        fields[metric["field"]] = text
+        text = ":".join(fields)
+    set_config_option(config, metric["knob"], text)
+
+
+def find_trace(trace_dir, ubench):
+    # <suite>/<app>/<args>/traces as laid out by run_simulations.py
+    for pattern in [
+        os.path.join(trace_dir, ubench, "traces"),
+        os.path.join(trace_dir, ubench, "*", "traces"),
+        os.path.join(trace_dir, "*", ubench, "*", "traces"),
+    ]:
+        for traces in glob.glob(pattern):
+            kernelslist = os.path.join(traces, "kernelslist.g")
+            if os.path.exists(kernelslist):
+                return kernelslist
+    return None
+
+
+def run_simulation(run_dir, kernelslist):
+    out_file = os.path.join(run_dir, "accel-sim.out.txt")
+    with open(out_file, "w") as out:
+        result = subprocess.run(
+            [
+                options.simulator,
+                "-config",
+                "./gpgpusim.config",
+                "-trace",
+                kernelslist,
+            ],
+            cwd=run_dir,
+            stdout=out,
+            stderr=subprocess.STDOUT,
+        )
+    if result.returncode != 0:
+        sys.exit("ERROR - simulation failed, see " + out_file)
+    return out_file
+
+
+def evaluate_metric(metric, sim_stats, out_file, core_clock):
+    values = {"core_clock": core_clock}
+    text = open(out_file).read()
+    for name, regex in sim_stats.items():
+        found = re.findall(regex, text)
+        if len(found) > 0:
+            values[name] = float(found[-1])
+    try:
+        return float(eval(metric["sim"], {}, values))
+    except (NameError, ZeroDivisionError) as e:
+        sys.exit(
+            "ERROR - cannot evaluate '%s' for %s: %s" % (metric["sim"], out_file, e)
+        )
+
+
+def next_knob_value(metric, history, hw_value):
+    # secant step on the last two distinct points, proportional step otherwise
+    (x1, y1) = history[-1]
+    value = x1 * hw_value / y1 if y1 > 0 else x1
+    for (x0, y0) in reversed(history[:-1]):
+        if x0 != x1:
+            if (y1 - y0) / (x1 - x0) > 0:
+                value = x1 + (hw_value - y1) * (x1 - x0) / (y1 - y0)
+            break
+    value = min(max(value, metric["min"]), metric["max"])
+    if metric["integer"]:
+        value = round(value)
+    return value
+
+
+def search():
+    if options.trace_dir == "":
+        sys.exit("ERROR - search mode needs the ubench traces, see -T")
+    if options.config_dir == "":
+        options.config_dir = os.path.join(this_directory, device_name)
+    if options.simulator == "":
+        if os.getenv("ACCELSIM_ROOT") == None:
+            sys.exit("ERROR - Please run setup_environment or pass -e")
+        options.simulator = os.path.join(
+            os.getenv("ACCELSIM_ROOT"),
+            "bin",
+            os.getenv("ACCELSIM_CONFIG"),
+            "accel-sim.out",
+        )
+    options.simulator = os.path.abspath(options.simulator)
+    options.run_dir = os.path.abspath(options.run_dir)
+
+    spec = yaml.safe_load(open(options.search_metrics))
+    sim_stats = spec["sim_stats"]
+
+    config_file = os.path.join(options.config_dir, "gpgpusim.config")
+    config = open(config_file).readlines()
+    trace_config = open(os.path.join(options.config_dir, "trace.config")).read()
+
+    # pick the metrics we have both a hardware number and a trace for
+    metrics = {}
+    for name, metric in spec["metrics"].items():
+        if name not in ubench_output:
+            print("skipping", name, "- no hardware output recorded")
+            continue
+        match = re.search(metric["hw"], ubench_output[name])
+        if not match:
+            print("skipping", name, "- cannot find", metric["hw"])
+            continue
+        kernelslist = find_trace(options.trace_dir, name)
+        if kernelslist == None:
+            print("skipping", name, "- no trace under", options.trace_dir)
+            continue
+        metric["hw_value"] = float(match.group(1))
+        metric["kernelslist"] = os.path.abspath(kernelslist)
+        metric["history"] = []
+        metrics[name] = metric
+    if len(metrics) == 0:
+        sys.exit("ERROR - nothing to tune")
+    tuned = [name for name in metrics if "knob" in metrics[name]]
+
+    best = None
+    for iteration in range(options.max_iterations):
+        clock_domains = get_config_option(config, "-gpgpu_clock_domains")
+        core_clock = float(clock_domains.split(":")[0])
+
+        # every ubench gets its own run directory with the full config
+        futures = {}
+        with concurrent.futures.ThreadPoolExecutor(options.jobs) as executor:
+            for name, metric in metrics.items():
+                run_dir = os.path.join(options.run_dir, "iter%d" % iteration, name)
+                if os.path.exists(run_dir):
+                    shutil.rmtree(run_dir)
+                shutil.copytree(options.config_dir, run_dir)
+                with open(os.path.join(run_dir, "gpgpusim.config"), "w") as f:
+                    f.write("".join(config))
+                    f.write("\n# Accel-Sim Parameters\n" + trace_config)
+                futures[name] = executor.submit(
+                    run_simulation, run_dir, metric["kernelslist"]
+                )
+
+        print("iteration", iteration)
+        errors = {}
+        for name, metric in metrics.items():
+            sim_value = evaluate_metric(
+                metric, sim_stats, futures[name].result(), core_clock
+            )
+            errors[name] = (sim_value - metric["hw_value"]) / metric["hw_value"]
+            knob = ""
+            if "knob" in metric:
+                x = get_knob(config, metric)
+                metric["history"].append((x, sim_value))
+                knob = "%s = %g" % (metric["knob"], x)
+                if "field" in metric:
+                    knob += " (field %d)" % metric["field"]
+            print(
+                "    %-12s hw = %10.3f sim = %10.3f error = %7.2f%% %s"
+                % (name, metric["hw_value"], sim_value, errors[name] * 100, knob)
+            )
+
+        worst = max([abs(errors[name]) for name in tuned] + [0])
+        total = sum([abs(errors[name]) for name in tuned])
+        if best == None or (worst, total) < best[:2]:
+            best = (worst, total, list(config))
+        if worst <= options.tolerance:
+            print("all tuned metrics are within", options.tolerance * 100, "%")
+            break
+
+        changed = False
+        for name in tuned:
+            metric = metrics[name]
+            if abs(errors[name]) <= options.tolerance:
+                continue
+            x = next_knob_value(metric, metric["history"], metric["hw_value"])
+            if x != metric["history"][-1][0]:
+                set_knob(config, metric, x)
+                changed = True
+        if not changed:
+            print("no knob can move any closer, stopping")
+            break
+
+    # keep the round with the smallest worst-case error
+    shutil.copy(config_file, config_file + ".orig")
+    with open(config_file, "w") as f:
+        f.write("".join(best[2]))
+    print(
+        "writing tuned config to",
+        config_file,
+        "worst error = %.2f%%" % (best[0] * 100),
+    )
+
+
+if options.mode == "generate":
+    generate()
+elif options.mode == "search":
+    search()
+else:
+    sys.exit("ERROR - unknown mode " + options.mode)
 
 print("Done!")